@@ -0,0 +1,35 @@
+#include "Profiler.h"
+
+#include <cstdlib>
+#include <new>
+
+// Global allocation functions of imgm - they only add the counting of the profiler to the default behaviour.
+// They are in their own file, so they are not inlined into the callers (the compiler would compare the inlined
+// std::free with the operator new of the caller).
+
+void * operator new(std::size_t size) {
+    Profiler::countAllocation(size);
+    void * memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    Profiler::countAllocation(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void * memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void * memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void * memory, const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
@@ -1,8 +1,21 @@
+#include <chrono>
 #include <iostream>
-#include <regex>
+#include <cctype>
+#include <memory>
 
-#include "PgmImage.h"
+#include "BatchProcessor.h"
 #include "BmpImage.h"
+#include "Convolution.h"
+#include "FrameStream.h"
+#include "ImageFactory.h"
+#include "JobProtocol.h"
+#include "Pipeline.h"
+#include "Profiler.h"
+#include "ResultCache.h"
+#include "Simd.h"
+#include "Server.h"
+
+#include <unistd.h>
 
 /**
  * Displays the help message.
@@ -11,136 +24,458 @@ void help() {
     using std::cout; using std::endl;
 
     cout << "This program gives you the possibility to edit images in these two formats: bmp and pgm." << endl << endl;
-    cout << "Format: imgm -i <file.bpm|pgm> <flag><value|s?>* -o output.bmp|pgm" << endl << endl;
+    cout << "Format: imgm [--profile <trace.json>] [--perf] -i <file.bpm|pgm|-> [--threads <n>] <flag><value|s?>* -o output.bmp|pgm" << endl;
+    cout << "        imgm [--profile <trace.json>] [--perf] --batch <directory|list> [--threads <n>] [--read-ahead <n>] [--write-behind <n>] <flag><value|s?>* -o <template>" << endl << endl;
     cout << "Flags supported:" << endl;
-    cout << "\t -i - path to the input image" << endl;
-    cout << "\t -o - path where the image should be saved" << endl;
+    cout << "\t -i - path to the input image, - reads BMP or PGM from the standard input" << endl;
+    cout << "\t      PGM input can contain many concatenated images (frames), --threads <n> processes n frames at once" << endl;
+    cout << "\t -o - path where the image should be saved, - writes it to the standard output" << endl;
     cout << "\t -rs - resize, expects two values after the flag, width and height separated by space" << endl;
     cout << "\t -n - negative" << endl;
+    cout << "\t -eq - histogram equalization (the colour image by its luminance)" << endl;
+    cout << "\t -cs - contrast stretch, the percent of the darkest and of the brightest values that are clipped can follow" << endl;
+    cout << "\t       (0 - 50, default 0 - the smallest and the biggest value are stretched), fe. -cs 1" << endl;
     cout << "\t -b - blur, expects one value after the flag there is one possibility now: 1 - average filter" << endl;
     cout << "\t -dn - reduce noise, expects one value after the flag. There is one possibility now: 1 - median filter" << endl;
     cout << "\t -g - gradient filter, expects one value after the flag. There is one possibility now: 1 - Sobel operator" << endl;
-    cout << "\t -ib - to binary image, expects one value after the flag, it's the threshold" << endl;
+    cout << "\t -ib - to binary image, expects one value after the flag, it's the threshold or the method of the automatic" << endl;
+    cout << "\t       threshold computed from the histogram: auto (the same as otsu), otsu or triangle," << endl;
+    cout << "\t       or the adaptive threshold computed from the window around every pixel: bradley or sauvola," << endl;
+    cout << "\t       the radius of the window (default 15) and the sensitivity in percent (default 15 for bradley," << endl;
+    cout << "\t       50 for sauvola) can follow, fe. -ib sauvola 20 34" << endl;
     cout << "\t -e - erode (binary image (-ib) must be specified before)" << endl;
     cout << "\t -d - dilate (binary image (-ib) must be specified before)" << endl;
+    cout << "\t      both use the 7x7 (-e) and 5x5 (-d) square, the disk of any radius (0 - 65535) can follow, fe. -e disk 50" << endl;
+    cout << "\t -m - erode and dilate together without the intermediate image, expects the operation after the flag:" << endl;
+    cout << "\t      open (-e -d), close (-d -e), tophat (image minus open), blackhat (close minus image)" << endl;
+    cout << "\t      or gradient (dilated minus eroded image), binary image (-ib) must be specified before, fe. -m open" << endl;
+    cout << "\t -cc - connected components of the white pixels, each one gets its own color, the connectivity 4 or 8 (default)" << endl;
+    cout << "\t       and the path of the statistics (.json or CSV) can follow, binary image (-ib) must be specified before," << endl;
+    cout << "\t       fe. -cc 8 blobs.csv" << endl;
     cout << "\t -r - rotate, expects one value after the flag, it's the rotation degree" << endl;
+    cout << "\t -f - convolution filter, expects its name after the flag: sharpen, emboss, laplacian, sobel, scharr or prewitt," << endl;
+    cout << "\t      the border can follow: clamp (default), reflect or constant <value>, fe. -f sharpen reflect" << endl;
+    cout << "\t -k - convolution with the own kernel, expects its odd size * size weights separated by commas (row by row)," << endl;
+    cout << "\t      the sum is divided by the sum of the weights, the border can follow like for -f, fe. -k 1,2,1,2,4,2,1,2,1" << endl;
+    cout << "\t -roi - region of interest, expects four values after the flag: x y width height (from the top left corner)" << endl;
+    cout << "\t        all following operations will change only the pixels inside it, use -roi all to process the whole image again" << endl;
+    cout << "\t { } - branch, the flags inside work on the copy of the image, branches next to each other run concurrently," << endl;
+    cout << "\t       fe. -dn 5 { -g 1 -o edges.bmp } { -b 1 -o soft.bmp }" << endl;
     cout << "\t -h - this help message" << endl;
+    cout << "\t --profile - measures every stage (opening, reading, operations, saving), prints the summary" << endl;
+    cout << "\t             and saves the Chrome trace (chrome://tracing) to the given path, default: imgm_trace.json" << endl;
+    cout << "\t --perf - adds the hardware counters (IPC, cache and branch misses) to the profile, implies --profile" << endl;
+    cout << "\t --simd - forces the instruction set of the pixel kernels: scalar, sse4.1, avx2 or avx512," << endl;
+    cout << "\t          default: the best one supported by the processor" << endl;
+    cout << "\t --bmp-layout - layout of the BMP pixels in the memory: bgr (interleaved), planar (three channels)" << endl;
+    cout << "\t                or bgrx (4 byte pixels), default: bgr" << endl;
+    cout << "\t --convolution - method of the -k kernels: direct, fft or auto (the cost model chooses it from the kernel size)," << endl;
+    cout << "\t                 default: auto" << endl;
+    cout << "\t --cache - directory of the result cache, the same input with the same flags is not processed again," << endl;
+    cout << "\t           its outputs are copied from the cache (not used if the image is written to the standard output)" << endl;
+    cout << "\t --cache-size - maximal size of the cache in MB, the least recently used results are removed, default: 256" << endl;
+    cout << "\t --cache-stages - stores also the images after the leading operations, so other flags starting" << endl;
+    cout << "\t                  with the same operations continue from them" << endl;
+    cout << endl << "Server mode:" << endl;
+    cout << "\t imgm --serve <socket> [--threads <n>] - accepts the jobs over the Unix domain socket until SIGINT or SIGTERM" << endl;
+    cout << "\t imgm --client <socket> [--timing] -i <file|-> <flag><value|s?>* -o <file> - executes the job on the server," << endl;
+    cout << "\t      -i - sends the image from the standard input, --timing prints the read and process time of the server" << endl;
+    cout << endl << "Batch mode:" << endl;
+    cout << "\t --batch - processes all the bmp and pgm files from the directory or all the paths listed in the file (one per line)" << endl;
+    cout << "\t --threads - number of worker threads, default: number of hardware threads" << endl;
+    cout << "\t --read-ahead - number of decoded images waiting for the workers, default: 4" << endl;
+    cout << "\t --write-behind - number of processed images waiting to be saved, default: 4" << endl;
+    cout << "\t -o - path template, {name}, {ext}, {dir} and {index} are replaced with the input file name (without extension)," << endl;
+    cout << "\t      its extension, directory and index, fe. -o out/{name}_edges.{ext}" << endl;
 }
 
 /**
- * Exception that is thrown when filename was not passed via program arguments.
+ * Returns the next argument if there is any in the array or empty string.
+ * @param argv - array that will be checked.
+ * @param actualIndex - next index after this index will be checked.
+ * @param size_t - size of the array
+ * @return returns next argument or empty if nothing was found.
  */
-class NoFileNameException : std::exception {
-    const char * what () const noexcept override {
-        return "Mandatory filename parameter not passed to argument";
+std::string getNextArg(char * argv[], const int actualIndex, const int size_t) {
+    if (actualIndex + 1 < size_t) {
+        return argv[actualIndex + 1];
     }
-};
+
+    return "";
+}
 
 /**
- * Exception that is thrown when argument was not recognized.
+ * Finds the --profile flag (with its optional path) and removes it from the arguments,
+ * so it can be placed anywhere in the command.
+ * @param argc - number of arguments, it's decreased by the number of removed arguments
+ * @param argv - arguments array
+ * @return path where the trace should be saved or empty string if profiling wasn't requested
  */
-struct WrongArgument : std::exception {
-    const char * what() const noexcept override {
-        return "This argument is not supported by this program.";
+std::string extractProfileArgument(int & argc, char * argv[]) {
+    for (int argNum = 1; argNum < argc; argNum++) {
+        if (std::string(argv[argNum]) != "--profile") {
+            continue;
+        }
+
+        std::string path = "imgm_trace.json";
+        int removed = 1;
+        std::string next = getNextArg(argv, argNum, argc);
+        if (Pipeline::isParameter(next)) {
+            path = next;
+            removed++;
+        }
+
+        for (int i = argNum; i + removed < argc; i++) {
+            argv[i] = argv[i + removed];
+        }
+        argc -= removed;
+
+        return path;
     }
-};
+
+    return "";
+}
 
 /**
- * Exception that is thrown when argument has a parameter that is not supported by this program.
+ * Finds the flag with one parameter and removes both of them from the arguments.
+ * @param argc - number of arguments, it's decreased by the number of removed arguments
+ * @param argv - arguments array
+ * @param flag - flag to find
+ * @param value - parameter of the flag, empty if it's missing
+ * @return true if the flag was passed
  */
-struct UnsupportedTypeParameter : std::exception {
-    const char * what() const noexcept override {
-        return "Unsupported type method";
+bool extractOption(int & argc, char * argv[], const std::string & flag, std::string & value) {
+    for (int argNum = 1; argNum < argc; argNum++) {
+        if (argv[argNum] != flag) {
+            continue;
+        }
+
+        value = getNextArg(argv, argNum, argc);
+        int removed = Pipeline::isParameter(value) ? 2 : 1;
+        if (removed == 1) {
+            value.clear();
+        }
+
+        for (int i = argNum; i + removed < argc; i++) {
+            argv[i] = argv[i + removed];
+        }
+        argc -= removed;
+
+        return true;
     }
-};
+
+    return false;
+}
 
 /**
- * Exception thrown when there is a missing parameter in argument
+ * Finds the flag without parameters and removes it from the arguments.
+ * @param argc - number of arguments, it's decreased if the flag was found
+ * @param argv - arguments array
+ * @param flag - flag to find
+ * @return true if the flag was passed
  */
-struct MissingArgumentParameter : std::exception {
-    const char * what () const noexcept override {
-        return "Missing argument parameter";
+bool extractFlag(int & argc, char * argv[], const std::string & flag) {
+    for (int argNum = 1; argNum < argc; argNum++) {
+        if (argv[argNum] == flag) {
+            for (int i = argNum; i + 1 < argc; i++) {
+                argv[i] = argv[i + 1];
+            }
+            argc--;
+
+            return true;
+        }
     }
-};
+
+    return false;
+}
+
+/**
+ * Prints the problem with the pipeline step.
+ * @param exception - exception containing the step and the description
+ */
+void printStepException(const Pipeline::StepException & exception) {
+    std::cerr << "Argument exception: " << exception.step << std::endl;
+    std::cerr << "Description: " << exception.description << std::endl;
+}
 
 /**
- * Exception thrown when there is any problem with argument parameter.
+ * Batch mode - the pipeline is parsed once and executed on every input file by the pool of threads.
+ * @param argc - number of arguments
+ * @param argv - arguments array, argv[1] is --batch
+ * @param profiler - profiler measuring the whole batch
+ * @return 0 - if all the files were processed | -1 - wrong usage | -10 - problem with arguments
+ *         | -11 - problem with the input list or with at least one of the files
  */
-struct WrongArgumentParameter : std::exception {
-    const char * what () const noexcept override {
-        return "Bad argument parameter";
+int runBatch(int argc, char *argv[], Profiler & profiler) {
+    std::string source = getNextArg(argv, 1, argc);
+    if (!Pipeline::isParameter(source)) {
+        std::cerr << "Missing directory or list of files for the batch mode. See the program manual." << std::endl;
+        help();
+        return -1;
+    }
+
+    // batch options - the number of threads and the depths of the queues between the read, compute and write stage
+    int firstArgNum = 3;
+    int threads = 0;
+    int readDepth = (int) BatchProcessor::DEFAULT_QUEUE_DEPTH;
+    int writeDepth = (int) BatchProcessor::DEFAULT_QUEUE_DEPTH;
+    while (firstArgNum < argc) {
+        std::string option = argv[firstArgNum];
+        int * value = option == "--threads" ? &threads
+                    : option == "--read-ahead" ? &readDepth
+                    : option == "--write-behind" ? &writeDepth : nullptr;
+        if (value == nullptr) {
+            break;
+        }
+
+        try {
+            *value = std::stoi(getNextArg(argv, firstArgNum, argc));
+            if (*value < 0 || (*value == 0 && value != &threads)) {
+                throw Pipeline::WrongArgumentParameter();
+            }
+        } catch (std::exception &exception) {
+            printStepException(Pipeline::StepException(option, Pipeline::WrongArgumentParameter().what()));
+            return -10;
+        }
+        firstArgNum += 2;
     }
-};
+
+    std::unique_ptr<Pipeline> pipeline;
+    try {
+        pipeline.reset(new Pipeline(std::vector<std::string>(argv + std::min(firstArgNum, argc), argv + argc)));
+    } catch (Pipeline::StepException &exception) {
+        printStepException(exception);
+        return -10;
+    }
+
+    if (pipeline->isHelpRequested()) {
+        help();
+    }
+
+    try {
+        BatchProcessor processor(*pipeline, (unsigned) threads, (std::size_t) readDepth, (std::size_t) writeDepth);
+        std::vector<std::string> inputs = BatchProcessor::listInputs(source);
+
+        profiler.begin("batch " + source);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<BatchProcessor::FileResult> results = processor.process(inputs);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        profiler.end();
+
+        BatchProcessor::printReport(results, seconds, std::cerr);
+        for (const BatchProcessor::FileResult & result : results) {
+            if (!result.success) {
+                return -11;
+            }
+        }
+
+        return 0;
+    } catch (BatchProcessor::OutputTemplateException &exception) {
+        std::cerr << "Description: " << exception.what() << std::endl;
+        return -10;
+    } catch (std::exception &exception) {
+        std::cerr << "Description: " << exception.what() << std::endl;
+        return -11;
+    }
+}
 
 /**
- * Enum containing all the possible program arguments
+ * Reads the whole stream to the memory, in chunks.
+ * @param stream - stream to read
+ * @return content of the stream
  */
-enum Arguments {
-    INPUT_FILE,
-    OUTPUT,
-    RESOLUTION_CHANGE,
-    NEGATIVE,
-    BLUR,
-    DENOISE,
-    GRADIENT,
-    BINARY,
-    ERODE,
-    DILATE,
-    ROTATE,
-    HELP,
-    INVALID
-};
+std::vector<uint8_t> readAll(std::istream & stream) {
+    std::vector<uint8_t> data;
+    while (stream) {
+        std::size_t size = data.size();
+        data.resize(size + ImageReader::CHUNK_SIZE);
+        stream.read(reinterpret_cast<char *>(data.data() + size), (std::streamsize) ImageReader::CHUNK_SIZE);
+        data.resize(size + (std::size_t) stream.gcount());
+    }
+
+    return data;
+}
 
 /**
- * Function that gives the proper Argument by passed string.
- * @param argument - string that will be checked
- * @return - Proper Argument or invalid.
+ * Processes the image from the standard input (-i -), the format is detected by the first bytes.
+ * BMP needs to be read whole before decoding (the pixels are found by the offset from the header),
+ * PGM is decoded straight from the stream and the concatenated PGM images are processed one after another.
+ * @param pipeline - operations executed on every image
+ * @param threads - number of threads processing the PGM frames
+ * @param profiler - profiler measuring every image
+ * @param cache - if passed, the outputs are restored from it or stored to it (the input is read whole)
+ * @return 0 - if there was no problem | -1 - unsupported format | -10 - problem with arguments | -11 - problem with the data
  */
-Arguments stringToArgument(const std::string& argument) {
-    if (argument == "-i") return INPUT_FILE;
-    if (argument == "-o") return OUTPUT;
-    if (argument == "-e") return ERODE;
-    if (argument == "-rs") return RESOLUTION_CHANGE;
-    if (argument == "-n") return NEGATIVE;
-    if (argument == "-b") return BLUR;
-    if (argument == "-dn") return DENOISE;
-    if (argument == "-g") return GRADIENT;
-    if (argument == "-ib") return BINARY;
-    if (argument == "-e") return ERODE;
-    if (argument == "-d") return DILATE;
-    if (argument == "-r") return ROTATE;
-    if (argument == "-h") return HELP;
-
-    return INVALID;
+int runStandardInput(const Pipeline & pipeline, unsigned threads, Profiler & profiler, ResultCache * cache) {
+    std::istream & input = std::cin;
+    int first = input.peek();
+
+    try {
+        if (cache != nullptr && (first == 'B' || first == 'P')) {
+            std::vector<uint8_t> data = readAll(input);
+            cache->run(pipeline, data, first == 'B' ? "stdin.bmp" : "stdin.pgm", threads, &profiler);
+        } else if (first == 'B') {
+            profiler.begin("read stdin");
+            std::vector<uint8_t> data = readAll(input);
+            std::unique_ptr<Image> image(ImageFactory::decode(data.data(), data.size()));
+            profiler.setPixels((uint64_t) image->getWidth() * image->getHeight());
+            profiler.end();
+
+            pipeline.run(*image, "stdin.bmp", 0, &profiler);
+        } else if (first == 'P') {
+            FrameStream(input, pipeline, threads).run("stdin.pgm", &profiler);
+        } else {
+            std::cerr << "The data from the standard input is not BMP or PGM image." << std::endl;
+            return -1;
+        }
+    } catch (Pipeline::StepException &exception) {
+        printStepException(exception);
+        return -10;
+    } catch (std::exception &exception) {
+        std::cerr << "Description: " << exception.what() << std::endl;
+        return -11;
+    }
+
+    return 0;
 }
 
 /**
- * Checks if the toValidate is in the fe. -f format.
- * @param toValidate
- * @return bool - true if the parameter is in the correct form, false otherwise.
+ * Server mode - accepts the jobs until it's stopped.
+ * @param argc - number of arguments
+ * @param argv - arguments array, argv[1] is --serve
+ * @return 0 - if the server was stopped | -1 - wrong usage | -10 - problem with arguments | -11 - problem with the socket
  */
-bool wasParameterPassed(const std::string& toValidate) {
-    std::regex flagRegex("-.*");
-    if (!toValidate.empty() && !std::regex_match(toValidate, flagRegex)) {
-        return true;
+int runServer(int argc, char *argv[]) {
+    std::string socketPath = getNextArg(argv, 1, argc);
+    if (!Pipeline::isParameter(socketPath)) {
+        std::cerr << "Missing socket path for the server mode. See the program manual." << std::endl;
+        help();
+        return -1;
     }
 
-    return false;
+    unsigned threads = 0;
+    if (getNextArg(argv, 2, argc) == "--threads") {
+        try {
+            threads = (unsigned) std::max(0, std::stoi(getNextArg(argv, 3, argc)));
+        } catch (std::exception &exception) {
+            printStepException(Pipeline::StepException("--threads", Pipeline::WrongArgumentParameter().what()));
+            return -10;
+        }
+    }
+
+    try {
+        Server server(socketPath, threads);
+        std::cerr << "Listening on " << socketPath << std::endl;
+        server.run();
+    } catch (std::exception &exception) {
+        std::cerr << "Description: " << exception.what() << std::endl;
+        return -11;
+    }
+
+    return 0;
 }
 
 /**
- * Returns the next argument if there is any in the array or empty string.
- * @param argv - array that will be checked.
- * @param actualIndex - next index after this index will be checked.
- * @param size_t - size of the array
- * @return returns next argument or empty if nothing was found.
+ * Makes the path absolute, the server doesn't know the working directory of the client.
+ * @param path - path to convert
+ * @return absolute path
  */
-std::string getNextArg(char * argv[], const int actualIndex, const int size_t) {
-    if (actualIndex + 1 < size_t) {
-        return argv[actualIndex + 1];
+std::string toAbsolutePath(const std::string & path) {
+    if (path.empty() || path[0] == '/') {
+        return path;
     }
 
-    return "";
+    std::vector<char> directory(4096);
+    if (getcwd(directory.data(), directory.size()) == nullptr) {
+        return path;
+    }
+
+    return std::string(directory.data()) + "/" + path;
+}
+
+/**
+ * Checks if the argument is the optional path of the statistics after -cc (the connectivity can be before it).
+ * @param argv - arguments array
+ * @param argNum - index of the argument, at least 2
+ */
+bool isStatisticsPath(char *argv[], int argNum) {
+    std::string argument = argv[argNum];
+    std::string previous = argv[argNum - 1];
+    auto isNumber = [](const std::string & value) {
+        return !value.empty() && value.find_first_not_of("0123456789") == std::string::npos;
+    };
+    if (!Pipeline::isParameter(argument) || argument == "{") {
+        return false;
+    }
+
+    return previous == "-cc" ? !isNumber(argument) : isNumber(previous) && std::string(argv[argNum - 2]) == "-cc";
+}
+
+/**
+ * Client mode - sends the job to the server and reports the result like the single image mode.
+ * @param argc - number of arguments
+ * @param argv - arguments array, argv[1] is --client
+ * @return exit code of the job | -1 - wrong usage | -11 - problem with the connection
+ */
+int runClient(int argc, char *argv[]) {
+    bool timing = extractFlag(argc, argv, "--timing");
+
+    std::string socketPath = getNextArg(argv, 1, argc);
+    if (!Pipeline::isParameter(socketPath) || getNextArg(argv, 2, argc) != "-i") {
+        std::cerr << "Expected: imgm --client <socket> -i <file|-> <flags>. See the program manual." << std::endl;
+        help();
+        return -1;
+    }
+
+    JobProtocol::Request request;
+    for (int argNum = 3; argNum < argc; argNum++) {
+        std::string argument = argv[argNum];
+        std::string previous = argv[argNum - 1];
+        if (((previous == "-i" || previous == "-o") && argument != "-") || isStatisticsPath(argv, argNum)) {
+            argument = toAbsolutePath(argument);
+        }
+        request.arguments.push_back(argument);
+    }
+
+    if (getNextArg(argv, 3, argc) == Pipeline::STANDARD_STREAM) {
+        std::vector<uint8_t> data = readAll(std::cin);
+        request.data.assign(data.begin(), data.end());
+    }
+
+    JobProtocol::Response response{};
+    try {
+        int connection = JobProtocol::connectTo(socketPath);
+        try {
+            JobProtocol::writeRequest(connection, request);
+            response = JobProtocol::readResponse(connection);
+        } catch (std::exception &exception) {
+            close(connection);
+            throw;
+        }
+        close(connection);
+    } catch (std::exception &exception) {
+        std::cerr << "Description: " << exception.what() << std::endl;
+        return -11;
+    }
+
+    if (timing) {
+        std::cerr << "Server time: read " << response.readSeconds * 1000 << " ms, process "
+                  << response.processSeconds * 1000 << " ms" << std::endl;
+    }
+
+    if (response.code == 0) {
+        std::cout << "Done!";
+    } else if (response.code == -1) {
+        std::cerr << response.description << std::endl;
+        std::cerr << "See the program manual." << std::endl;
+        help();
+    } else if (!response.step.empty()) {
+        printStepException(Pipeline::StepException(response.step, response.description));
+    } else {
+        std::cerr << "Description: " << response.description << std::endl;
+    }
+
+    return response.code;
 }
 
 /**
@@ -152,6 +487,57 @@ std::string getNextArg(char * argv[], const int actualIndex, const int size_t) {
 int main(int argc, char *argv[]) {
     using std::cout; using std::endl;
 
+    bool hardwareCounters = extractFlag(argc, argv, "--perf");
+    std::string tracePath = extractProfileArgument(argc, argv);
+    if (hardwareCounters && tracePath.empty()) {
+        tracePath = "imgm_trace.json";
+    }
+    Profiler profiler(!tracePath.empty(), hardwareCounters);
+
+    std::string cacheDirectory;
+    std::string cacheSize = std::to_string(ResultCache::DEFAULT_SIZE_LIMIT / (1024 * 1024));
+    bool cacheRequested = extractOption(argc, argv, "--cache", cacheDirectory);
+    if ((cacheRequested && cacheDirectory.empty()) ||
+        (extractOption(argc, argv, "--cache-size", cacheSize) && cacheSize.empty())) {
+        printStepException(Pipeline::StepException("--cache", Pipeline::MissingArgumentParameter().what()));
+        return -10;
+    }
+    bool cacheStages = extractFlag(argc, argv, "--cache-stages");
+
+    std::string simdLevel;
+    if (extractOption(argc, argv, "--simd", simdLevel)) {
+        try {
+            if (!Simd::setLevel(Simd::parseLevel(simdLevel))) {
+                std::cerr << "The processor doesn't support " << simdLevel << ", the best supported level is "
+                          << Simd::getLevelName(Simd::detectLevel()) << "." << std::endl;
+                return -10;
+            }
+        } catch (Simd::UnknownLevelException &exception) {
+            printStepException(Pipeline::StepException("--simd", exception.what()));
+            return -10;
+        }
+    }
+
+    std::string bmpLayout;
+    if (extractOption(argc, argv, "--bmp-layout", bmpLayout)) {
+        try {
+            BmpImage::setDefaultLayout(BmpImage::parseLayout(bmpLayout));
+        } catch (BmpImage::UnknownLayoutException &exception) {
+            printStepException(Pipeline::StepException("--bmp-layout", exception.what()));
+            return -10;
+        }
+    }
+
+    std::string convolutionMethod;
+    if (extractOption(argc, argv, "--convolution", convolutionMethod)) {
+        try {
+            Convolution::setMethod(Convolution::parseMethod(convolutionMethod));
+        } catch (Convolution::UnknownMethodException &exception) {
+            printStepException(Pipeline::StepException("--convolution", exception.what()));
+            return -10;
+        }
+    }
+
     // if there is no command line arguments passed then display the program manual.
     if (argc < 2) {
         help();
@@ -162,180 +548,128 @@ int main(int argc, char *argv[]) {
     if (firstArg == "-h") {
         help();
         return 0;
+    } else if (firstArg == "--serve") {
+        return runServer(argc, argv);
+    } else if (firstArg == "--client") {
+        return runClient(argc, argv);
+    } else if (firstArg == "--batch") {
+        int result = runBatch(argc, argv, profiler);
+        if (profiler.isEnabled()) {
+            profiler.printSummary(std::cerr);
+            profiler.saveTrace(tracePath);
+        }
+        return result;
     } else if (firstArg != "-i") {
         cout << "Wrong argument! See the program manual:" << endl;
         help();
         return -1;
     }
 
-    std::regex bmpRegexFile(".*.bmp");
-    std::regex pgmRegexFile(".*.pgm");
-
-    Image* image;
+    // PGM inputs can contain many frames, they can be processed by more threads
+    int firstArgNum = 3;
+    unsigned threads = 1;
+    if (getNextArg(argv, 2, argc) == "--threads") {
+        try {
+            threads = (unsigned) std::max(0, std::stoi(getNextArg(argv, 3, argc)));
+        } catch (std::exception &exception) {
+            printStepException(Pipeline::StepException("--threads", Pipeline::WrongArgumentParameter().what()));
+            std::exit(-10);
+        }
+        firstArgNum = 5;
+    }
 
+    std::unique_ptr<Pipeline> pipeline;
     try {
-        std::fstream file;
-        if (std::regex_match(argv[2], bmpRegexFile)) {
-            file = std::fstream(argv[2], std::ios::in | std::ios::binary);
-            image = new BmpImage(file);
-        } else if (std::regex_match(argv[2], pgmRegexFile)) {
-            file = std::fstream(argv[2], std::ios::in | std::ios::binary);
-            image = new PgmImage(file);
-        } else {
-            std::cerr << "Wrong filename format or the file format is not supported by this program." << endl;
-            std::cerr << "See the program manual." << endl;
-            help();
-            return -1;
+        pipeline.reset(new Pipeline(std::vector<std::string>(argv + std::min(firstArgNum, argc), argv + argc)));
+    } catch (Pipeline::StepException &exception) {
+        printStepException(exception);
+        std::exit(-10);
+    }
+
+    if (pipeline->isHelpRequested()) {
+        help();
+    }
+
+    // messages can't be mixed with the image written to the standard output
+    std::ostream & messages = pipeline->writesToStandardOutput() ? std::cerr : std::cout;
+
+    std::unique_ptr<ResultCache> cache;
+    if (cacheRequested && ResultCache::isCacheable(*pipeline)) {
+        try {
+            int megabytes = std::stoi(cacheSize);
+            if (megabytes < 0) {
+                throw Pipeline::WrongArgumentParameter();
+            }
+            cache.reset(new ResultCache(cacheDirectory, (std::size_t) megabytes * 1024 * 1024, cacheStages));
+        } catch (ResultCache::CacheDirectoryException &exception) {
+            std::cerr << "Description: " << exception.what() << endl;
+            return -11;
+        } catch (std::exception &exception) {
+            printStepException(Pipeline::StepException("--cache-size", Pipeline::WrongArgumentParameter().what()));
+            return -10;
+        }
+    }
+
+    std::string input = getNextArg(argv, 1, argc);
+    if (input == Pipeline::STANDARD_STREAM) {
+        int result = runStandardInput(*pipeline, threads, profiler, cache.get());
+        if (result == 0) {
+            messages << "Done!";
+        }
+        if (profiler.isEnabled()) {
+            messages << endl;
+            profiler.printSummary(std::cerr);
+            profiler.saveTrace(tracePath);
         }
+        return result;
+    }
 
-        image->read();
+    ImageFactory::Format format = ImageFactory::detectFormat(input);
+    if (format == ImageFactory::UNKNOWN) {
+        std::cerr << "Wrong filename format or the file format is not supported by this program." << endl;
+        std::cerr << "See the program manual." << endl;
+        help();
+        return -1;
+    }
+
+    try {
+        profiler.begin("open " + input);
+        std::fstream file(input, std::ios::in | std::ios::binary);
+        profiler.end();
 
-        std::string arg;
         try {
-            for (int argNum = 3; argNum < argc; argNum++) {
-                arg = argv[argNum];
-                switch (stringToArgument(arg)) {
-                    case OUTPUT: {
-                        std::string filename = getNextArg(argv, argNum, argc);
-                        if (wasParameterPassed(filename)) {
-                            image->save(filename);
-                        } else {
-                            throw NoFileNameException();
-                        }
-                        argNum++;
-                        break;
-                    }
-                    case RESOLUTION_CHANGE: {
-                        int tempArgNum = argNum;
-                        std::string x = getNextArg(argv, tempArgNum, argc);
-                        tempArgNum++;
-                        std::string y = getNextArg(argv, tempArgNum, argc);
-                        tempArgNum++;
-
-                        if (!wasParameterPassed(x) || !wasParameterPassed(y)) {
-                            throw MissingArgumentParameter();
-                        }
-
-                        int xInt, yInt;
-                        try {
-                            xInt = std::stoi(x);
-                            yInt = std::stoi(y);
-                        } catch (std::exception &ex) {
-                            throw WrongArgumentParameter();
-                        }
-
-                        image->scale(xInt, yInt);
-                        argNum = tempArgNum;
-
-                        break;
-                    }
-                    case NEGATIVE:
-                        image->toNegative();
-                        break;
-                    case BLUR: {
-                        std::string type = getNextArg(argv, argNum, argc);
-                        if (wasParameterPassed(type)) {
-                            int typeInt;
-                            try {
-                                typeInt = std::stoi(type);
-                            } catch (std::exception &exception) {
-                                throw WrongArgumentParameter();
-                            }
-
-                            if (typeInt == 1) {
-                                image->blur();
-                                argNum++;
-                            } else {
-                                throw UnsupportedTypeParameter();
-                            }
-                        } else {
-                            throw MissingArgumentParameter();
-                        }
-                        break;
-                    }
-                    case DENOISE: {
-                        std::string size = getNextArg(argv, argNum, argc);
-                        argNum++;
-                        image->denoise(std::stoi(size));
-                        break;
-                    }
-                    case GRADIENT: {
-                        std::string type = getNextArg(argv, argNum, argc);
-                        argNum++;
-
-                        if (!wasParameterPassed(type)) {
-                            throw MissingArgumentParameter();
-                        }
-
-                        if (std::stoi(type) == 1) {
-                            image->edgeFilter();
-                        } else {
-                            throw UnsupportedTypeParameter();
-                        }
-
-                        break;
-                    }
-                    case BINARY: {
-                        std::string threshold = getNextArg(argv, argNum, argc);
-                        if (wasParameterPassed(threshold)) {
-                            int thresholdInt;
-                            try {
-                                thresholdInt = std::stoi(threshold);
-                            } catch (std::exception &exception) {
-                                throw WrongArgumentParameter();
-                            }
-
-                            image->toBinary(thresholdInt);
-                        } else {
-                            throw MissingArgumentParameter();
-                        }
-                        argNum++;
-                        break;
-                    }
-                    case ERODE:
-                        image->erode();
-                        break;
-                    case DILATE:
-                        image->dilate();
-                        break;
-                    case ROTATE: {
-                        std::string degree = getNextArg(argv, argNum, argc);
-                        if (wasParameterPassed(degree)) {
-                            float rotationDegree;
-                            try {
-                                rotationDegree = std::stof(degree);
-                            } catch (std::exception &e) {
-                                throw WrongArgumentParameter();
-                            }
-
-                            image->rotate(rotationDegree);
-                            argNum++;
-                        }
-
-                        break;
-                    }
-                    case HELP:
-                        help();
-                        break;
-                    case INVALID:
-                    default: {
-                        throw WrongArgument();
-                    }
+            if (cache != nullptr) {
+                if (!file) {
+                    throw ImageReader::OpeningTheFileException();
                 }
+                cache->run(*pipeline, readAll(file), input, threads, &profiler);
+            } else if (format == ImageFactory::PGM) {
+                FrameStream(file, *pipeline, threads).run(input, &profiler);
+            } else {
+                std::unique_ptr<Image> image(ImageFactory::create(format, file));
+                profiler.begin("read");
+                image->read();
+                profiler.setPixels((uint64_t) image->getWidth() * image->getHeight());
+                profiler.end();
+
+                pipeline->run(*image, input, 0, &profiler);
             }
+        } catch (Pipeline::StepException &exception) {
+            printStepException(exception);
+            std::exit(-10);
+        }
 
-            std::cout << "Done!";
+        messages << "Done!";
 
-            return 0;
-        } catch (std::exception &exception) {
-            std::cerr << "Argument exception: " << arg << std::endl;
-            std::cerr << "Description: " << exception.what() << std::endl;
-            std::exit(-10);
+        if (profiler.isEnabled()) {
+            messages << endl;
+            profiler.printSummary(std::cerr);
+            profiler.saveTrace(tracePath);
         }
+
+        return 0;
     } catch (std::exception &exception) {
         std::cerr << "Description: " << exception.what() << std::endl;
         std::exit(-11);
     }
-
-    return -1;
 }
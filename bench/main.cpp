@@ -0,0 +1,518 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+#include "PgmImage.h"
+#include "BmpImage.h"
+#include "Convolution.h"
+#include "PerfCounters.h"
+#include "Simd.h"
+
+/**
+ * Displays the help message.
+ */
+void help() {
+    using std::cout; using std::endl;
+
+    cout << "Benchmarks every image operation on synthetic BMP and PGM images." << endl << endl;
+    cout << "Format: imgm_bench [--sizes <mp,mp,...>] [--formats <bmp,pgm>] [--ops <op,op,...>] [--repeat <n>]"
+            " [--dir <path>] [--json <file>] [--perf] [--simd <level>] [--bmp-layout <layout>]"
+            " [--convolution <method>]" << endl << endl;
+    cout << "Flags supported:" << endl;
+    cout << "\t --sizes - image sizes in megapixels, default: 1,10,100" << endl;
+    cout << "\t --formats - formats that will be benchmarked, default: bmp,pgm" << endl;
+    cout << "\t --ops - operations that will be benchmarked, default: all of them" << endl;
+    cout << "\t --repeat - how many times every operation is repeated, the best time is reported, default: 1" << endl;
+    cout << "\t --dir - directory for the generated images, default: the current directory" << endl;
+    cout << "\t --json - path where the results will be saved in the JSON format" << endl;
+    cout << "\t --perf - reports the hardware counters (IPC, cache and branch misses) next to the throughput" << endl;
+    cout << "\t --simd - instruction set of the pixel kernels: scalar, sse4.1, avx2 or avx512, default: the best one"
+         << endl;
+    cout << "\t --bmp-layout - layout of the BMP pixels in the memory: bgr, planar or bgrx, default: bgr" << endl;
+    cout << "\t --convolution - method of the kernel operations: direct, fft or auto, default: auto" << endl;
+    cout << "\t -h - this help message" << endl << endl;
+    cout << "Operations: read, save, blur, toBinary, erode, dilate, erodeDilate, open, tophat, erodeDisk3, erodeDisk50, "
+            "components, toNegative, scaleUp, scaleDown, edgeFilter, denoise, rotate, sharpen, scharr, kernel5x5, kernel15x15, "
+            "kernel31x31, kernel63x63, histogram, toBinaryOtsu, bradley, sauvola, equalize, stretch" << endl;
+}
+
+/**
+ * Single measurement of the operation.
+ */
+struct Result {
+    std::string format;
+    int width;
+    int height;
+    std::string operation;
+    double seconds;
+    long peakRssKb;
+    PerfCounters::Values counters;
+};
+
+/**
+ * Operation that can be benchmarked.
+ * Prepare is executed on the freshly read image before the timer starts, run is the measured part.
+ */
+struct Operation {
+    std::string name;
+    std::function<void(Image &)> prepare;
+    std::function<void(Image &)> run;
+};
+
+/**
+ * Splits the comma separated list.
+ * @param list - list to split
+ * @return vector of the values
+ */
+std::vector<std::string> split(const std::string & list) {
+    std::vector<std::string> values;
+    std::stringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        if (!value.empty()) {
+            values.push_back(value);
+        }
+    }
+
+    return values;
+}
+
+/**
+ * Resets the peak resident set size of the process, so the next measurement is not affected by the previous one.
+ * Works only on Linux - on other systems the peak of the whole process is reported.
+ */
+void resetPeakRss() {
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    if (clearRefs) {
+        clearRefs << "5";
+    }
+}
+
+/**
+ * Returns the peak resident set size (in kilobytes) since the last reset.
+ * @return long - peak RSS
+ */
+long getPeakRss() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stol(line.substr(6));
+        }
+    }
+
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * Returns the value of the synthetic image at the given position.
+ * Gradient with deterministic noise - it gives the median filter and the thresholding some real work.
+ */
+uint8_t syntheticValue(int x, int y, int width, int height, int channel) {
+    uint32_t hash = (uint32_t) x * 73856093u ^ (uint32_t) y * 19349663u ^ (uint32_t) channel * 83492791u;
+    hash ^= hash >> 13;
+    hash *= 0x5bd1e995u;
+    hash ^= hash >> 15;
+
+    int gradient = (int) ((double) x / width * 127 + (double) y / height * 127);
+    return (uint8_t) std::min(255, gradient + (int) (hash % 32));
+}
+
+/**
+ * Writes the synthetic 24 bit BMP image.
+ * @param path - where the image will be saved
+ */
+void generateBmp(const std::string & path, int width, int height) {
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+
+    std::size_t rowSize = ((std::size_t) width * 3 + 3) / 4 * 4;
+    uint64_t imageSize = rowSize * height;
+    uint64_t fileSize = 54 + imageSize;
+
+    uint8_t header[54] = {'B', 'M'};
+    auto put32 = [&header](int offset, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            header[offset + i] = (uint8_t) (value >> (8 * i));
+        }
+    };
+    put32(2, fileSize > UINT32_MAX ? 0 : (uint32_t) fileSize);
+    put32(10, 54);
+    put32(14, 40);
+    put32(18, (uint32_t) width);
+    put32(22, (uint32_t) height);
+    header[26] = 1;
+    header[28] = 24;
+    put32(34, imageSize > UINT32_MAX ? 0 : (uint32_t) imageSize);
+    file.write(reinterpret_cast<char *>(header), sizeof(header));
+
+    std::vector<char> row(rowSize, 0);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            for (int channel = 0; channel < 3; channel++) {
+                row[x * 3 + channel] = (char) syntheticValue(x, y, width, height, channel);
+            }
+        }
+        file.write(row.data(), (std::streamsize) rowSize);
+    }
+}
+
+/**
+ * Writes the synthetic PGM (P5) image.
+ * @param path - where the image will be saved
+ */
+void generatePgm(const std::string & path, int width, int height) {
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    file << "P5 " << width << " " << height << " 255 ";
+
+    std::vector<char> row(width);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            row[x] = (char) syntheticValue(x, y, width, height, 0);
+        }
+        file.write(row.data(), width);
+    }
+}
+
+/**
+ * Reads the image from the file.
+ * @param format - bmp or pgm
+ * @param file - opened file stream, it has to live as long as the image
+ * @return Image * - read image
+ */
+Image * readImage(const std::string & format, std::fstream & file) {
+    Image * image;
+    if (format == "bmp") {
+        image = new BmpImage(file);
+    } else {
+        image = new PgmImage(file);
+    }
+    image->read();
+
+    return image;
+}
+
+/**
+ * Measures the wall time of the function.
+ * @param perfCounters - if passed, the difference of the counters is stored in the counters parameter
+ * @param counters - hardware counters of the function
+ * @return double - time in seconds
+ */
+double measure(const std::function<void()> & function, const PerfCounters * perfCounters = nullptr,
+               PerfCounters::Values * counters = nullptr) {
+    PerfCounters::Values before{};
+    if (perfCounters != nullptr) {
+        before = perfCounters->read();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto stop = std::chrono::steady_clock::now();
+
+    if (perfCounters != nullptr) {
+        *counters = perfCounters->read() - before;
+    }
+
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+/**
+ * Prints the value or n/a if it's negative (can't be calculated).
+ */
+void printMetric(std::ostream & stream, int width, double value) {
+    if (value < 0) {
+        stream << std::setw(width) << "n/a";
+    } else {
+        stream << std::setw(width) << value;
+    }
+}
+
+/**
+ * Prints one result as the row of the table.
+ */
+void printResult(const Result & result) {
+    double pixels = (double) result.width * result.height;
+    std::cout << std::left << std::setw(5) << result.format
+              << std::right << std::setw(8) << std::fixed << std::setprecision(1) << pixels / 1e6 << " MP  "
+              << std::left << std::setw(12) << result.operation
+              << std::right << std::setw(12) << std::setprecision(4) << result.seconds << " s"
+              << std::setw(12) << std::setprecision(2) << pixels / 1e6 / result.seconds << " MP/s"
+              << std::setw(12) << std::setprecision(2) << result.seconds * 1e9 / pixels << " ns/px"
+              << std::setw(12) << result.peakRssKb << " KB";
+
+    if (result.counters.available[PerfCounters::CYCLES] || result.counters.available[PerfCounters::CACHE_MISSES]) {
+        std::cout << "  IPC";
+        printMetric(std::cout, 6, result.counters.getIpc());
+        std::cout << "  cache-miss %";
+        printMetric(std::cout, 7, result.counters.getCacheMissRate());
+        std::cout << "  branch-miss %";
+        printMetric(std::cout, 6, result.counters.getBranchMissRate());
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * Saves the results in the JSON format - one result per line, so they can be diffed between commits.
+ */
+void saveJson(const std::string & path, const std::vector<Result> & results) {
+    std::ofstream file(path);
+    file << "{" << std::endl << "  \"results\": [" << std::endl;
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const Result & result = results[i];
+        double pixels = (double) result.width * result.height;
+        file << "    {\"format\": \"" << result.format << "\", \"width\": " << result.width
+             << ", \"height\": " << result.height << ", \"operation\": \"" << result.operation << "\""
+             << std::fixed << std::setprecision(6) << ", \"seconds\": " << result.seconds
+             << std::setprecision(3) << ", \"mp_per_s\": " << pixels / 1e6 / result.seconds
+             << ", \"ns_per_pixel\": " << result.seconds * 1e9 / pixels
+             << ", \"peak_rss_kb\": " << result.peakRssKb;
+        for (int counter = 0; counter < PerfCounters::COUNTERS_COUNT; counter++) {
+            if (result.counters.available[counter]) {
+                file << ", \"" << PerfCounters::getName((PerfCounters::Counter) counter) << "\": "
+                     << result.counters.values[counter];
+            }
+        }
+        file << "}"
+             << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    file << "  ]" << std::endl << "}" << std::endl;
+}
+
+/**
+ * Creates the kernel of the disk (the defocus blur) - it's not separable, so the direct convolution
+ * needs all its taps.
+ */
+Convolution::KernelMatrix createDiskKernel(int radius) {
+    std::vector<int> weights;
+    for (int y = -radius; y <= radius; y++) {
+        for (int x = -radius; x <= radius; x++) {
+            weights.push_back(x * x + y * y <= radius * radius ? 1 : 0);
+        }
+    }
+
+    return Convolution::KernelMatrix(weights);
+}
+
+/**
+ * Returns all the operations that can be benchmarked (read and save are handled separately).
+ */
+std::vector<Operation> getOperations(int width, int height) {
+    auto nothing = [](Image &) {};
+    auto binary = [](Image & image) { image.toBinary(128); };
+    Convolution::Border clamp{Convolution::CLAMP, 0};
+    Convolution::KernelMatrix gaussian({1, 4, 6, 4, 1, 4, 16, 24, 16, 4, 6, 24, 36, 24, 6, 4, 16, 24, 16, 4,
+                                        1, 4, 6, 4, 1});
+
+    return {
+            {"blur", nothing, [](Image & image) { image.blur(); }},
+            {"toBinary", nothing, binary},
+            {"erode", binary, [](Image & image) { image.erode(); }},
+            {"dilate", binary, [](Image & image) { image.dilate(); }},
+            {"erodeDilate", binary, [](Image & image) { image.erode(); image.dilate(); }},
+            {"open", binary, [](Image & image) { image.morphology(Morphology::OPENING); }},
+            {"tophat", binary, [](Image & image) { image.morphology(Morphology::TOP_HAT); }},
+            {"erodeDisk3", binary, [](Image & image) { image.erodeDisk(3); }},
+            {"erodeDisk50", binary, [](Image & image) { image.erodeDisk(50); }},
+            {"components", binary, [](Image & image) { image.labelComponents(ConnectedComponents::EIGHT); }},
+            {"toNegative", nothing, [](Image & image) { image.toNegative(); }},
+            {"scaleUp", nothing, [width, height](Image & image) { image.scaleUp(width * 2, height * 2); }},
+            {"scaleDown", nothing, [width, height](Image & image) { image.scaleDown(width / 2, height / 2); }},
+            {"edgeFilter", nothing, [](Image & image) { image.edgeFilter(); }},
+            {"denoise", nothing, [](Image & image) { image.denoise(3); }},
+            {"rotate", nothing, [](Image & image) { image.rotate(30); }},
+            {"sharpen", nothing, [clamp](Image & image) { image.filter(ImageProcessing::SHARPEN, clamp); }},
+            {"scharr", nothing, [clamp](Image & image) { image.filter(ImageProcessing::SCHARR, clamp); }},
+            {"kernel5x5", nothing, [clamp, gaussian](Image & image) { image.convolve(gaussian, clamp); }},
+            {"kernel15x15", nothing, [clamp](Image & image) { image.convolve(createDiskKernel(7), clamp); }},
+            {"kernel31x31", nothing, [clamp](Image & image) { image.convolve(createDiskKernel(15), clamp); }},
+            {"kernel63x63", nothing, [clamp](Image & image) { image.convolve(createDiskKernel(31), clamp); }},
+            {"histogram", nothing, [](Image & image) { image.getHistogram(0).getOtsuThreshold(); }},
+            {"toBinaryOtsu", nothing, [](Image & image) { image.toBinary(ImageProcessing::OTSU); }},
+            {"bradley", nothing, [](Image & image) { image.toBinary(AdaptiveThreshold::BRADLEY, 15, 15); }},
+            {"sauvola", nothing, [](Image & image) { image.toBinary(AdaptiveThreshold::SAUVOLA, 15, 50); }},
+            {"equalize", nothing, [](Image & image) { image.equalize(); }},
+            {"stretch", nothing, [](Image & image) { image.stretchContrast(1); }},
+    };
+}
+
+/**
+ * Benchmark entry point - generates the images and measures every selected operation on them.
+ * @return 0 - if everything went fine | -1 - problem with arguments | -11 - problem with the images
+ */
+int main(int argc, char *argv[]) {
+    std::vector<std::string> sizes = {"1", "10", "100"};
+    std::vector<std::string> formats = {"bmp", "pgm"};
+    std::vector<std::string> selected;
+    std::string directory = ".";
+    std::string jsonPath;
+    int repeat = 1;
+    std::unique_ptr<PerfCounters> perfCounters;
+
+    for (int argNum = 1; argNum < argc; argNum++) {
+        std::string arg = argv[argNum];
+        if (arg == "-h") {
+            help();
+            return 0;
+        }
+        if (arg == "--perf") {
+            perfCounters.reset(new PerfCounters());
+            if (!perfCounters->getErrorMessage().empty()) {
+                std::cerr << "Hardware counters are not fully available - " << perfCounters->getErrorMessage()
+                          << std::endl;
+            }
+            continue;
+        }
+        if (argNum + 1 >= argc) {
+            help();
+            return -1;
+        }
+
+        std::string value = argv[++argNum];
+        if (arg == "--sizes") {
+            sizes = split(value);
+        } else if (arg == "--formats") {
+            formats = split(value);
+        } else if (arg == "--ops") {
+            selected = split(value);
+        } else if (arg == "--repeat") {
+            repeat = std::max(1, std::stoi(value));
+        } else if (arg == "--dir") {
+            directory = value;
+        } else if (arg == "--json") {
+            jsonPath = value;
+        } else if (arg == "--simd") {
+            try {
+                if (!Simd::setLevel(Simd::parseLevel(value))) {
+                    std::cerr << "The processor doesn't support " << value << std::endl;
+                    return -1;
+                }
+            } catch (Simd::UnknownLevelException & exception) {
+                std::cerr << exception.what() << std::endl;
+                return -1;
+            }
+        } else if (arg == "--convolution") {
+            try {
+                Convolution::setMethod(Convolution::parseMethod(value));
+            } catch (Convolution::UnknownMethodException & exception) {
+                std::cerr << exception.what() << std::endl;
+                return -1;
+            }
+        } else if (arg == "--bmp-layout") {
+            try {
+                BmpImage::setDefaultLayout(BmpImage::parseLayout(value));
+            } catch (BmpImage::UnknownLayoutException & exception) {
+                std::cerr << exception.what() << std::endl;
+                return -1;
+            }
+        } else {
+            help();
+            return -1;
+        }
+    }
+
+    auto isSelected = [&selected](const std::string & name) {
+        return selected.empty() || std::find(selected.begin(), selected.end(), name) != selected.end();
+    };
+
+    std::vector<Result> results;
+    try {
+        for (const std::string & size : sizes) {
+            double megapixels = std::stod(size);
+            int width = (int) std::lround(std::sqrt(megapixels * 1e6 * 4 / 3));
+            int height = (int) std::lround(megapixels * 1e6 / width);
+
+            for (const std::string & format : formats) {
+                std::string input = directory + "/imgm_bench_input." + format;
+                std::string output = directory + "/imgm_bench_output." + format;
+                if (format == "bmp") {
+                    generateBmp(input, width, height);
+                } else if (format == "pgm") {
+                    generatePgm(input, width, height);
+                } else {
+                    help();
+                    return -1;
+                }
+
+                auto record = [&](const std::string & name, double seconds, const PerfCounters::Values & counters) {
+                    Result result{format, width, height, name, seconds, getPeakRss(), counters};
+                    printResult(result);
+                    results.push_back(result);
+                };
+
+                if (isSelected("read") || isSelected("save")) {
+                    double readTime = 0, saveTime = 0;
+                    PerfCounters::Values readCounters{}, saveCounters{}, counters{};
+                    for (int i = 0; i < repeat; i++) {
+                        resetPeakRss();
+                        std::fstream file(input, std::ios::in | std::ios::binary);
+                        Image * image = nullptr;
+                        double time = measure([&] { image = readImage(format, file); }, perfCounters.get(), &counters);
+                        if (i == 0 || time < readTime) {
+                            readTime = time;
+                            readCounters = counters;
+                        }
+
+                        time = measure([&] { image->save(output); }, perfCounters.get(), &counters);
+                        if (i == 0 || time < saveTime) {
+                            saveTime = time;
+                            saveCounters = counters;
+                        }
+                        delete image;
+                    }
+
+                    if (isSelected("read")) {
+                        record("read", readTime, readCounters);
+                    }
+                    if (isSelected("save")) {
+                        record("save", saveTime, saveCounters);
+                    }
+                }
+
+                for (const Operation & operation : getOperations(width, height)) {
+                    if (!isSelected(operation.name)) {
+                        continue;
+                    }
+
+                    double best = 0;
+                    PerfCounters::Values bestCounters{}, counters{};
+                    for (int i = 0; i < repeat; i++) {
+                        std::fstream file(input, std::ios::in | std::ios::binary);
+                        Image * image = readImage(format, file);
+                        operation.prepare(*image);
+
+                        resetPeakRss();
+                        double time = measure([&] { operation.run(*image); }, perfCounters.get(), &counters);
+                        if (i == 0 || time < best) {
+                            best = time;
+                            bestCounters = counters;
+                        }
+                        delete image;
+                    }
+                    record(operation.name, best, bestCounters);
+                }
+
+                std::remove(input.c_str());
+                std::remove(output.c_str());
+            }
+        }
+    } catch (std::exception &exception) {
+        std::cerr << "Description: " << exception.what() << std::endl;
+        return -11;
+    }
+
+    if (!jsonPath.empty()) {
+        saveJson(jsonPath, results);
+    }
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+#ifndef ADAPTIVETHRESHOLD_H
+#define ADAPTIVETHRESHOLD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <vector>
+
+/**
+ * Local threshold of the grayscale image - every pixel is compared with the statistics of the square window around it,
+ * so the unevenly lit images (fe. the scanned documents) are not split by one global value. The sums of the windows
+ * are read from the summed-area tables of the values and of their squares, so the cost of one pixel doesn't depend
+ * on the size of the window. The image is split to the tiles, every tile has its own table (it covers the tile
+ * and the radius around it, so it stays in the cache) and the bands of the tiles of the big images are spread
+ * between the threads.
+ */
+class AdaptiveThreshold {
+public:
+    /**
+     * Bradley - the pixel is the background if it's brighter than the mean of its window minus the percent of it.
+     * Sauvola - the threshold is mean * (1 + k * (deviation / R - 1)), R is the half of the range of the values,
+     * so the windows with the small contrast (the empty paper) are the background.
+     */
+    enum Method {
+        BRADLEY,
+        SAUVOLA
+    };
+
+    /**
+     * Radius of the window used when no radius is given (31 x 31 pixels, about the height of the printed line).
+     */
+    static const int DEFAULT_RADIUS = 15;
+
+    /**
+     * Returns the sensitivity used when no sensitivity is given - 15 % for Bradley, k = 0.5 for Sauvola.
+     */
+    static int getDefaultPercent(Method method);
+
+    /**
+     * Creates the binary mask of the grayscale values.
+     * @param values - first value of the grayscale image
+     * @param step - distance of the values (number of the interleaved channels)
+     * @param mask - width * height values, 0 for the dark pixels, maxValue for the others
+     * @param width - width of the image
+     * @param height - height of the image
+     * @param method - method of the threshold
+     * @param radius - radius of the window, at least 1
+     * @param percent - sensitivity in percent (0 - 100), Bradley's percent or Sauvola's k * 100
+     * @param maxValue - maximal value of the image
+     */
+    static void apply(const uint8_t * values, std::size_t step, uint8_t * mask, int width, int height, Method method,
+                      int radius, int percent, uint8_t maxValue);
+
+    /**
+     * Exception thrown when the radius or the sensitivity is out of its range.
+     */
+    struct InvalidParameterException : std::exception {
+        const char * what() const noexcept override {
+            return "The radius of the window must be at least 1 and the sensitivity must be 0 - 100.";
+        }
+    };
+
+private:
+    /**
+     * Summed-area tables of one rectangle - the value at [y][x] is the sum of all the values of the rectangle
+     * above and left of it.
+     */
+    class IntegralImage {
+    public:
+        /**
+         * Sums the rectangle (the rows and the columns are inclusive), the memory of the previous one is reused.
+         * @param width - width of the image
+         * @param squares - true if the table of the squares is needed too
+         */
+        void build(const uint8_t * values, std::size_t step, int width, int firstRow, int lastRow, int firstColumn,
+                   int lastColumn, bool squares);
+
+        /**
+         * Sums the rows top - bottom (inclusive, in the rows of the image) - the value x is the sum of the values
+         * of the columns of the rectangle before its column x, so the sum of the columns left - right
+         * is [right + 1] - [left].
+         * @param sums - columns + 1 sums of the values
+         * @param squareSums - columns + 1 sums of the squares, nullptr if they are not needed
+         */
+        void sumRows(int top, int bottom, uint64_t * sums, uint64_t * squareSums) const;
+
+    private:
+        int firstRow = 0;
+        std::size_t rowSize = 0;
+        std::vector<uint64_t> sums;
+        std::vector<uint64_t> squareSums;
+    };
+
+    /**
+     * Thresholds the tile (the last row and column are exclusive), the table is built for it and its windows.
+     */
+    static void applyTile(IntegralImage & integral, const uint8_t * values, std::size_t step, uint8_t * mask,
+                          int width, int height, int firstRow, int lastRow, int firstColumn, int lastColumn,
+                          Method method, int radius, int percent, uint8_t maxValue);
+};
+
+#endif //ADAPTIVETHRESHOLD_H
@@ -0,0 +1,131 @@
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Pipeline.h"
+
+/**
+ * Executes one pipeline on many input files. Files flow through three overlapping stages connected by
+ * the bounded queues: the reader decodes the next files, the workers of the work stealing thread pool execute
+ * the operations and the writer saves the results. While one file is computed the next one is already read
+ * and the previous one is written, so the throughput is limited by the slowest stage and not by the sum of them.
+ * Every worker reuses its pixel arrays between the files (BufferPool) and every file gets its own result,
+ * so one broken file doesn't stop the others.
+ */
+class BatchProcessor {
+public:
+    /**
+     * Maximal number of bytes of the pixel arrays kept for reuse by all the workers together.
+     */
+    static const std::size_t BUFFER_POOL_BYTES = 512 * 1024 * 1024;
+
+    /**
+     * Default number of decoded images waiting for the workers and of the results waiting for the writer.
+     */
+    static const std::size_t DEFAULT_QUEUE_DEPTH = 4;
+
+    /**
+     * Result of processing the single file.
+     */
+    struct FileResult {
+        std::string path;
+        bool success;
+        /**
+         * Description of the problem (with the step that caused it) if the file couldn't be processed.
+         */
+        std::string message;
+        /**
+         * Time spent in the read, compute and write stage, waiting in the queues is not included.
+         */
+        double readSeconds;
+        double computeSeconds;
+        double writeSeconds;
+    };
+
+    /**
+     * Creates the processor.
+     * @param pipeline - pipeline that will be executed on every file, its outputs need to be unique for every file
+     * @param threads - number of worker threads, 0 means the number of hardware threads
+     * @param readDepth - maximal number of decoded images waiting for the workers
+     * @param writeDepth - maximal number of processed images waiting for the writer
+     */
+    BatchProcessor(const Pipeline & pipeline, unsigned threads, std::size_t readDepth = DEFAULT_QUEUE_DEPTH,
+                   std::size_t writeDepth = DEFAULT_QUEUE_DEPTH);
+
+    /**
+     * Returns the input files - all the BMP and PGM files in the directory (sorted by name)
+     * or all the paths from the list file (one path per line, empty lines and lines starting with # are skipped).
+     * @param directoryOrList - path to the directory or to the list file
+     * @return paths of the input files
+     */
+    static std::vector<std::string> listInputs(const std::string & directoryOrList);
+
+    /**
+     * Processes all the files.
+     * @param inputs - paths of the input files
+     * @return results in the same order as the inputs
+     */
+    std::vector<FileResult> process(const std::vector<std::string> & inputs) const;
+
+    /**
+     * Prints the report - failed files with the reasons, the summary and the busy time of every stage.
+     * @param results - results of the processing
+     * @param seconds - wall time of the whole batch
+     * @param stream - stream to which the report will be written
+     */
+    static void printReport(const std::vector<FileResult> & results, double seconds, std::ostream & stream);
+
+    /**
+     * Exception thrown when the inputs couldn't be listed.
+     */
+    struct InputListException : std::exception {
+        const char * what() const noexcept override {
+            return "The batch input needs to be a directory or a file with the list of paths.";
+        }
+    };
+
+    /**
+     * Exception thrown when the outputs of the pipeline would be the same for every file.
+     */
+    struct OutputTemplateException : std::exception {
+        const char * what() const noexcept override {
+            return "Every output path in the batch mode needs to contain {name} or {index}.";
+        }
+    };
+
+private:
+    /**
+     * File travelling between the stages.
+     */
+    struct Job {
+        std::size_t index;
+        std::unique_ptr<Image> image;
+    };
+
+    const Pipeline & pipeline;
+    unsigned threads;
+    std::size_t readDepth;
+    std::size_t writeDepth;
+
+    /**
+     * Reads and decodes the file (the read stage).
+     * @return the image or nullptr if the file couldn't be read, the reason is stored in the result
+     */
+    std::unique_ptr<Image> readFile(FileResult & result) const;
+
+    /**
+     * Executes the operations and the outputs in the middle of the pipeline (the compute stage).
+     * @return false if any step failed, the reason is stored in the result
+     */
+    bool computeFile(Image & image, int index, FileResult & result) const;
+
+    /**
+     * Executes the trailing outputs of the pipeline and releases the image (the write stage).
+     */
+    void writeFile(std::unique_ptr<Image> image, int index, FileResult & result) const;
+};
+
+#endif //BATCHPROCESSOR_H
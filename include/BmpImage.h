@@ -6,11 +6,11 @@
 #include <iostream>
 #include <algorithm>
 #include <cmath>
-#include "Image.h"
-#include "PixelManager.h"
+#include <string>
+#include "RasterImage.h"
 
 /**
- * Struct of the Pixel that is used in the BMP image file format.
+ * Struct of the Pixel that is used in the BMP image file format (the pixels in the memory can use another layout).
  */
 struct RGB {
     uint8_t b;
@@ -18,13 +18,50 @@ struct RGB {
     uint8_t r;
 };
 
+static_assert(sizeof(RGB) == 3, "RGB has to match the 24 bit pixel stored in the file.");
+
 /**
  * Main BMP Image header class.
+ * The pixels are kept as the bytes in one of the layouts, they are converted only when the image is read and saved.
+ * The operations are implemented by the RasterImage.
  */
-class BmpImage : public Image, public PixelManager<RGB> {
+class BmpImage : public RasterImage {
+
+public:
+
+    /**
+     * Layout of the pixels in the memory.
+     */
+    enum Layout {
+        /**
+         * Interleaved 3 byte pixels (BGR), the same as in the file.
+         */
+        BGR,
+
+        /**
+         * Three planes of the single channel (blue, green, red), every channel is processed
+         * by the same code as the PGM image.
+         */
+        PLANAR,
+
+        /**
+         * Interleaved 4 byte pixels (BGR and the unused byte), every pixel is aligned to 4 bytes.
+         */
+        BGRX
+    };
 
 private:
 
+    /**
+     * Layout used by the new images.
+     */
+    static Layout defaultLayout;
+
+    /**
+     * Layout of the pixels of this image.
+     */
+    Layout layout;
+
     /**
      * BMP file header struct - containing all of the necessary file data.
      */
@@ -52,8 +89,8 @@ private:
         uint32_t colorsImportant;
     };
 
-    bmp_file_header * bmpFileHeader;
-    bmp_info_header * bmpInfoHeader;
+    bmp_file_header * bmpFileHeader = nullptr;
+    bmp_info_header * bmpInfoHeader = nullptr;
 
     /**
      * Contains all the data after the end of known and understandable information.
@@ -61,11 +98,6 @@ private:
      */
     std::vector<uint8_t> * restOfTheFile = new std::vector<uint8_t>;
 
-    /**
-     * Contains the information if the image is in the binary format.
-     */
-    bool isBinary = false;
-
     // Additional file methods
 
     /**
@@ -96,7 +128,34 @@ private:
      * Recalculates the size of image.
      * @return - size of the image in uint32_t datatype
      */
-    uint32_t getRecalculatedSizeOfImage();
+    uint32_t getRecalculatedSizeOfImage() const;
+
+    /**
+     * Returns the size of one row of pixels in the file - rows are padded to the multiple of 4 bytes.
+     * @return - size of the row in bytes
+     */
+    std::size_t getRowSize() const;
+
+    /**
+     * Converts the row of the file to the layout of the image.
+     * @param fileRow - pixels of the row as they are in the file
+     * @param pixelArray - array of the image
+     * @param row - index of the row
+     */
+    void storeRow(const char * fileRow, uint8_t * pixelArray, int row) const;
+
+    /**
+     * Converts the row of the image to the pixels stored in the file.
+     * @param fileRow - destination of the pixels
+     * @param row - index of the row
+     */
+    void loadRow(char * fileRow, int row) const;
+
+    /**
+     * Copies the headers of the other image and shares its pixels, used by clone.
+     * @param other - image to copy
+     */
+    BmpImage(const BmpImage & other);
 
     // override
 
@@ -106,32 +165,50 @@ public:
 
     /**
      * Performs validation and reads the image.
-     * @param file - fstream of the image file.
+     * @param file - stream of the image file.
+     */
+    explicit BmpImage(std::istream& file);
+
+    ~BmpImage() override;
+
+    /**
+     * Sets the layout of the images created later - it should be called before the threads are started.
+     * @param layout - layout of the pixels
      */
-    explicit BmpImage(std::fstream& file);
+    static void setDefaultLayout(Layout layout);
 
     /**
-     * Creates the grayscale.
+     * Returns the layout of the images created now.
      */
-    void toGrayscale();
+    static Layout getDefaultLayout();
+
+    /**
+     * Returns the layout by its name (bgr, planar, bgrx).
+     * @param name - name of the layout
+     */
+    static Layout parseLayout(const std::string & name);
+
+    /**
+     * Returns the layout of the pixels of this image.
+     */
+    Layout getLayout() const;
 
     // override
 
     void validate() override;
     void read() override;
-    void save(std::string path) const override;
-
-    void blur() override;
-    void toBinary(int threshold) override;
-    void erode() override;
-    void dilate() override;
-    void toNegative() override;
-    void scale(int newWidth, int newHeight) override;
-    void scaleDown(int newWidth, int newHeight) override;
-    void scaleUp(int newWidth, int newHeight) override;
-    void edgeFilter() override;
-    void denoise(int size) override;
-    void rotate(float degree) override;
+    Image * clone() const override;
+    using ImageReader::save;
+    void save(std::ostream & stream) const override;
+
+    /**
+     * Exception thrown when the name of the layout is not known.
+     */
+    struct UnknownLayoutException : std::exception {
+        const char * what() const noexcept override {
+            return "Unknown BMP layout, expected: bgr, planar or bgrx.";
+        }
+    };
 };
 
 #endif //BMPIMAGE_H
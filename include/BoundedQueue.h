@@ -0,0 +1,125 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/**
+ * Thread safe FIFO queue with the limited capacity, it connects the stages of the batch pipeline.
+ * Push waits while the queue is full (back-pressure - the faster stage can't run away from the slower one),
+ * pop waits while it's empty. After close no more items are accepted and pop returns false once the queue is empty.
+ * @tparam T - type of the items, it only needs to be movable
+ */
+template<class T>
+class BoundedQueue {
+public:
+    /**
+     * Creates the queue.
+     * @param capacity - maximal number of items in the queue, 0 is treated as 1
+     */
+    explicit BoundedQueue(std::size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue & operator=(const BoundedQueue &) = delete;
+
+    /**
+     * Adds the item at the end of the queue, waits until there is a free place.
+     * @param item - item to add
+     * @return false if the queue was closed (the item is not added)
+     */
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+
+        items.push_back(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * Takes the first item from the queue, waits until there is any.
+     * @param item - taken item
+     * @return false if the queue is closed and empty
+     */
+    bool pop(T & item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+
+        item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * Adds the item if there is a free place, without waiting.
+     * @param item - item to add, it's left untouched if it wasn't added
+     * @return false if the queue is full or closed
+     */
+    bool tryPush(T & item) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (closed || items.size() >= capacity) {
+                return false;
+            }
+            items.push_back(std::move(item));
+        }
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * Takes the first item if there is any, without waiting.
+     * @param item - taken item
+     * @return false if the queue is empty
+     */
+    bool tryPop(T & item) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (items.empty()) {
+                return false;
+            }
+            item = std::move(items.front());
+            items.pop_front();
+        }
+        notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * Closes the queue - waiting pushes fail, items that are already in the queue can still be taken.
+     */
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    std::size_t getCapacity() const {
+        return capacity;
+    }
+
+private:
+    const std::size_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
+
+#endif //BOUNDEDQUEUE_H
@@ -0,0 +1,119 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Allocator of the pixel arrays.
+ * Every thread can enable its own pool - released arrays are then kept and reused by the next allocations
+ * of the same thread instead of being returned to the system. It's used by the workers processing many
+ * images of similar size. Without the enabled pool arrays are simply allocated and freed.
+ * The limit of the kept bytes is shared by all the pools, so more threads don't keep more memory.
+ * Arrays are aligned to ALIGNMENT bytes.
+ */
+class BufferPool {
+public:
+    /**
+     * Alignment of every array.
+     */
+    static const std::size_t ALIGNMENT = 64;
+
+    /**
+     * Allocates the array of the given size.
+     * @param bytes - size of the array
+     * @return void * - allocated array, it needs to be released with the release method
+     */
+    static void * acquire(std::size_t bytes);
+
+    /**
+     * Releases the array - it is kept in the pool of the current thread if the pool is enabled and all the pools
+     * together stay under its limit.
+     * @param buffer - array allocated by acquire (nullptr is ignored)
+     */
+    static void release(void * buffer);
+
+    /**
+     * Enables the pool of the current thread.
+     * @param maxBytes - maximal number of bytes kept in all the pools together
+     */
+    static void enable(std::size_t maxBytes);
+
+    /**
+     * Disables the pool of the current thread and frees all the arrays kept in it.
+     */
+    static void disable();
+
+    /**
+     * Returns the number of allocations that were served by the pool of the current thread.
+     */
+    static std::size_t getReusedCount();
+
+    /**
+     * Returns the capacity of the array (at least the requested size) - it's stored in the header placed before it.
+     * @param buffer - array allocated by acquire
+     * @return std::size_t - capacity in bytes
+     */
+    static std::size_t getCapacity(const void * buffer);
+
+    /**
+     * Returns the size requested by the last acquire of the array (the reused array can be up to two times bigger).
+     * @param buffer - array allocated by acquire
+     * @return std::size_t - size in bytes
+     */
+    static std::size_t getSize(const void * buffer);
+
+    /**
+     * Temporary array of bytes released at the end of the scope, fe. the masks of the operations.
+     */
+    class TemporaryBuffer {
+    public:
+        explicit TemporaryBuffer(std::size_t bytes) : data(static_cast<uint8_t *>(acquire(bytes))) {}
+        TemporaryBuffer(const TemporaryBuffer &) = delete;
+        TemporaryBuffer & operator=(const TemporaryBuffer &) = delete;
+
+        ~TemporaryBuffer() {
+            release(this->data);
+        }
+
+        uint8_t * get() const {
+            return this->data;
+        }
+
+    private:
+        uint8_t * data;
+    };
+
+private:
+    /**
+     * Pool of the single thread.
+     */
+    struct Pool {
+        bool enabled = false;
+        std::size_t maxBytes = 0;
+        std::size_t keptBytes = 0;
+        std::size_t reused = 0;
+        std::vector<void *> buffers;
+
+        ~Pool();
+    };
+
+    /**
+     * Number of bytes kept in all the pools.
+     */
+    static std::atomic<std::size_t> totalKeptBytes;
+
+    static Pool & getPool();
+
+    /**
+     * Adds the bytes to the total if it stays under the limit.
+     * @return false if the bytes don't fit
+     */
+    static bool reserve(std::size_t bytes, std::size_t maxBytes);
+
+    static void freeBuffer(void * buffer);
+};
+
+#endif //BUFFERPOOL_H
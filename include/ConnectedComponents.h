@@ -0,0 +1,132 @@
+#ifndef CONNECTEDCOMPONENTS_H
+#define CONNECTEDCOMPONENTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Labeling of the connected components of the binary mask (two-pass union-find). The image is split to the strips
+ * of the rows labeled by their own threads - every strip gives the provisional labels to its pixels and joins
+ * the labels of the touching pixels, then the labels touching across the borders of the strips are joined
+ * and the strips are relabeled in parallel. The components are numbered in the order of their first pixel
+ * (from the top left), so the result doesn't depend on the number of the threads.
+ */
+class ConnectedComponents {
+public:
+    /**
+     * Neighbours of the pixel - FOUR are the pixels next to its sides, EIGHT also the diagonal ones.
+     */
+    enum Connectivity {
+        FOUR = 4,
+        EIGHT = 8
+    };
+
+    /**
+     * Statistics of one component, the coordinates are in pixels from the top left corner (right and bottom
+     * are inclusive).
+     */
+    struct Component {
+        uint32_t label;
+        uint64_t area;
+        int left;
+        int top;
+        int right;
+        int bottom;
+        double centroidX;
+        double centroidY;
+    };
+
+    /**
+     * Labels the components of the set pixels.
+     * @param mask - first row of the mask, the pixels are set if they are not zero
+     * @param labels - first row of the labels, 0 for the pixels that are not set, 1 - number of the components
+     *                 for the others
+     * @param rowStep - distance of the rows of the mask and of the labels (negative for the bottom-up rows)
+     * @param connectivity - neighbours of the pixel
+     * @return statistics of the components, the component with the label l is at l - 1
+     */
+    static std::vector<Component> label(const uint8_t * mask, uint32_t * labels, int width, int height,
+                                         std::ptrdiff_t rowStep, Connectivity connectivity);
+
+    /**
+     * Writes the statistics as CSV (one component per line, the header first).
+     */
+    static void writeCsv(std::ostream & stream, const std::vector<Component> & components);
+
+    /**
+     * Writes the statistics as JSON (the array of the components).
+     */
+    static void writeJson(std::ostream & stream, const std::vector<Component> & components);
+
+    /**
+     * Saves the statistics to the file, JSON if its extension is .json, CSV otherwise.
+     */
+    static void save(const std::vector<Component> & components, const std::string & path);
+
+    /**
+     * Exception thrown when the statistics couldn't be saved.
+     */
+    struct StatisticsSaveException : std::exception {
+        const char * what() const noexcept override {
+            return "The statistics of the components couldn't be saved in the desired location.";
+        }
+    };
+
+private:
+    /**
+     * Sums of the pixels of one provisional label.
+     */
+    struct Sums {
+        uint64_t area;
+        uint64_t sumX;
+        uint64_t sumY;
+        int left;
+        int top;
+        int right;
+        int bottom;
+    };
+
+    /**
+     * Rows of the image labeled by one thread, its provisional labels are 1 - parents.size() - 1.
+     */
+    struct Strip {
+        int firstRow;
+        int lastRow;
+        /**
+         * Number of the provisional labels of the strips before it.
+         */
+        uint32_t offset;
+        std::vector<uint32_t> parents;
+        std::vector<Sums> sums;
+    };
+
+    /**
+     * Gives the provisional labels to the rows of the strip (first pass).
+     */
+    static void labelStrip(const uint8_t * mask, uint32_t * labels, int width, std::ptrdiff_t rowStep,
+                           Connectivity connectivity, Strip & strip);
+
+    /**
+     * Returns true if the set pixel x right of the pixel with the label gets the label too and nothing is joined
+     * (the pixels above it are not set or have the same label).
+     * @param labelsAbove - labels of the row above, nullptr for the first row of the strip
+     */
+    static bool continuesRun(const uint32_t * labelsAbove, int width, int x, uint32_t label,
+                             Connectivity connectivity);
+
+    /**
+     * Returns the root of the label and shortens the path to it.
+     */
+    static uint32_t find(std::vector<uint32_t> & parents, uint32_t label);
+
+    /**
+     * Joins the trees of the labels, the smaller root becomes the root of both.
+     */
+    static uint32_t join(std::vector<uint32_t> & parents, uint32_t first, uint32_t second);
+};
+
+#endif //CONNECTEDCOMPONENTS_H
@@ -0,0 +1,502 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Generic 2D convolution of the images made of the interleaved 8-bit channels (every channel is convolved alone).
+ * Kernels known at the compile time are the types (Kernel<3, 0, -1, 0, ...>) - their taps are unrolled,
+ * the zero taps are not computed at all and the separable kernels are split to the row and the column pass
+ * when it needs fewer multiplications. Kernels known only at the run time (KernelMatrix) use the same borders
+ * and the same separation, their taps are looped.
+ * The image is processed row by row, only the rows under the kernel are kept with their borders (ring of rows),
+ * so the memory doesn't depend on the image size.
+ */
+class Convolution {
+public:
+    /**
+     * How the pixels outside of the image are computed.
+     */
+    enum BorderType {
+        /**
+         * The nearest edge pixel is repeated (aaa|abcd|ddd).
+         */
+        CLAMP,
+
+        /**
+         * The image is mirrored around the edge pixel, the edge is not repeated (cb|abcd|cb).
+         */
+        REFLECT,
+
+        /**
+         * The pixels outside have the constant value.
+         */
+        CONSTANT
+    };
+
+    /**
+     * How the kernels known at the run time are applied.
+     */
+    enum Method {
+        /**
+         * Chosen by the cost model from the size of the kernel.
+         */
+        AUTO,
+
+        /**
+         * Sum of the taps for every pixel.
+         */
+        DIRECT,
+
+        /**
+         * Product of the spectra of the image tiles and the kernel (overlap-add).
+         */
+        FFT
+    };
+
+    /**
+     * Border of the image - its type and the value of the CONSTANT border.
+     */
+    struct Border {
+        BorderType type;
+        uint8_t value;
+    };
+
+    /**
+     * The maximal sum of the absolute weights, so the sums of the bytes fit in 32 bits.
+     */
+    static const int MAX_WEIGHT_SUM = 1 << 23;
+
+    /**
+     * Square kernel known at the compile time.
+     * @tparam SIZE - odd width and height of the kernel
+     * @tparam WEIGHTS - SIZE * SIZE weights, row by row from the top left one
+     */
+    template<int SIZE, int... WEIGHTS>
+    struct Kernel {
+        static_assert(SIZE % 2 == 1, "The kernel needs the centre.");
+        static_assert(sizeof...(WEIGHTS) == SIZE * SIZE, "The kernel needs SIZE * SIZE weights.");
+
+        static constexpr int RADIUS = SIZE / 2;
+
+        static constexpr int getWeight(int index) {
+            int weights[] = {WEIGHTS...};
+            return weights[index];
+        }
+
+        /**
+         * Position of the weight used to split the kernel (the first non zero weight).
+         */
+        static constexpr int getPivot() {
+            int index = 0;
+            while (index < SIZE * SIZE && getWeight(index) == 0) {
+                index++;
+            }
+            return index < SIZE * SIZE ? index : 0;
+        }
+
+        static constexpr int countTaps() {
+            int count = 0;
+            for (int index = 0; index < SIZE * SIZE; index++) {
+                count += getWeight(index) != 0 ? 1 : 0;
+            }
+            return count;
+        }
+
+        /**
+         * Weight of the column pass - the column of the pivot.
+         */
+        static constexpr int getColumnWeight(int row) {
+            return getWeight(row * SIZE + getPivot() % SIZE);
+        }
+
+        /**
+         * Weight of the row pass - the row of the pivot.
+         */
+        static constexpr int getRowWeight(int column) {
+            return getWeight(getPivot() / SIZE * SIZE + column);
+        }
+
+        /**
+         * The kernel is separable if every weight is the product of its row and column weights
+         * divided by the pivot, and it's split only if the two passes have fewer taps.
+         */
+        static constexpr bool isSeparable() {
+            int pivot = getWeight(getPivot());
+            int rowTaps = 0, columnTaps = 0;
+            for (int i = 0; i < SIZE; i++) {
+                rowTaps += getRowWeight(i) != 0 ? 1 : 0;
+                columnTaps += getColumnWeight(i) != 0 ? 1 : 0;
+                for (int j = 0; j < SIZE; j++) {
+                    if (getWeight(i * SIZE + j) * pivot != getColumnWeight(i) * getRowWeight(j)) {
+                        return false;
+                    }
+                }
+            }
+            return pivot != 0 && rowTaps + columnTaps < countTaps();
+        }
+
+        /**
+         * Weighted sum of the window at the position of the rows (the first value of the window).
+         * @param rows - SIZE rows under the kernel, they contain the borders
+         * @param position - index of the value in the rows
+         * @param step - distance of the neighbouring pixels (number of the channels)
+         */
+        static int sum(const uint8_t * const * rows, std::size_t position, std::size_t step) {
+            return sumTaps(rows, position, step, std::make_integer_sequence<int, SIZE * SIZE>());
+        }
+
+        /**
+         * Row pass of the separable kernel.
+         */
+        static int sumRow(const uint8_t * row, std::size_t position, std::size_t step) {
+            return sumRowTaps(row, position, step, std::make_integer_sequence<int, SIZE>());
+        }
+
+        /**
+         * Column pass of the separable kernel, divided by the pivot (the division is exact).
+         */
+        static int sumColumn(const int * const * rows, std::size_t position) {
+            return sumColumnTaps(rows, position, std::make_integer_sequence<int, SIZE>()) /
+                   getWeight(getPivot());
+        }
+
+    private:
+        template<int INDEX>
+        static int tap(const uint8_t * const * rows, std::size_t position, std::size_t step, std::true_type) {
+            return getWeight(INDEX) * rows[INDEX / SIZE][position + INDEX % SIZE * step];
+        }
+
+        template<int INDEX>
+        static int tap(const uint8_t * const *, std::size_t, std::size_t, std::false_type) {
+            return 0;
+        }
+
+        template<int... INDICES>
+        static int sumTaps(const uint8_t * const * rows, std::size_t position, std::size_t step,
+                           std::integer_sequence<int, INDICES...>) {
+            int total = 0;
+            int expand[] = {0, (total += tap<INDICES>(rows, position, step,
+                                                      std::integral_constant<bool, getWeight(INDICES) != 0>()), 0)...};
+            (void) expand;
+            return total;
+        }
+
+        template<int... INDICES>
+        static int sumRowTaps(const uint8_t * row, std::size_t position, std::size_t step,
+                              std::integer_sequence<int, INDICES...>) {
+            int total = 0;
+            int expand[] = {0, (total += getRowWeight(INDICES) != 0 ?
+                                         getRowWeight(INDICES) * row[position + INDICES * step] : 0, 0)...};
+            (void) expand;
+            return total;
+        }
+
+        template<int... INDICES>
+        static int sumColumnTaps(const int * const * rows, std::size_t position,
+                                 std::integer_sequence<int, INDICES...>) {
+            int total = 0;
+            int expand[] = {0, (total += getColumnWeight(INDICES) != 0 ?
+                                         getColumnWeight(INDICES) * rows[INDICES][position] : 0, 0)...};
+            (void) expand;
+            return total;
+        }
+    };
+
+    /**
+     * Square kernel known only at the run time, fe. passed by the user.
+     */
+    class KernelMatrix {
+    public:
+        /**
+         * @param weights - size * size weights, row by row from the top left one
+         * @param divisor - the sum is divided by it, 0 means the sum of the weights (or 1 if it's not positive)
+         * @param bias - value added after the division
+         */
+        explicit KernelMatrix(std::vector<int> weights, int divisor = 0, int bias = 0);
+
+        /**
+         * Parses the weights separated by commas, fe. "0,-1,0,-1,5,-1,0,-1,0".
+         */
+        static KernelMatrix parse(const std::string & weights);
+
+        int getSize() const;
+        int getDivisor() const;
+        int getBias() const;
+        int getWeight(int row, int column) const;
+
+        /**
+         * Returns the kernel flipped upside down (for the images stored from the bottom row).
+         */
+        KernelMatrix flip() const;
+
+        /**
+         * Returns true if the kernel is split to the row and the column pass.
+         */
+        bool isSeparable() const;
+
+    private:
+        friend class Convolution;
+
+        struct Tap {
+            int row;
+            int column;
+            int weight;
+        };
+
+        int size;
+        int divisor;
+        int bias;
+        std::vector<int> weights;
+
+        /**
+         * Non zero weights, of the whole kernel or of the row and the column pass.
+         */
+        std::vector<Tap> taps;
+        std::vector<Tap> rowTaps;
+        std::vector<Tap> columnTaps;
+        int pivot = 0;
+    };
+
+    /**
+     * Convolves the image with the kernel, the result is sum / divisor + bias clamped to 0 - maxValue.
+     * @tparam KERNEL - Kernel type
+     * @param channels - number of the interleaved channels
+     */
+    template<typename KERNEL>
+    static void filter(const uint8_t * source, uint8_t * destination, int width, int height, int channels,
+                       Border border, int divisor, int bias, uint8_t maxValue) {
+        auto output = [divisor, bias, maxValue](int sum) {
+            return (uint8_t) std::min(std::max(sum / divisor + bias, 0), (int) maxValue);
+        };
+        if (KERNEL::isSeparable()) {
+            convolveSeparable<KERNEL>(source, destination, width, height, channels, border, output);
+        } else {
+            convolve<KERNEL>(source, destination, width, height, channels, border, output);
+        }
+    }
+
+    /**
+     * Absolute value of the convolution, fe. for the Laplacian, clamped to 0 - maxValue.
+     */
+    template<typename KERNEL>
+    static void absolute(const uint8_t * source, uint8_t * destination, int width, int height, int channels,
+                         Border border, uint8_t maxValue) {
+        auto output = [maxValue](int sum) {
+            return (uint8_t) std::min(std::abs(sum), (int) maxValue);
+        };
+        if (KERNEL::isSeparable()) {
+            convolveSeparable<KERNEL>(source, destination, width, height, channels, border, output);
+        } else {
+            convolve<KERNEL>(source, destination, width, height, channels, border, output);
+        }
+    }
+
+    /**
+     * Magnitude of the gradient computed by two kernels of the same size (fe. Sobel, Scharr, Prewitt),
+     * sqrt(x * x + y * y) / divisor clamped to 0 - maxValue.
+     */
+    template<typename KERNEL_X, typename KERNEL_Y>
+    static void gradient(const uint8_t * source, uint8_t * destination, int width, int height, int channels,
+                         Border border, int divisor, uint8_t maxValue) {
+        static_assert(KERNEL_X::RADIUS == KERNEL_Y::RADIUS, "The kernels need the same size.");
+
+        Rows rows(source, width, height, channels, KERNEL_X::RADIUS, border);
+        auto step = (std::size_t) channels;
+        std::size_t rowValues = (std::size_t) width * channels;
+        for (int row = 0; row < height; row++) {
+            const uint8_t * const * window = rows.get(row);
+            uint8_t * result = destination + row * rowValues;
+            for (std::size_t position = 0; position < rowValues; position++) {
+                int x = KERNEL_X::sum(window, position, step);
+                int y = KERNEL_Y::sum(window, position, step);
+                auto magnitude = (int) std::sqrt((double) (x * x + y * y)) / divisor;
+                result[position] = (uint8_t) std::min(magnitude, (int) maxValue);
+            }
+        }
+    }
+
+    /**
+     * Convolves the image with the kernel known at the run time, the result is sum / divisor + bias
+     * clamped to 0 - maxValue. The big kernels are applied by the FFT if the cost model expects it to be faster,
+     * the results are the same (the sums are rounded to the integers before the division).
+     */
+    static void filter(const KernelMatrix & kernel, const uint8_t * source, uint8_t * destination, int width,
+                       int height, int channels, Border border, uint8_t maxValue);
+
+    /**
+     * Parses the border type (clamp, reflect, constant).
+     */
+    static BorderType parseBorderType(const std::string & name);
+
+    /**
+     * Forces the method of the kernels known at the run time, for testing and benchmarks (default: AUTO).
+     */
+    static void setMethod(Method method);
+
+    /**
+     * Returns the method of the kernels known at the run time.
+     */
+    static Method getMethod();
+
+    /**
+     * Parses the method (auto, direct, fft).
+     */
+    static Method parseMethod(const std::string & name);
+
+    /**
+     * Cost model - returns the size of the FFT that is used for the kernel and the image, or 0 if the kernel
+     * is applied directly. The FFT size is chosen to have the smallest cost of one pixel: the tiles are
+     * size - kernel size + 1 pixels wide, so the small FFT wastes work on the overlaps and the big one
+     * on the longer transforms.
+     */
+    static int chooseFftSize(const KernelMatrix & kernel, int width, int height);
+
+    /**
+     * Exception thrown when the kernel is not square, has no weights or its weights are too big.
+     */
+    struct InvalidKernelException : std::exception {
+        const char * what() const noexcept override {
+            return "The kernel needs odd size * size comma separated weights, the sum of their absolute values "
+                   "can be at most 8388608.";
+        }
+    };
+
+    /**
+     * Exception thrown when the method is not known.
+     */
+    struct UnknownMethodException : std::exception {
+        const char * what() const noexcept override {
+            return "Unknown convolution method, expected: auto, direct or fft.";
+        }
+    };
+
+    /**
+     * Exception thrown when the border type is not known.
+     */
+    struct UnknownBorderException : std::exception {
+        const char * what() const noexcept override {
+            return "Unknown border, expected: clamp, reflect or constant <value>.";
+        }
+    };
+
+private:
+    /**
+     * Ring of the source rows under the kernel, every row is copied with radius pixels of the border on both sides.
+     * Rows are requested in the increasing order, so every source row is copied once.
+     */
+    class Rows {
+    public:
+        Rows(const uint8_t * source, int width, int height, int channels, int radius, Border border);
+
+        /**
+         * Returns 2 * radius + 1 rows around the row, their first value is radius pixels left of the image.
+         */
+        const uint8_t * const * get(int row);
+
+        /**
+         * Returns the index of the ring slot of the row.
+         */
+        int getSlot(int row) const;
+
+        /**
+         * Returns the source row that is copied to the row outside of the image, -1 for the constant.
+         */
+        int mapRow(int row) const;
+
+        /**
+         * Copies the row with its borders, it can be outside of the image.
+         * @param destination - (width + 2 * radius) * channels values
+         */
+        void copyRow(int row, uint8_t * destination) const;
+
+    private:
+        const uint8_t * source;
+        int width;
+        int height;
+        int channels;
+        int radius;
+        Border border;
+        std::vector<uint8_t> ring;
+        std::vector<int> rowsInRing;
+        std::vector<const uint8_t *> window;
+
+        int mapIndex(int index, int count) const;
+    };
+
+    static Method method;
+
+    /**
+     * Overlap-add convolution - the padded image is split to the tiles, every tile is convolved by the FFT
+     * and its result (bigger than the tile by the kernel) is added to the band of the result rows.
+     * The band is written when no other tile can change it.
+     */
+    static void filterFft(const KernelMatrix & kernel, int fftSize, const uint8_t * source, uint8_t * destination,
+                          int width, int height, int channels, Border border, uint8_t maxValue);
+
+    /**
+     * Direct convolution - every output value is the sum of all the taps.
+     */
+    template<typename KERNEL, typename OUTPUT>
+    static void convolve(const uint8_t * source, uint8_t * destination, int width, int height, int channels,
+                         Border border, OUTPUT output) {
+        Rows rows(source, width, height, channels, KERNEL::RADIUS, border);
+        auto step = (std::size_t) channels;
+        std::size_t rowValues = (std::size_t) width * channels;
+        for (int row = 0; row < height; row++) {
+            const uint8_t * const * window = rows.get(row);
+            uint8_t * result = destination + row * rowValues;
+            for (std::size_t position = 0; position < rowValues; position++) {
+                result[position] = output(KERNEL::sum(window, position, step));
+            }
+        }
+    }
+
+    /**
+     * Separable convolution - the row pass of every source row is kept in the ring, the column pass
+     * combines them.
+     */
+    template<typename KERNEL, typename OUTPUT>
+    static void convolveSeparable(const uint8_t * source, uint8_t * destination, int width, int height,
+                                  int channels, Border border, OUTPUT output) {
+        const int size = 2 * KERNEL::RADIUS + 1;
+        Rows rows(source, width, height, channels, KERNEL::RADIUS, border);
+        auto step = (std::size_t) channels;
+        std::size_t rowValues = (std::size_t) width * channels;
+
+        std::vector<int> rowSums(size * rowValues);
+        std::vector<int> summedRows(size, INT_MIN);
+        const int * window[size];
+        for (int row = 0; row < height; row++) {
+            const uint8_t * const * sourceRows = rows.get(row);
+            for (int i = 0; i < size; i++) {
+                int sourceRow = row - KERNEL::RADIUS + i;
+                int slot = rows.getSlot(sourceRow);
+                int * sums = rowSums.data() + slot * rowValues;
+                if (summedRows[slot] != sourceRow) {
+                    for (std::size_t position = 0; position < rowValues; position++) {
+                        sums[position] = KERNEL::sumRow(sourceRows[i], position, step);
+                    }
+                    summedRows[slot] = sourceRow;
+                }
+                window[i] = sums;
+            }
+
+            uint8_t * result = destination + row * rowValues;
+            for (std::size_t position = 0; position < rowValues; position++) {
+                result[position] = output(KERNEL::sumColumn(window, position));
+            }
+        }
+    }
+};
+
+#endif //CONVOLUTION_H
@@ -0,0 +1,69 @@
+#ifndef DISTANCETRANSFORM_H
+#define DISTANCETRANSFORM_H
+
+#include <cstdint>
+#include <exception>
+#include <limits>
+
+/**
+ * Exact Euclidean distance transform of the binary mask (Felzenszwalb and Huttenlocher) - every pixel gets
+ * the squared distance to the nearest set pixel of the mask. The columns are scanned first (the distance
+ * to the nearest set pixel in the column, both directions over the whole rows), then every row is the lower
+ * envelope of the parabolas of its values. Both passes are linear, so the cost doesn't depend on the distances,
+ * and the columns (then the rows) of the big images are split between the threads.
+ */
+class DistanceTransform {
+public:
+    /**
+     * Squared distance of the pixels that have no set pixel in the mask (and of the bigger distances).
+     */
+    static constexpr uint32_t INFINITE = std::numeric_limits<uint32_t>::max();
+
+    /**
+     * Biggest radius of spread - its square has to be smaller than INFINITE.
+     */
+    static const int MAX_RADIUS = 65535;
+
+    /**
+     * Computes the squared distances.
+     * @param mask - width * height values, the pixels are set if they are not zero
+     * @param distances - width * height squared distances, 0 for the set pixels
+     */
+    static void compute(const uint8_t * mask, uint32_t * distances, int width, int height);
+
+    /**
+     * Spreads the mask by the disk - the destination is set for the pixels at most radius far from any set pixel
+     * (erode and dilate with the circular window).
+     * @param mask - width * height values, the pixels are set if they are not zero
+     * @param destination - width * height values, 255 for the set pixels, 0 for the others
+     * @param radius - radius of the disk, 0 - MAX_RADIUS
+     */
+    static void spread(const uint8_t * mask, uint8_t * destination, int width, int height, int radius);
+
+    /**
+     * Exception thrown when the radius is out of its range.
+     */
+    struct InvalidRadiusException : std::exception {
+        const char * what() const noexcept override {
+            return "The radius of the disk must be 0 - 65535.";
+        }
+    };
+
+private:
+    /**
+     * Distances in the columns first - last (exclusive) - the squared distance to the nearest set pixel above
+     * or below, INFINITE if the column has no set pixel.
+     */
+    static void transformColumns(const uint8_t * mask, uint32_t * distances, int width, int height, int first,
+                                 int last);
+
+    /**
+     * Lower envelope of the parabolas of the row - the column distances of the row are changed to the distances.
+     * @param vertices - width positions of the parabolas
+     * @param bounds - width + 1 bounds of the parabolas
+     * @param values - width values of the parabolas
+     */
+    static void transformRow(uint32_t * distances, int width, int * vertices, double * bounds, uint32_t * values);
+};
+
+#endif //DISTANCETRANSFORM_H
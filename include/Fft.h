@@ -0,0 +1,88 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Fast Fourier transform of one size - mixed radix (2, 3, 4 and 5), so the sizes are the products of these factors
+ * (fe. 96, 120, 160), not only the powers of two. The twiddle factors and the factorization are computed once
+ * by the constructor, then any number of arrays of that size can be transformed.
+ * The real 2D transform packs two real rows into one complex row, so it costs about half of the complex one.
+ */
+class Fft {
+public:
+    using Complex = std::complex<double>;
+
+    /**
+     * Prepares the transform.
+     * @param size - length of the transformed arrays, it needs to be the product of 2, 3 and 5
+     */
+    explicit Fft(int size);
+
+    /**
+     * Returns the length of the transformed arrays.
+     */
+    int getSize() const;
+
+    /**
+     * Transforms the array in place.
+     * @param data - size values, they can be strided
+     * @param stride - distance of the values in the array
+     * @param inverse - true for the inverse transform (it's not divided by the size)
+     */
+    void transform(Complex * data, std::size_t stride = 1, bool inverse = false) const;
+
+    /**
+     * 2D transform of the real square (size x size) - the result has size rows of size / 2 + 1 values,
+     * the rest of the spectrum is their complex conjugate.
+     * @param real - size x size values, row by row
+     * @param rows - number of the rows that are not zero (the rows after them are not read)
+     * @param spectrum - size x (size / 2 + 1) values
+     */
+    void forwardReal(const double * real, int rows, Complex * spectrum) const;
+
+    /**
+     * Inverse of forwardReal, divided by size * size. The spectrum is overwritten.
+     * @param spectrum - size x (size / 2 + 1) values
+     * @param rows - number of the rows of the result that are needed
+     * @param real - size x size values, only the first rows are written
+     */
+    void inverseReal(Complex * spectrum, int rows, double * real) const;
+
+    /**
+     * Returns true if the size can be transformed (it's even and the product of 2, 3 and 5).
+     */
+    static bool isSupported(int size);
+
+private:
+    int size;
+    std::vector<int> factors;
+
+    /**
+     * exp(-2 pi i k / size) for the forward transform and their complex conjugates for the inverse one.
+     */
+    std::vector<Complex> twiddles;
+    std::vector<Complex> inverseTwiddles;
+
+    /**
+     * Output of the stages - one object can't be used by more threads at once.
+     */
+    mutable std::vector<Complex> buffer;
+
+    /**
+     * Transforms the values to the output recursively - every level splits the array by its factor.
+     */
+    void transformStage(Complex * output, const Complex * input, std::size_t inputStride, std::size_t twiddleStride,
+                        std::size_t factor, const Complex * table, bool inverse) const;
+
+    // butterflies of one stage, they combine radix transforms of the length into one
+    static void butterfly2(Complex * output, std::size_t twiddleStride, std::size_t length, const Complex * table);
+    static void butterfly3(Complex * output, std::size_t twiddleStride, std::size_t length, const Complex * table);
+    static void butterfly4(Complex * output, std::size_t twiddleStride, std::size_t length, const Complex * table,
+                           bool inverse);
+    static void butterfly5(Complex * output, std::size_t twiddleStride, std::size_t length, const Complex * table);
+};
+
+#endif //FFT_H
@@ -0,0 +1,79 @@
+#ifndef FRAMESTREAM_H
+#define FRAMESTREAM_H
+
+#include <exception>
+#include <istream>
+#include <string>
+#include "Pipeline.h"
+#include "Profiler.h"
+
+/**
+ * Processes the stream of the concatenated PGM images (fe. frames from a line-scan camera) one after another.
+ * The frames of the same size are read to the already allocated pixel arrays and the operations reuse their
+ * temporary arrays (BufferPool), so there are no allocations once the stream runs.
+ * With more threads the frames are processed in parallel, but the outputs at the end of the pipeline are still
+ * written in the order of the frames.
+ */
+class FrameStream {
+public:
+    /**
+     * Maximal number of bytes of the pixel arrays kept for reuse by all the threads together.
+     */
+    static const std::size_t BUFFER_POOL_BYTES = 256 * 1024 * 1024;
+
+    /**
+     * Creates the stream processor.
+     * @param input - stream of the PGM images, it's read only by the calling thread
+     * @param pipeline - operations executed on every frame, {index} in the output paths is the number of the frame
+     * @param threads - number of threads processing the frames, 0 means the number of hardware threads
+     */
+    FrameStream(std::istream & input, const Pipeline & pipeline, unsigned threads);
+
+    /**
+     * Processes all the frames until the end of the stream. The first problem stops the processing,
+     * the frames before it are written. The second frame is a problem if the outputs are not hasFrameOutputs.
+     * @param inputPath - path of the input, used by the output templates
+     * @param profiler - if passed, every frame is measured (the whole stream as one stage with more threads)
+     * @return number of processed frames
+     */
+    std::size_t run(const std::string & inputPath, Profiler * profiler = nullptr);
+
+    /**
+     * Exception thrown when the second frame is found, but some output path (or path of the statistics) doesn't
+     * contain {index} - every frame would overwrite the file of the frame before it.
+     */
+    struct SharedOutputException : std::exception {
+        const char * what() const noexcept override {
+            return "The input has more frames, so every output path must contain {index} (or be - for stdout).";
+        }
+    };
+
+    /**
+     * Skips the whitespaces between the frames and checks if there is the next one.
+     * @param input - stream of the frames
+     * @return true if the next data starts like the PGM image
+     */
+    static bool hasNextFrame(std::istream & input);
+
+private:
+    std::istream & input;
+    const Pipeline & pipeline;
+    unsigned threads;
+
+    std::size_t runSequential(const std::string & inputPath, Profiler * profiler);
+    std::size_t runParallel(const std::string & inputPath);
+
+    /**
+     * Returns true if every file written by the pipeline has its own path for every frame - the output paths
+     * and the paths of the statistics contain {index}, the standard output gets the frames one after another.
+     */
+    bool hasFrameOutputs() const;
+
+    /**
+     * Returns true if the frames can be processed in parallel - every output (and every file of the statistics)
+     * in the middle of the pipeline (executed by the workers) has to be different for every frame.
+     */
+    bool canRunInParallel() const;
+};
+
+#endif //FRAMESTREAM_H
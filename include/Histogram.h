@@ -0,0 +1,124 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Histogram of the 8-bit values and the statistics computed from it (min, max, mean, standard deviation,
+ * percentiles, the automatic thresholds and the tables of the contrast changes). The values are read once - the big
+ * arrays are split between the threads, every thread counts its part into its own histogram and the histograms
+ * are added together.
+ */
+class Histogram {
+public:
+    static const int BINS = 256;
+
+    /**
+     * Counts the values of one channel.
+     * @param values - first value
+     * @param count - number of the counted values
+     * @param step - distance of the values (number of the interleaved channels)
+     */
+    static Histogram compute(const uint8_t * values, std::size_t count, std::size_t step = 1);
+
+    /**
+     * Counts the luminance of the colour pixels - the gray value r / 3 + g / 3 + b / 3 (the same as the grayscale
+     * image), it's not stored anywhere.
+     * @param blue - first blue value
+     * @param green - first green value
+     * @param red - first red value
+     * @param count - number of the pixels
+     * @param step - distance of the values of one channel
+     */
+    static Histogram computeLuminance(const uint8_t * blue, const uint8_t * green, const uint8_t * red,
+                                      std::size_t count, std::size_t step);
+
+    /**
+     * Adds the counts of the other histogram.
+     */
+    void add(const Histogram & other);
+
+    /**
+     * Returns the number of all the counted values.
+     */
+    uint64_t getCount() const;
+
+    /**
+     * Returns the number of the values equal to the value.
+     */
+    uint64_t getCount(int value) const;
+
+    /**
+     * Returns the smallest value, 0 for the empty histogram.
+     */
+    int getMin() const;
+
+    /**
+     * Returns the biggest value, 0 for the empty histogram.
+     */
+    int getMax() const;
+
+    double getMean() const;
+
+    /**
+     * Returns the standard deviation of all the values (not of the sample).
+     */
+    double getStandardDeviation() const;
+
+    /**
+     * Returns the smallest value that is greater or equal to the percent of the values (nearest rank).
+     * @param percent - 0 - 100, fe. 50 for the median
+     */
+    int getPercentile(double percent) const;
+
+    /**
+     * Otsu's threshold - splits the values to two classes (<= threshold and above it) with the biggest
+     * variance between them. Good for the images with two peaks in the histogram.
+     */
+    int getOtsuThreshold() const;
+
+    /**
+     * Triangle threshold - the value farthest from the line between the peak of the histogram and the end
+     * of its longer tail. Good for the images with one dominant peak (fe. small objects on the background).
+     */
+    int getTriangleThreshold() const;
+
+    /**
+     * Returns the table of the histogram equalization - the value is mapped by the cumulative histogram,
+     * so the values of the result are spread evenly over 0 - maxValue. The smallest value is mapped to 0.
+     * @param maxValue - maximal value of the result
+     */
+    std::array<uint8_t, BINS> getEqualizationTable(uint8_t maxValue) const;
+
+    /**
+     * Returns the table of the linear contrast stretch - the low percentile is mapped to 0 and the high one
+     * to maxValue, the values outside of them are clipped. Nothing is changed if all the values are the same.
+     * @param percent - percent of the darkest and of the brightest values that are clipped (0 - 50),
+     *                  0 stretches the smallest and the biggest value
+     * @param maxValue - maximal value of the result
+     */
+    std::array<uint8_t, BINS> getStretchTable(double percent, uint8_t maxValue) const;
+
+private:
+    std::array<uint64_t, BINS> bins{};
+
+    /**
+     * Splits the values to the parts of ThreadPool::runParts and adds their histograms together.
+     * @param count - number of the values
+     * @param counter - counts the part of the values to the histogram (histogram, first, count)
+     */
+    template<typename Counter>
+    static Histogram countParts(std::size_t count, Counter counter);
+
+    /**
+     * Counts the values of the part of the array, the counters are split to four histograms,
+     * so the equal neighbouring values don't wait for each other's increments.
+     * @param value - returns the i-th value
+     */
+    template<typename Value>
+    void countValues(std::size_t count, Value value);
+};
+
+#endif //HISTOGRAM_H
@@ -9,6 +9,17 @@
  * It will pass you all the necessary virtual methods that you should implement in the new image format.
  */
 class Image : public ImageProcessing, public ImageReader {
+public:
+    virtual ~Image() = default;
+
+    /**
+     * Creates the independent copy of the image, fe. for the branches of the pipeline or to keep the original.
+     * The pixels are shared until one of the images changes them, so the copy costs O(1).
+     * @return Image * - new image, the caller is its owner
+     */
+    virtual Image * clone() const = 0;
+
+private:
     /**
      * Validate the Image.
      */
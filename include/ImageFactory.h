@@ -0,0 +1,65 @@
+#ifndef IMAGEFACTORY_H
+#define IMAGEFACTORY_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "Image.h"
+
+/**
+ * Creates the image classes for the supported file formats.
+ */
+class ImageFactory {
+public:
+    /**
+     * Supported file formats.
+     */
+    enum Format {
+        BMP,
+        PGM,
+        UNKNOWN
+    };
+
+    /**
+     * Detects the format by the extension of the file (case insensitive).
+     * @param path - path to the file
+     * @return Format - format of the file or UNKNOWN
+     */
+    static Format detectFormat(const std::string & path);
+
+    /**
+     * Detects the format by the first bytes of the image data ("BM" - BMP, "P5" - PGM).
+     * @param data - beginning of the image data
+     * @param size - number of the available bytes
+     * @return Format - format of the data or UNKNOWN
+     */
+    static Format sniffFormat(const char * data, std::size_t size);
+
+    /**
+     * Creates the image of the given format - the image is not read yet.
+     * @param format - format of the image
+     * @param file - file stream with the image data, it has to live until the image is read
+     * @return Image * - new image, the caller is its owner
+     */
+    static Image * create(Format format, std::istream & file);
+
+    /**
+     * Decodes the image that is already in the memory, the format is detected by the first bytes.
+     * The data is read straight from the memory, without copying it to any stream buffer.
+     * @param data - encoded image (BMP or PGM file content)
+     * @param size - number of bytes
+     * @return Image * - new, already read image, the caller is its owner (it has no stream, reading it again fails)
+     */
+    static Image * decode(const uint8_t * data, std::size_t size);
+
+    /**
+     * Exception thrown if the format of the file is not supported.
+     */
+    struct UnsupportedFormatException : std::exception {
+        const char * what() const noexcept override {
+            return "Wrong filename format or the file format is not supported by this program.";
+        }
+    };
+};
+
+#endif //IMAGEFACTORY_H
@@ -1,6 +1,13 @@
 #ifndef IMAGEPROCESSING_H
 #define IMAGEPROCESSING_H
 
+#include <functional>
+#include "AdaptiveThreshold.h"
+#include "ConnectedComponents.h"
+#include "Convolution.h"
+#include "Histogram.h"
+#include "Morphology.h"
+
 /**
  * Class containing virtual methods responsible for image manipulation
  * that needs to be overridden by every class with new file format.
@@ -8,6 +15,79 @@
  */
 class ImageProcessing {
 public:
+    /**
+     * Rectangle describing the region of interest.
+     * Position is counted in pixels from the top left corner of the image.
+     */
+    struct Region {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
+    /**
+     * Filters made of the convolution kernels.
+     */
+    enum Filter {
+        /**
+         * Centre minus its 4 neighbours, added to the image.
+         */
+        SHARPEN,
+
+        /**
+         * Diagonal difference added to the image, the edges look raised.
+         */
+        EMBOSS,
+
+        /**
+         * Absolute value of the 4-neighbour Laplacian of the grayscale image.
+         */
+        LAPLACIAN,
+
+        /**
+         * Magnitude of the Sobel gradient of the grayscale image.
+         */
+        SOBEL,
+
+        /**
+         * Magnitude of the Scharr gradient of the grayscale image (divided by 4 to have the range of Sobel).
+         */
+        SCHARR,
+
+        /**
+         * Magnitude of the Prewitt gradient of the grayscale image.
+         */
+        PREWITT
+    };
+
+    /**
+     * Methods of the automatic threshold of the binary image.
+     */
+    enum ThresholdMethod {
+        OTSU,
+        TRIANGLE
+    };
+
+    /**
+     * Runs the operation only inside the region - pixels outside of it stay untouched.
+     * The operation sees the region as the whole image, so the work and the memory it allocates
+     * are proportional to the region area. Operations that change the size of the image are not allowed.
+     * @param region - region of interest
+     * @param operation - operation that will be executed, fe. [&] { image->blur(); }
+     */
+    virtual void processRegion(const Region & region, const std::function<void()> & operation) = 0;
+
+    /**
+     * Returns the width of the image (in pixels).
+     */
+    virtual int getWidth() const = 0;
+
+    /**
+     * Returns the height of the image (in pixels).
+     */
+    virtual int getHeight() const = 0;
+
     /**
      * Blurs out the image.
     */
@@ -19,6 +99,27 @@ public:
      */
     virtual void toBinary(int threshold) = 0;
 
+    /**
+     * Changes the image to the binary format with the threshold computed from the histogram of the grayscale image.
+     * @param method - method of the threshold
+     */
+    virtual void toBinary(ThresholdMethod method) = 0;
+
+    /**
+     * Changes the image to the binary format, every pixel of the grayscale image is compared with the threshold
+     * computed from the window around it.
+     * @param method - method of the threshold
+     * @param radius - radius of the window
+     * @param percent - sensitivity of the method in percent
+     */
+    virtual void toBinary(AdaptiveThreshold::Method method, int radius, int percent) = 0;
+
+    /**
+     * Returns the histogram of the colour channel (one extra pass over the pixels, they are not changed).
+     * @param channel - index of the channel (0 for blue, 1 for green, 2 for red), 0 for the grayscale image
+     */
+    virtual Histogram getHistogram(int channel) const = 0;
+
     /**
      * Erodes the image - it needs to be in the binary format first.
      */
@@ -29,11 +130,55 @@ public:
      */
     virtual void dilate() = 0;
 
+    /**
+     * Erodes the image with the disk - the pixels that have any black pixel at most radius far are black,
+     * the cost doesn't depend on the radius. It needs to be in the binary format first.
+     * @param radius - radius of the disk (0 - 65535)
+     */
+    virtual void erodeDisk(int radius) = 0;
+
+    /**
+     * Dilates the image with the disk - the pixels that have any white pixel at most radius far are white,
+     * the cost doesn't depend on the radius. It needs to be in the binary format first.
+     * @param radius - radius of the disk (0 - 65535)
+     */
+    virtual void dilateDisk(int radius) = 0;
+
+    /**
+     * Executes erode and dilate together (fe. opening is erode and dilate) without the intermediate image,
+     * the result is the same as the one of the separate operations - it needs to be in the binary format first.
+     * @param operation - the operation
+     */
+    virtual void morphology(Morphology::Operation operation) = 0;
+
+    /**
+     * Labels the connected components of the white pixels - the image is changed to the label image
+     * (every component has its own colour, the background is black). It needs to be in the binary format first.
+     * @param connectivity - neighbours of the pixel
+     * @return statistics of the components, the coordinates are counted from the top left corner of the image
+     */
+    virtual std::vector<ConnectedComponents::Component> labelComponents(
+            ConnectedComponents::Connectivity connectivity) = 0;
+
     /**
      * Changes the image colours to negative.
      */
     virtual void toNegative() = 0;
 
+    /**
+     * Histogram equalization - spreads the values evenly over the whole range. The colour image uses the histogram
+     * of its luminance and the same table for all the channels, so the hues are kept.
+     */
+    virtual void equalize() = 0;
+
+    /**
+     * Linear contrast stretch - the darkest values are changed to 0, the brightest ones to the maximal value
+     * and the values between them are stretched. The colour image uses the histogram of its luminance.
+     * @param percent - percent of the darkest and of the brightest values that are clipped (0 - 50),
+     *                  0 stretches the smallest and the biggest value
+     */
+    virtual void stretchContrast(double percent) = 0;
+
     /**
      * Takes the width and height dimensions (in pixels) - and performs the scale up or down algorithms on the image.
      * @param newWidth
@@ -60,6 +205,20 @@ public:
      */
     virtual void edgeFilter() = 0;
 
+    /**
+     * Applies the convolution filter to the image.
+     * @param filter - the filter
+     * @param border - how the pixels outside of the image are computed
+     */
+    virtual void filter(Filter filter, const Convolution::Border & border) = 0;
+
+    /**
+     * Convolves the image with the kernel known at the run time.
+     * @param kernel - the kernel, its result is clamped to the range of the image
+     * @param border - how the pixels outside of the image are computed
+     */
+    virtual void convolve(const Convolution::KernelMatrix & kernel, const Convolution::Border & border) = 0;
+
     /**
      * Reduces noise in the image.
      * @param size - more specific - radius of the window which will be used to reduce noise in the image.
@@ -77,7 +236,25 @@ public:
      */
     struct NotInBinaryFormatException : std::exception {
         const char * what() const noexcept override {
-            return "The image data needs to be in binary format.";
+            return "The image data (or the region of interest) needs to be in binary format.";
+        }
+    };
+
+    /**
+     * Exception thrown if the region of interest is empty or doesn't fit in the image.
+     */
+    struct RegionOutOfBoundsException : std::exception {
+        const char * what() const noexcept override {
+            return "The region of interest needs to be inside the image.";
+        }
+    };
+
+    /**
+     * Exception thrown if the operation executed inside the region of interest changed its size.
+     */
+    struct RegionSizeChangedException : std::exception {
+        const char * what() const noexcept override {
+            return "Operations changing the size of the image can't be used inside the region of interest.";
         }
     };
 };
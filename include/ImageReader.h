@@ -1,6 +1,12 @@
 #ifndef IMAGEREADER_H
 #define IMAGEREADER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+#include "MemoryStream.h"
+
 /**
  * Basic methods that need to be implemented to make image format classes compatible with the rest of the code.
  * Reading is different for every format so there will be no forced methods.
@@ -9,9 +15,9 @@ class ImageReader {
 private:
 
     /**
-     * Filestream of the file image data.
+     * Stream of the image data - the file or the data that is already in the memory, nullptr if there is none.
      */
-    std::fstream *fileStream;
+    std::istream *fileStream = nullptr;
 
     /**
      * Checks the signature of the image
@@ -21,38 +27,103 @@ private:
     virtual bool checkSignature() = 0;
 public:
 
+    /**
+     * Number of bytes read from or written to the stream at once while processing the pixels.
+     */
+    static const std::size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
     /**
     * Read the Image data.
     */
     virtual void read() = 0;
 
+    /**
+     * Writes the encoded image to the stream.
+     * @param stream - stream to which the image will be written
+     */
+    virtual void save(std::ostream & stream) const = 0;
+
     /**
      * Saves the image to the path that is passed via parameter.
      * @param path - path to the new image
      */
-    virtual void save(std::string path) const = 0;
+    void save(const std::string & path) const {
+        std::fstream toWrite(path, std::ios::out | std::ios::binary);
+        if (!toWrite) {
+            throw ImageSaveException();
+        }
+
+        this->save(static_cast<std::ostream &>(toWrite));
+        toWrite.close();
+        if (!toWrite) {
+            throw ImageSaveException();
+        }
+    }
+
+    /**
+     * Encodes the image into the buffer supplied by the caller, its memory is reused when it's big enough.
+     * @param buffer - buffer that will contain only the encoded image
+     */
+    void encode(std::vector<uint8_t> & buffer) const {
+        buffer.clear();
+        VectorOutputStream stream(buffer);
+        this->save(static_cast<std::ostream &>(stream));
+    }
+
+    /**
+     * Encodes the image into the new buffer.
+     * @return encoded image
+     */
+    std::vector<uint8_t> encode() const {
+        std::vector<uint8_t> buffer;
+        this->encode(buffer);
+        return buffer;
+    }
 
     /**
      * Sets the file stream to the class member
-     * @param streamToSet - fstream to set
+     * @param streamToSet - stream to set
      */
-    void setFileStream(std::fstream & streamToSet) {
+    void setFileStream(std::istream & streamToSet) {
         this->fileStream = &streamToSet;
     }
 
     /**
-     * Returns the fstream to the input image file data.
+     * Forgets the stream (fe. the stream in the memory that is destroyed), reading then fails
+     * with OpeningTheFileException.
+     */
+    void clearFileStream() {
+        this->fileStream = nullptr;
+    }
+
+    /**
+     * Returns the stream of the input image data.
      * @return
      */
-    std::fstream * getFileStream() {
+    std::istream * getFileStream() const {
         return this->fileStream;
     }
 
     /**
-     * Closes the file stream.
+     * Returns the pointer to the next bytes of the input and skips them if the input is already in the memory,
+     * so they can be copied straight to the pixels.
+     * @param size - number of bytes
+     * @return pointer to the bytes or nullptr if the input is not in the memory or it's shorter
+     */
+    const char * takeMemory(std::size_t size) {
+        auto * memory = dynamic_cast<MemoryStreamBuffer *>(this->fileStream->rdbuf());
+        return memory != nullptr ? memory->take(size) : nullptr;
+    }
+
+    /**
+     * Closes the file stream, streams of the data in the memory don't need to be closed.
      */
     void closeFileStream() {
-        this->fileStream->close();
+        if (auto * file = dynamic_cast<std::fstream *>(this->fileStream)) {
+            file->close();
+        } else if (auto * inputFile = dynamic_cast<std::ifstream *>(this->fileStream)) {
+            inputFile->close();
+        }
     }
 
     /**
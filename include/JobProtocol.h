@@ -0,0 +1,94 @@
+#ifndef JOBPROTOCOL_H
+#define JOBPROTOCOL_H
+
+#include <string>
+#include <vector>
+
+/**
+ * Messages exchanged by the imgm server and its clients over the Unix domain socket (one job per connection).
+ *
+ * Request:  "IMGM <number of arguments> <number of inline bytes>\n", every argument in its own line,
+ *           then the inline image data (only if the input is "-").
+ * Response: "<exit code> <read seconds> <process seconds>\n", the step that failed (or empty) in one line,
+ *           the description of the problem (or empty) in one line.
+ *
+ * Arguments are the same as the arguments of the single image mode (-i <file> <flags> -o <file>),
+ * paths are absolute because the server doesn't share the working directory with the client.
+ */
+class JobProtocol {
+public:
+    /**
+     * Maximal number of the arguments, maximal length of a single line and maximal size of the inline data
+     * accepted by the server (the data is allocated before it's read).
+     */
+    static const std::size_t MAX_ARGUMENTS = 1024;
+    static const std::size_t MAX_LINE = 4096;
+    static const std::size_t MAX_DATA = (std::size_t) 1 << 30;
+
+    struct Request {
+        std::vector<std::string> arguments;
+        /**
+         * Image data passed inline instead of the input path.
+         */
+        std::vector<char> data;
+    };
+
+    struct Response {
+        /**
+         * Exit code that the single image mode would return for the job.
+         */
+        int code;
+        double readSeconds;
+        double processSeconds;
+        std::string step;
+        std::string description;
+    };
+
+    /**
+     * Opens the connection with the server.
+     * @param socketPath - path of the server socket
+     * @return int - descriptor of the connection
+     */
+    static int connectTo(const std::string & socketPath);
+
+    /**
+     * Creates the socket of the server, the old socket file is removed.
+     * @param socketPath - path of the socket
+     * @param backlog - maximal number of the connections waiting to be accepted
+     * @return int - descriptor of the listening socket
+     */
+    static int listenOn(const std::string & socketPath, int backlog);
+
+    /**
+     * Limits how long sending or receiving can wait for the other side, the operation then fails
+     * with ProtocolException.
+     * @param connection - descriptor of the connection
+     * @param seconds - maximal time without any progress
+     */
+    static void setTimeout(int connection, int seconds);
+
+    static void writeRequest(int connection, const Request & request);
+    static Request readRequest(int connection);
+    static void writeResponse(int connection, const Response & response);
+    static Response readResponse(int connection);
+
+    /**
+     * Exception thrown when the connection failed or the message is not correct.
+     */
+    struct ProtocolException : std::exception {
+        std::string description;
+
+        explicit ProtocolException(std::string description) : description(std::move(description)) {}
+
+        const char * what() const noexcept override {
+            return description.c_str();
+        }
+    };
+
+private:
+    static void writeAll(int connection, const char * data, std::size_t size);
+    static void readAll(int connection, char * data, std::size_t size);
+    static std::string readLine(int connection);
+};
+
+#endif //JOBPROTOCOL_H
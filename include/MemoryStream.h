@@ -0,0 +1,114 @@
+#ifndef MEMORYSTREAM_H
+#define MEMORYSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+/**
+ * Stream buffer reading straight from the memory owned by the caller - nothing is copied until the data is read.
+ * The memory has to live as long as the buffer.
+ */
+class MemoryStreamBuffer : public std::streambuf {
+public:
+    MemoryStreamBuffer(const uint8_t * data, std::size_t size) {
+        char * begin = const_cast<char *>(reinterpret_cast<const char *>(data));
+        this->setg(begin, begin, begin + size);
+    }
+
+    /**
+     * Returns the pointer to the next bytes and skips them, so the reader can copy them itself.
+     * @param size - number of bytes
+     * @return pointer to the bytes or nullptr if there is less of them (the position doesn't change then)
+     */
+    const char * take(std::size_t size) {
+        if ((std::size_t) (this->egptr() - this->gptr()) < size) {
+            return nullptr;
+        }
+
+        const char * data = this->gptr();
+        this->setg(this->eback(), this->gptr() + size, this->egptr());
+        return data;
+    }
+
+protected:
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override {
+        if (!(which & std::ios_base::in)) {
+            return pos_type(off_type(-1));
+        }
+
+        char * base = direction == std::ios_base::beg ? this->eback()
+                    : direction == std::ios_base::cur ? this->gptr() : this->egptr();
+        off_type position = (base - this->eback()) + offset;
+        if (position < 0 || position > this->egptr() - this->eback()) {
+            return pos_type(off_type(-1));
+        }
+
+        this->setg(this->eback(), this->eback() + position, this->egptr());
+        return pos_type(position);
+    }
+
+    pos_type seekpos(pos_type position, std::ios_base::openmode which) override {
+        return this->seekoff(off_type(position), std::ios_base::beg, which);
+    }
+};
+
+/**
+ * Input stream of the image data that is already in the memory.
+ */
+class MemoryInputStream : public std::istream {
+public:
+    MemoryInputStream(const uint8_t * data, std::size_t size) : std::istream(nullptr), buffer(data, size) {
+        this->rdbuf(&this->buffer);
+    }
+
+    MemoryStreamBuffer & getBuffer() {
+        return this->buffer;
+    }
+
+private:
+    MemoryStreamBuffer buffer;
+};
+
+/**
+ * Stream buffer appending everything to the vector owned by the caller.
+ */
+class VectorStreamBuffer : public std::streambuf {
+public:
+    explicit VectorStreamBuffer(std::vector<uint8_t> & data) : data(data) {}
+
+protected:
+    int_type overflow(int_type sign) override {
+        if (!traits_type::eq_int_type(sign, traits_type::eof())) {
+            this->data.push_back((uint8_t) traits_type::to_char_type(sign));
+        }
+
+        return traits_type::not_eof(sign);
+    }
+
+    std::streamsize xsputn(const char * bytes, std::streamsize count) override {
+        this->data.insert(this->data.end(), bytes, bytes + count);
+        return count;
+    }
+
+private:
+    std::vector<uint8_t> & data;
+};
+
+/**
+ * Output stream writing the encoded image to the vector.
+ */
+class VectorOutputStream : public std::ostream {
+public:
+    explicit VectorOutputStream(std::vector<uint8_t> & data) : std::ostream(nullptr), buffer(data) {
+        this->rdbuf(&this->buffer);
+    }
+
+private:
+    VectorStreamBuffer buffer;
+};
+
+#endif //MEMORYSTREAM_H
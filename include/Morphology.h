@@ -0,0 +1,92 @@
+#ifndef MORPHOLOGY_H
+#define MORPHOLOGY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/**
+ * Erode and dilate of the binary image executed together - the image is processed in the bands of the rows,
+ * the first operation is computed only for the rows the second one needs, so the intermediate image is never
+ * allocated and the masks of one band stay in the cache. The bands of the big images are spread between the threads.
+ * The result is the same as the one of the two operations executed one after the other.
+ */
+class Morphology {
+public:
+    /**
+     * Opening - erode and dilate, removes the small white spots.
+     * Closing - dilate and erode, fills the small black holes.
+     * Top-hat - image minus its opening, the small white spots only.
+     * Black-hat - closing minus the image, the small black holes only.
+     * Gradient - dilated minus eroded image, the outlines of the shapes.
+     */
+    enum Operation {
+        OPENING,
+        CLOSING,
+        TOP_HAT,
+        BLACK_HAT,
+        GRADIENT
+    };
+
+    /**
+     * One erode or dilate - the pixels having the value in their square window are set to the value.
+     */
+    struct Spread {
+        uint8_t value;
+        int radius;
+    };
+
+    /**
+     * Writes the mask of the pixels first - first + count (counted from the top left pixel) that have the value,
+     * 255 for them, 0 for the others.
+     */
+    using Matcher = std::function<void(uint8_t value, std::size_t first, std::size_t count, uint8_t * mask)>;
+
+    /**
+     * Writes the result of the pixels first - first + count, the masks are set for the pixels changed
+     * by the first and by the second spread.
+     */
+    using Writer = std::function<void(std::size_t first, std::size_t count, const uint8_t * firstMask,
+                                      const uint8_t * secondMask)>;
+
+    /**
+     * Returns true if the second spread works on the result of the first one (all the operations except gradient,
+     * it spreads both values over the original image).
+     */
+    static bool isChained(Operation operation);
+
+    /**
+     * Returns true if the operation starts with dilate (closing and black-hat).
+     */
+    static bool startsWithDilate(Operation operation);
+
+    /**
+     * Computes the masks of both spreads band by band and passes them to the writer, the bands are disjoint,
+     * so the matcher and the writer can be called from more threads at once.
+     * @param first - first spread
+     * @param second - second spread, its value has to differ from the value of the first one
+     * @param chained - true if the second spread works on the result of the first one
+     */
+    static void apply(int width, int height, const Spread & first, const Spread & second, bool chained,
+                      const Matcher & match, const Writer & write);
+
+    /**
+     * Computes the values of the result of the operation.
+     * @param values - original values (count values, all the channels of the pixels)
+     * @param firstMask - mask of the first spread for every value
+     * @param secondMask - mask of the second spread for every value
+     * @param destination - count values of the result
+     */
+    static void combine(Operation operation, const uint8_t * values, const uint8_t * firstMask,
+                        const uint8_t * secondMask, uint8_t * destination, std::size_t count, const Spread & first,
+                        const Spread & second);
+
+private:
+    /**
+     * Computes the masks of the rows firstRow - lastRow (exclusive) and writes them.
+     */
+    static void applyBand(int width, int height, const Spread & first, const Spread & second, bool chained,
+                          const Matcher & match, const Writer & write, int firstRow, int lastRow);
+};
+
+#endif //MORPHOLOGY_H
@@ -0,0 +1,102 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Hardware performance counters of the thread that opened them (Linux perf_event_open). The work of the other threads
+ * (the workers of the pools, the parts split by ThreadPool::runParts) is not included, so the Profiler leaves out
+ * the counts of the stages that ran more threads.
+ * Counters are opened for the user space only, so they work unprivileged when perf_event_paranoid <= 2.
+ * Every counter that can't be opened (no permission, virtual machine, other system) is simply unavailable,
+ * the rest keeps working.
+ */
+class PerfCounters {
+public:
+    /**
+     * Counted hardware events.
+     */
+    enum Counter {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_REFERENCES,
+        CACHE_MISSES,
+        BRANCHES,
+        BRANCH_MISSES,
+        COUNTERS_COUNT
+    };
+
+    /**
+     * Values of all the counters - values of unavailable counters are 0.
+     */
+    struct Values {
+        bool available[COUNTERS_COUNT];
+        uint64_t values[COUNTERS_COUNT];
+
+        /**
+         * Returns the difference between this and the earlier values.
+         */
+        Values operator-(const Values & earlier) const;
+
+        /**
+         * Instructions per cycle or -1 if it can't be calculated.
+         */
+        double getIpc() const;
+
+        /**
+         * Percentage of cache references that missed the last level cache or -1 if it can't be calculated.
+         */
+        double getCacheMissRate() const;
+
+        /**
+         * Percentage of mispredicted branches or -1 if it can't be calculated.
+         */
+        double getBranchMissRate() const;
+
+        /**
+         * Estimated memory traffic - every last level cache miss is counted as one 64 byte line.
+         * The real bandwidth counters are in the uncore PMU that is not available for unprivileged users.
+         * @param seconds - duration of the measurement
+         * @return GB/s or -1 if it can't be calculated
+         */
+        double getMemoryBandwidth(double seconds) const;
+    };
+
+    /**
+     * Opens all the counters that are available for the calling thread - counting starts immediately.
+     * The counters of every ratio are opened as one group, so they are multiplexed together.
+     */
+    PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters & operator=(const PerfCounters &) = delete;
+
+    ~PerfCounters();
+
+    /**
+     * Returns true if at least one counter is available.
+     */
+    bool isAvailable() const;
+
+    /**
+     * Returns the reason why the counters are not available (empty if all of them work).
+     */
+    const std::string & getErrorMessage() const;
+
+    /**
+     * Reads all the counters - values are scaled if the kernel had to multiplex them.
+     */
+    Values read() const;
+
+    /**
+     * Returns the short name of the counter.
+     */
+    static const char * getName(Counter counter);
+
+private:
+    int descriptors[COUNTERS_COUNT];
+    std::string errorMessage;
+};
+
+#endif //PERFCOUNTERS_H
@@ -6,43 +6,23 @@
 #include <vector>
 #include <algorithm>
 #include <cmath>
-#include "Image.h"
-#include "PixelManager.h"
+#include "RasterImage.h"
 
 /**
  * PGM (portable graymap format) class.
- * Uses uint8_t datatype pixel representation that is passed to the PixelManager class.
+ * Reads and writes the single channel of the uint8_t pixels, the operations are implemented by the RasterImage.
  */
-class PgmImage : public Image, public PixelManager<uint8_t> {
+class PgmImage : public RasterImage {
 
     /**
      * Char values representing whitespaces
      */
     std::vector<char> * whitespaces = new std::vector<char>{10, 13, 32, 9};
 
-    /**
-     * Width of the image - in pixels
-     */
-    int width;
-
-    /**
-     * Height of the image - in pixels
-     */
-    int height;
-
-    /**
-     * Max value representing the colour
-     */
-    uint8_t maxVal;
-
-    /**
-     * Contains the information if the image is in the binary format
-     */
-    bool isBinary;
-
     // Utils
     /**
-     * Reads the char values to the next whitespace from the file stream
+     * Reads the char values to the next whitespace from the file stream, WrongFileFormatException is thrown
+     * if the stream ends before it
      * @return
      */
     std::vector<char> readToTheNextWhitespace();
@@ -50,7 +30,7 @@ class PgmImage : public Image, public PixelManager<uint8_t> {
     // Additional file methods
 
     /**
-     * Reads the file info header and passing the values to the width, height, maxVal class members.
+     * Reads the file info header and passing the values to the width, height, maxValue class members.
      */
     void readInfoHeader();
 
@@ -61,35 +41,38 @@ class PgmImage : public Image, public PixelManager<uint8_t> {
 
     /**
      * Reads the Pixels from the fstream
+     * @param reuse - if true, the pixels are read to the current array (the size of the image didn't change)
      */
-    void readPixels();
+    void readPixels(bool reuse);
 
     // override
     bool checkSignature() override;
 
+    /**
+     * Copies the image information of the other image and shares its pixels, used by clone.
+     * @param other - image to copy
+     */
+    PgmImage(const PgmImage & other);
+
 public:
-    explicit PgmImage(std::fstream& file);
+    explicit PgmImage(std::istream& file);
+
+    ~PgmImage() override;
 
     // override
     // ImageReader
 
     void validate() override;
     void read() override;
-    void save(std::string path) const override;
-
-    // Image processing
-
-    void blur() override;
-    void toBinary(int threshold) override;
-    void erode() override;
-    void dilate() override;
-    void toNegative() override;
-    void scale(int newWidth, int newHeight) override;
-    void scaleUp(int newWidth, int newHeight) override;
-    void scaleDown(int newWidth, int newHeight) override;
-    void edgeFilter() override;
-    void denoise(int size) override;
-    void rotate(float degree) override;
+    Image * clone() const override;
+
+    /**
+     * Reads the next image from the stream of the concatenated images, the stream is not closed.
+     * The current pixel array is reused if the new image has the same size.
+     */
+    void readFrame();
+    using ImageReader::save;
+    void save(std::ostream & stream) const override;
 };
 
 #endif //PGMIMAGE_H
@@ -0,0 +1,344 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Image.h"
+#include "Profiler.h"
+
+/**
+ * Sequence of the operations parsed from the program arguments (fe. -dn 5 -g 1 -o out.bmp).
+ * The arguments are parsed and validated once, then the pipeline can be executed on any number of images.
+ * Steps in the brackets are the branch - it works on its own copy of the image, fe. for
+ * "-dn 5 { -g 1 -o edges.bmp } { -b 1 -o soft.bmp }" the noise is reduced once and both branches start from
+ * that result. Branches next to each other are executed concurrently, the steps after them continue
+ * with the image from before the branches.
+ */
+class Pipeline {
+public:
+    /**
+     * Path of the standard input (-i -) or output (-o -).
+     */
+    static constexpr const char * STANDARD_STREAM = "-";
+
+    /**
+     * Enum containing all the possible pipeline arguments
+     */
+    enum Arguments {
+        OUTPUT,
+        RESOLUTION_CHANGE,
+        NEGATIVE,
+        BLUR,
+        DENOISE,
+        GRADIENT,
+        BINARY,
+        ERODE,
+        DILATE,
+        MORPHOLOGY,
+        COMPONENTS,
+        ROTATE,
+        FILTER,
+        KERNEL,
+        EQUALIZE,
+        STRETCH,
+        REGION,
+        BRANCH,
+        HELP,
+        INVALID
+    };
+
+    /**
+     * Single operation of the pipeline with its already parsed parameters.
+     */
+    struct Step {
+        Arguments argument;
+        /**
+         * Flag and its parameters as they were passed, fe. "-rs 100 200".
+         */
+        std::string name;
+        /**
+         * Output path (template) of the OUTPUT step, "-" is the standard output. Path (template) of the statistics
+         * of the COMPONENTS step, empty if they are not saved.
+         */
+        std::string path;
+        /**
+         * Integer parameters of the step (size, threshold, width and height, region, filter and border,
+         * border and kernel weights, stretch percent, morphological operation, disk radius, connectivity).
+         * The automatic threshold is AUTOMATIC_THRESHOLD followed by its method, the adaptive one
+         * is ADAPTIVE_THRESHOLD followed by its method, radius and percent.
+         */
+        std::vector<int> values;
+        /**
+         * Rotation degree of the ROTATE step.
+         */
+        float degree;
+        /**
+         * Border of the FILTER and KERNEL step.
+         */
+        Convolution::Border border;
+        /**
+         * Kernel of the KERNEL step.
+         */
+        std::shared_ptr<const Convolution::KernelMatrix> kernel;
+        /**
+         * True if the REGION step resets the region to the whole image.
+         */
+        bool wholeImage;
+        /**
+         * Steps of the BRANCH step.
+         */
+        std::shared_ptr<const Pipeline> branch;
+    };
+
+    /**
+     * Parses the arguments - all of them have to be operations (the input is not part of the pipeline).
+     * @param arguments - program arguments
+     */
+    explicit Pipeline(const std::vector<std::string> & arguments);
+
+    /**
+     * Executes all the steps on the image.
+     * Output paths are templates - {name}, {ext}, {dir} and {index} are replaced with the input file name
+     * (without the extension), its extension, its directory and the index of the input.
+     * @param image - image that will be processed
+     * @param inputPath - path of the input image, used by the output templates
+     * @param index - index of the input image, used by the output templates
+     * @param profiler - if passed, every step is measured as its stage
+     */
+    void run(Image & image, const std::string & inputPath, int index = 0, Profiler * profiler = nullptr) const;
+
+    /**
+     * Executes the steps from first (inclusive) to last (exclusive), so the pipeline can be split between threads.
+     * The region of interest set before the first step is not known, the steps start on the whole image.
+     * @param image - image that will be processed
+     * @param inputPath - path of the input image, used by the output templates
+     * @param index - index of the input image, used by the output templates
+     * @param first - index of the first executed step
+     * @param last - index after the last executed step
+     * @param profiler - if passed, every step is measured as its stage
+     */
+    void run(Image & image, const std::string & inputPath, int index, std::size_t first, std::size_t last,
+             Profiler * profiler = nullptr) const;
+
+    /**
+     * Returns the index of the first step of the trailing outputs - steps from it to the end only save the image
+     * (fe. for "-dn 5 -g 1 -o a.bmp -o b.bmp" it's 2), so they can be executed by the writer.
+     */
+    std::size_t getOutputStart() const;
+
+    /**
+     * Returns all the steps of the pipeline.
+     */
+    const std::vector<Step> & getSteps() const;
+
+    /**
+     * Returns true if the help message was requested (-h).
+     */
+    bool isHelpRequested() const;
+
+    /**
+     * Returns the paths (templates) of all the outputs, also the ones in the branches.
+     */
+    std::vector<std::string> getOutputPaths() const;
+
+    /**
+     * Returns the paths (templates) of the statistics of the components, also the ones in the branches.
+     */
+    std::vector<std::string> getStatisticsPaths() const;
+
+    /**
+     * Returns true if any output is the standard output (-o -), so the messages can't be printed to it.
+     */
+    bool writesToStandardOutput() const;
+
+    /**
+     * Returns true if every output path (and every path of the statistics) contains {name} or {index},
+     * so every input gets its own output.
+     */
+    bool hasUniqueOutputs() const;
+
+    /**
+     * Replaces the placeholders in the output path template.
+     * @param pattern - output path template
+     * @param inputPath - path of the input image
+     * @param index - index of the input image
+     * @return output path
+     */
+    static std::string expandOutputPath(const std::string & pattern, const std::string & inputPath, int index);
+
+    /**
+     * Checks if the string is the parameter (fe. 100) and not the flag (fe. -b).
+     * @param toValidate
+     * @return bool - true if the parameter is in the correct form, false otherwise.
+     */
+    static bool isParameter(const std::string & toValidate);
+
+    /**
+     * Exception thrown when one of the steps couldn't be parsed or executed.
+     * It keeps the step (argument) and the description of the original problem.
+     */
+    struct StepException : std::exception {
+        std::string step;
+        std::string description;
+
+        StepException(std::string step, std::string description)
+                : step(std::move(step)), description(std::move(description)) {}
+
+        const char * what() const noexcept override {
+            return description.c_str();
+        }
+    };
+
+    /**
+     * Exception that is thrown when filename was not passed via program arguments.
+     */
+    struct NoFileNameException : std::exception {
+        const char * what () const noexcept override {
+            return "Mandatory filename parameter not passed to argument";
+        }
+    };
+
+    /**
+     * Exception that is thrown when argument was not recognized.
+     */
+    struct WrongArgument : std::exception {
+        const char * what() const noexcept override {
+            return "This argument is not supported by this program.";
+        }
+    };
+
+    /**
+     * Exception that is thrown when argument has a parameter that is not supported by this program.
+     */
+    struct UnsupportedTypeParameter : std::exception {
+        const char * what() const noexcept override {
+            return "Unsupported type method";
+        }
+    };
+
+    /**
+     * Exception thrown when there is a missing parameter in argument
+     */
+    struct MissingArgumentParameter : std::exception {
+        const char * what () const noexcept override {
+            return "Missing argument parameter";
+        }
+    };
+
+    /**
+     * Exception thrown when the branch is not closed.
+     */
+    struct UnclosedBranchException : std::exception {
+        const char * what () const noexcept override {
+            return "The branch needs to be closed with }";
+        }
+    };
+
+    /**
+     * Exception thrown when there is any problem with argument parameter.
+     */
+    struct WrongArgumentParameter : std::exception {
+        const char * what () const noexcept override {
+            return "Bad argument parameter";
+        }
+    };
+
+private:
+    /**
+     * First value of the BINARY step with the automatic or the adaptive threshold (the fixed threshold is 0 - 255).
+     */
+    static const int AUTOMATIC_THRESHOLD = -1;
+    static const int ADAPTIVE_THRESHOLD = -2;
+
+    std::vector<Step> steps;
+    bool helpRequested = false;
+
+    /**
+     * Executes the steps from first to last starting with the given region of interest.
+     */
+    void execute(Image & image, const std::string & inputPath, int index, std::size_t first, std::size_t last,
+                 Profiler * profiler, ImageProcessing::Region region, bool regionSet) const;
+
+    /**
+     * Executes the branches next to each other - every branch gets its own copy of the image
+     * (the last one gets the image itself if nothing follows it) and runs in its own thread.
+     * The copies share the pixels until they are changed, so they cost O(1).
+     * @param first - index of the first BRANCH step
+     * @param last - index after the last BRANCH step
+     */
+    void executeBranches(Image & image, const std::string & inputPath, int index, std::size_t first,
+                         std::size_t last, ImageProcessing::Region region, bool regionSet) const;
+
+    /**
+     * Saves the statistics of the components, the components found in the region of interest are moved
+     * to the coordinates of the whole image.
+     */
+    static void saveComponents(std::vector<ConnectedComponents::Component> & components, const std::string & path,
+                               const ImageProcessing::Region & region, bool regionSet);
+
+    /**
+     * Function that gives the proper Argument by passed string.
+     * @param argument - string that will be checked
+     * @return - Proper Argument or invalid.
+     */
+    static Arguments stringToArgument(const std::string & argument);
+
+    /**
+     * Parses the integer parameter.
+     * @param arguments - program arguments
+     * @param index - index of the parameter
+     * @return int - value of the parameter
+     */
+    static int parseInt(const std::vector<std::string> & arguments, std::size_t index);
+
+    /**
+     * Gives the method of the automatic threshold by its name (auto is Otsu).
+     * @param name - name of the method
+     * @param method - the method, it's set only if the name is known
+     * @return true if the name is the method
+     */
+    static bool stringToThresholdMethod(const std::string & name, ImageProcessing::ThresholdMethod & method);
+
+    /**
+     * Gives the method of the adaptive threshold by its name (bradley or sauvola).
+     * @param name - name of the method
+     * @param method - the method, it's set only if the name is known
+     * @return true if the name is the method
+     */
+    static bool stringToAdaptiveMethod(const std::string & name, AdaptiveThreshold::Method & method);
+
+    /**
+     * Parses the optional non-negative integer parameter - it's used only if the next argument is the number.
+     * @param arguments - program arguments
+     * @param argNum - index of the last parsed argument, it's moved after the parameter
+     * @param defaultValue - value returned if there is no number
+     * @return int - value of the parameter
+     */
+    static int parseOptionalInt(const std::vector<std::string> & arguments, std::size_t & argNum, int defaultValue);
+
+    /**
+     * Gives the filter by its name (sharpen, emboss, laplacian, sobel, scharr, prewitt).
+     * @param name - name of the filter
+     * @return the filter
+     */
+    static ImageProcessing::Filter stringToFilter(const std::string & name);
+
+    /**
+     * Gives the morphological operation by its name (open, close, tophat, blackhat, gradient).
+     * @param name - name of the operation
+     * @return the operation
+     */
+    static Morphology::Operation stringToMorphology(const std::string & name);
+
+    /**
+     * Parses the optional border after the filter (clamp, reflect or constant followed by its value),
+     * the default is clamp.
+     * @param arguments - program arguments
+     * @param argNum - index of the last parsed argument, it's moved after the border
+     * @return the border
+     */
+    static Convolution::Border parseBorder(const std::vector<std::string> & arguments, std::size_t & argNum);
+};
+
+#endif //PIPELINE_H
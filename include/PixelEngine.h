@@ -0,0 +1,255 @@
+#ifndef PIXELENGINE_H
+#define PIXELENGINE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Tools.h"
+
+/**
+ * Algorithms of the image operations, written once for every image format.
+ * The image is row-major and its pixels have CHANNELS interleaved 8-bit values, every channel is processed
+ * independently. The number of channels is known at the compile time, so the loops over the channels are unrolled
+ * and the single channel images (PGM, planar BMP) don't pay for the channels at all.
+ * The destination has to have the size of the result and can't overlap the source.
+ * @tparam CHANNELS - number of the interleaved channels (1 for PGM, 3 for BGR, 4 for BGRX)
+ */
+template<int CHANNELS>
+class PixelEngine {
+    static_assert(CHANNELS > 0, "Pixels need at least one channel.");
+
+public:
+    /**
+     * Median of the square window (size x size) around every value, the window is cut at the borders.
+     */
+    static void denoise(const uint8_t * source, uint8_t * destination, int width, int height, int size);
+
+    /**
+     * Sobel operator - the magnitude of the gradient clamped to maxValue.
+     * The window of the radius 3 is copied row by row and the operator reads its first values
+     * as if they were the 3x3 neighbourhood.
+     */
+    static void edgeFilter(const uint8_t * source, uint8_t * destination, int width, int height, uint8_t maxValue);
+
+    /**
+     * Nearest neighbour scaling to the bigger size.
+     */
+    static void scaleUp(const uint8_t * source, int width, int height, uint8_t * destination, int newWidth,
+                        int newHeight);
+
+    /**
+     * Box filter scaling to the smaller size - every value is the average of its box in the source.
+     */
+    static void scaleDown(const uint8_t * source, int width, int height, uint8_t * destination, int newWidth,
+                          int newHeight);
+
+    /**
+     * Rotation around the centre without aliasing, the positions without the source pixel are 0.
+     * The angle is in the coordinates of the array (the first row is y = 0).
+     * @param degree - angle in degrees
+     */
+    static void rotate(const uint8_t * source, uint8_t * destination, int width, int height, double degree);
+
+private:
+    static std::ptrdiff_t getIndex(int x, int y, int width) {
+        return (x + static_cast<std::ptrdiff_t>(y) * width) * CHANNELS;
+    }
+
+    /**
+     * Copies the channels one by one - the loop is unrolled, so it's faster than the call of memmove for few bytes.
+     */
+    static void copyPixel(const uint8_t * source, uint8_t * destination) {
+        for (int channel = 0; channel < CHANNELS; channel++) {
+            destination[channel] = source[channel];
+        }
+    }
+};
+
+/**
+ * Calls the operation with the engine for the number of channels known only at the run time,
+ * fe. forChannels(channels, [&](auto engine) { decltype(engine)::denoise(...); }).
+ * @param channels - number of the interleaved channels, 1, 3 or 4
+ * @param operation - generic callable taking PixelEngine<CHANNELS>
+ */
+template<typename OPERATION>
+void forChannels(int channels, OPERATION && operation) {
+    switch (channels) {
+        case 1:
+            operation(PixelEngine<1>());
+            break;
+        case 3:
+            operation(PixelEngine<3>());
+            break;
+        case 4:
+        default:
+            operation(PixelEngine<4>());
+            break;
+    }
+}
+
+template<int CHANNELS>
+void PixelEngine<CHANNELS>::denoise(const uint8_t * source, uint8_t * destination, int width, int height,
+                                    int size) {
+    int radius = (size - 1) / 2;
+    auto windowSize = (std::size_t) (2 * radius + 1) * (2 * radius + 1);
+    std::vector<uint8_t> values(windowSize * CHANNELS);
+
+    for (int row = 0; row < height; row++) {
+        int topEdge = std::min(row + radius, height - 1);
+        int bottomEdge = std::max(row - radius, 0);
+
+        for (int column = 0; column < width; column++) {
+            int leftEdge = std::max(column - radius, 0);
+            int rightEdge = std::min(column + radius, width - 1);
+
+            // the windows of all the channels are gathered at once
+            std::size_t valuesSize = 0;
+            for (int y = bottomEdge; y <= topEdge; y++) {
+                for (int x = leftEdge; x <= rightEdge; x++) {
+                    const uint8_t * pixel = source + getIndex(x, y, width);
+                    for (int channel = 0; channel < CHANNELS; channel++) {
+                        values[channel * windowSize + valuesSize] = pixel[channel];
+                    }
+                    valuesSize++;
+                }
+            }
+
+            uint8_t * result = destination + getIndex(column, row, width);
+            for (int channel = 0; channel < CHANNELS; channel++) {
+                result[channel] = Tools::median(values.data() + channel * windowSize, valuesSize);
+            }
+        }
+    }
+}
+
+template<int CHANNELS>
+void PixelEngine<CHANNELS>::edgeFilter(const uint8_t * source, uint8_t * destination, int width, int height,
+                                       uint8_t maxValue) {
+    const int kernelSize = 3; // kernel convolution matrix size
+    const int Gx[3][3] = {
+            {1, 0, -1},
+            {2, 0, -2},
+            {1, 0, -1}
+    };
+    const int Gy[3][3] = {
+            {1, 2, 1},
+            {0, 0, 0},
+            {-1, -2, -1}
+    };
+
+    // pointers to the pixels of the window, only the first of them are read
+    std::vector<const uint8_t *> matrix((std::size_t) (2 * kernelSize + 1) * (2 * kernelSize + 1), source);
+    for (int row = 0; row < height; row++) {
+        int topEdge = std::min(row + kernelSize, height - 1);
+        int bottomEdge = std::max(row - kernelSize, 0);
+
+        for (int column = 0; column < width; column++) {
+            int leftEdge = std::max(column - kernelSize, 0);
+            int rightEdge = std::min(column + kernelSize, width - 1);
+
+            std::size_t matrixIndex = 0;
+            for (int y = bottomEdge; y <= topEdge; y++) {
+                for (int x = leftEdge; x <= rightEdge; x++) {
+                    matrix[matrixIndex++] = source + getIndex(x, y, width);
+                }
+            }
+
+            uint8_t * result = destination + getIndex(column, row, width);
+            for (int channel = 0; channel < CHANNELS; channel++) {
+                int accumulatorX = 0;
+                int accumulatorY = 0;
+                for (int gY = 0; gY < kernelSize; gY++) {
+                    for (int gX = 0; gX < kernelSize; gX++) {
+                        uint8_t pixel = matrix[gX + gY * (kernelSize - 1)][channel];
+                        accumulatorX += pixel * Gx[gY][gX];
+                        accumulatorY += pixel * Gy[gY][gX];
+                    }
+                }
+
+                auto accumulator = (int) std::sqrt((accumulatorX * accumulatorX) + (accumulatorY * accumulatorY));
+                result[channel] = (uint8_t) std::min(accumulator, (int) maxValue);
+            }
+        }
+    }
+}
+
+template<int CHANNELS>
+void PixelEngine<CHANNELS>::scaleUp(const uint8_t * source, int width, int height, uint8_t * destination,
+                                    int newWidth, int newHeight) {
+    double scaleWidth = (double) width / newWidth;
+    double scaleHeight = (double) height / newHeight;
+
+    uint8_t * result = destination;
+    for (int row = 0; row < newHeight; row++) {
+        auto y = (int) (row * scaleHeight);
+        for (int column = 0; column < newWidth; column++) {
+            const uint8_t * pixel = source + getIndex((int) (column * scaleWidth), y, width);
+            copyPixel(pixel, result);
+            result += CHANNELS;
+        }
+    }
+}
+
+template<int CHANNELS>
+void PixelEngine<CHANNELS>::scaleDown(const uint8_t * source, int width, int height, uint8_t * destination,
+                                      int newWidth, int newHeight) {
+    double scaleWidth = (double) newWidth / (double) width;
+    double scaleHeight = (double) newHeight / (double) height;
+    int boxWidth = (int) std::ceil(1 / scaleWidth);
+    int boxHeight = (int) std::ceil(1 / scaleHeight);
+
+    uint8_t * result = destination;
+    for (int row = 0; row < newHeight; row++) {
+        for (int column = 0; column < newWidth; column++) {
+            int xStartOriginal = (int) std::floor(column / scaleWidth);
+            int yStartOriginal = (int) std::floor(row / scaleHeight);
+            int xStopOriginal = std::min(xStartOriginal + boxWidth, width - 1);
+            int yStopOriginal = std::min(yStartOriginal + boxHeight, height - 1);
+            int count = (xStopOriginal - xStartOriginal + 1) * (yStopOriginal - yStartOriginal + 1);
+
+            int sums[CHANNELS] = {};
+            for (int y = yStartOriginal; y <= yStopOriginal; y++) {
+                for (int x = xStartOriginal; x <= xStopOriginal; x++) {
+                    const uint8_t * pixel = source + getIndex(x, y, width);
+                    for (int channel = 0; channel < CHANNELS; channel++) {
+                        sums[channel] += pixel[channel];
+                    }
+                }
+            }
+
+            for (int channel = 0; channel < CHANNELS; channel++) {
+                result[channel] = (uint8_t) (sums[channel] / count);
+            }
+            result += CHANNELS;
+        }
+    }
+}
+
+template<int CHANNELS>
+void PixelEngine<CHANNELS>::rotate(const uint8_t * source, uint8_t * destination, int width, int height,
+                                   double degree) {
+    std::fill(destination, destination + (std::size_t) width * height * CHANNELS, 0);
+
+    double xCenter = width / 2.0;
+    double yCenter = height / 2.0;
+    double cos = std::cos(degree * (PI / 180.0));
+    double sin = std::sin(degree * (PI / 180.0));
+
+    for (int row = 0; row < height; row++) {
+        for (int column = 0; column < width; column++) {
+            double xOffset = column - xCenter;
+            double yOffset = row - yCenter;
+            auto newPosX = (int) (xOffset * cos + yOffset * sin + xCenter);
+            auto newPosY = (int) (yOffset * cos - xOffset * sin + yCenter);
+
+            if ((newPosX >= 0) && (newPosX < width) && (newPosY >= 0) && (newPosY < height)) {
+                const uint8_t * pixel = source + getIndex(column, row, width);
+                copyPixel(pixel, destination + getIndex(newPosX, newPosY, width));
+            }
+        }
+    }
+}
+
+#endif //PIXELENGINE_H
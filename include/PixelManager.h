@@ -1,25 +1,80 @@
 #ifndef PIXELMANAGER_H
 #define PIXELMANAGER_H
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include "BufferPool.h"
+
 /**
  * PixelManager - gives the Image the possibility to easily operate on the 1D array.
+ * Positions are converted to indexes using std::ptrdiff_t, so images bigger than 2^31 bytes can be addressed.
+ * The array of pixels is reference counted and copied on write - copies of the manager share the array
+ * (so the copy of the image costs nothing) and the array is copied only when one of them needs to change it in place.
+ * Operations that create the new array (setPixels) don't copy anything, the other copies keep the old array.
+ * The array is released when the last manager using it sets a new one or is destroyed.
+ * Arrays are allocated with the BufferPool, so they can be reused by the next images processed by the same thread.
  * @tparam PIXEL_TYPE - type of the pixel that the image uses.
  */
 template<typename PIXEL_TYPE>
 class PixelManager {
+    static_assert(std::is_trivially_copyable<PIXEL_TYPE>::value, "Pixels are stored in the raw memory.");
+
 private:
     /**
-     * Array of pixels.
+     * Array shared by the copies of the manager, it's released with the last of them.
+     */
+    struct SharedPixels {
+        PIXEL_TYPE * array;
+
+        explicit SharedPixels(PIXEL_TYPE * array) : array(array) {}
+        ~SharedPixels() {
+            releasePixels(this->array);
+        }
+    };
+
+    std::shared_ptr<SharedPixels> shared;
+
+    /**
+     * Array of pixels - the same as in the shared object, kept here for the fast access.
+     */
+    PIXEL_TYPE * pixels = nullptr;
+
+    /**
+     * Makes sure that the array is not shared with any other manager - it's copied if it is.
      */
-    PIXEL_TYPE * pixels;
+    void detachPixels();
 
 public:
+    PixelManager() = default;
+
+    /**
+     * Creates the copy sharing the array of pixels with the other manager, it costs O(1).
+     * @param other - manager to copy
+     */
+    PixelManager(const PixelManager & other) : shared(other.shared), pixels(other.pixels) {}
+
+    PixelManager & operator=(const PixelManager &) = delete;
+
+    virtual ~PixelManager() = default;
+
     /**
-     * Sets PIXEL_TYPE array to the class member.
+     * Sets PIXEL_TYPE array to the class member - the previous array is released.
      * @param pixelToSet
      */
     void setPixels(PIXEL_TYPE * pixelToSet);
 
+    /**
+     * Detaches the array of pixels from the manager without releasing it - the caller becomes its owner.
+     * If the array is shared with the copies of the manager, the caller gets its own copy.
+     * @return PIXEL_TYPE * - pixels
+     */
+    PIXEL_TYPE * takePixels();
+
     /**
      * Returns the pixel at the given position
      * @param x - position in the x axis
@@ -27,7 +82,7 @@ public:
      * @param width - width of the whole image (in pixels)
      * @return PIXEL_TYPE - pixel
      */
-    PIXEL_TYPE & getPixelAt(int x, int y, int width) const;
+    const PIXEL_TYPE & getPixelAt(int x, int y, int width) const;
 
     /**
      * Returns the pixel value at the given position from the given array
@@ -44,7 +99,7 @@ public:
      * @param index - index where the pixel should be located
      * @return PIXEL_TYPE - pixel
      */
-    PIXEL_TYPE & getPixelByIndex(int index) const;
+    const PIXEL_TYPE & getPixelByIndex(std::size_t index) const;
 
     /**
      * Sets the pixel in the given array - it assumes that memory for it is in place.
@@ -55,31 +110,185 @@ public:
      * @param rgb - pixel to be inserted
      */
     void setPixelAt(int x, int y, int width, PIXEL_TYPE *array, PIXEL_TYPE pixel);
+
+    /**
+     * Returns the array of pixels for reading - it can be shared with the copies of the manager.
+     * @return PIXEL_TYPE * - pixels
+     */
+    const PIXEL_TYPE * getPixels() const;
+
+    /**
+     * Returns the array of pixels that can be changed in place - it's copied first if it's shared.
+     * @return PIXEL_TYPE * - pixels
+     */
+    PIXEL_TYPE * getMutablePixels();
+
+    /**
+     * Returns true if the array of pixels is shared with any copy of the manager.
+     */
+    bool arePixelsShared() const;
+
+    /**
+     * Allocates the array for the image of the given size - it needs to be passed to setPixels or releasePixels.
+     * The size is calculated in std::size_t and checked for the overflow before the allocation.
+     * @param width - width of the image (in pixels)
+     * @param height - height of the image (in pixels)
+     * @return PIXEL_TYPE * - new array, the caller is its owner
+     */
+    static PIXEL_TYPE * allocatePixels(int width, int height);
+
+    /**
+     * Releases the array allocated by allocatePixels.
+     * @param array - array to release
+     */
+    static void releasePixels(PIXEL_TYPE * array);
+
+    /**
+     * Returns the number of pixels in the image of the given size.
+     * @param width - width of the image (in pixels)
+     * @param height - height of the image (in pixels)
+     * @return std::size_t - number of pixels
+     */
+    static std::size_t countPixels(int width, int height);
+
+    /**
+     * Copies the rectangle from the source array to the destination array.
+     * Both arrays are row-major, rectangle position and size have to be valid in both of them.
+     * @param source - array from which the pixels will be copied
+     * @param sourceWidth - width of the source array (in pixels)
+     * @param sourceX - position of the rectangle in the x axis of the source array
+     * @param sourceY - position of the rectangle in the y axis of the source array
+     * @param destination - array to which the pixels will be copied
+     * @param destinationWidth - width of the destination array (in pixels)
+     * @param destinationX - position of the rectangle in the x axis of the destination array
+     * @param destinationY - position of the rectangle in the y axis of the destination array
+     * @param width - width of the rectangle (in pixels)
+     * @param height - height of the rectangle (in pixels)
+     */
+    static void copyRectangle(const PIXEL_TYPE * source, int sourceWidth, int sourceX, int sourceY,
+                              PIXEL_TYPE * destination, int destinationWidth, int destinationX, int destinationY,
+                              int width, int height);
+
+    /**
+     * Exception thrown if the image has no pixels or its size can't be represented in the memory.
+     */
+    struct AllocationSizeException : std::exception {
+        const char * what() const noexcept override {
+            return "The image dimensions are invalid or the image is too large to be stored in the memory.";
+        }
+    };
 };
 
 template<typename PIXEL_TYPE>
-PIXEL_TYPE &PixelManager<PIXEL_TYPE>::getPixelAt(int x, int y, int width) const {
-    return this->pixels[x + y * width];
+const PIXEL_TYPE & PixelManager<PIXEL_TYPE>::getPixelAt(int x, int y, int width) const {
+    return this->pixels[x + static_cast<std::ptrdiff_t>(y) * width];
 }
 
 template<typename PIXEL_TYPE>
 PIXEL_TYPE PixelManager<PIXEL_TYPE>::getPixelAt(int x, int y, int width, const PIXEL_TYPE * array) const {
-    return array[x + y * width];
+    return array[x + static_cast<std::ptrdiff_t>(y) * width];
 }
 
 template<typename PIXEL_TYPE>
-PIXEL_TYPE & PixelManager<PIXEL_TYPE>::getPixelByIndex(int index) const {
+const PIXEL_TYPE & PixelManager<PIXEL_TYPE>::getPixelByIndex(std::size_t index) const {
     return this->pixels[index];
 }
 
 template<typename PIXEL_TYPE>
 void PixelManager<PIXEL_TYPE>::setPixelAt(int x, int y, int width, PIXEL_TYPE *array, PIXEL_TYPE pixel) {
-    array[x + y * width] = pixel;
+    array[x + static_cast<std::ptrdiff_t>(y) * width] = pixel;
 }
 
 template<typename PIXEL_TYPE>
 void PixelManager<PIXEL_TYPE>::setPixels(PIXEL_TYPE * pixelToSet) {
+    if (this->pixels == pixelToSet) {
+        return;
+    }
+
+    this->shared = pixelToSet != nullptr ? std::make_shared<SharedPixels>(pixelToSet) : nullptr;
     this->pixels = pixelToSet;
 }
 
+template<typename PIXEL_TYPE>
+PIXEL_TYPE * PixelManager<PIXEL_TYPE>::takePixels() {
+    this->detachPixels();
+
+    PIXEL_TYPE * taken = this->pixels;
+    if (this->shared != nullptr) {
+        this->shared->array = nullptr;
+        this->shared.reset();
+    }
+    this->pixels = nullptr;
+    return taken;
+}
+
+template<typename PIXEL_TYPE>
+const PIXEL_TYPE * PixelManager<PIXEL_TYPE>::getPixels() const {
+    return this->pixels;
+}
+
+template<typename PIXEL_TYPE>
+PIXEL_TYPE * PixelManager<PIXEL_TYPE>::getMutablePixels() {
+    this->detachPixels();
+    return this->pixels;
+}
+
+template<typename PIXEL_TYPE>
+bool PixelManager<PIXEL_TYPE>::arePixelsShared() const {
+    return this->shared != nullptr && this->shared.use_count() > 1;
+}
+
+/**
+ * The size of the array is not stored in the manager, the size requested from the BufferPool is copied
+ * (not the whole reused block).
+ */
+template<typename PIXEL_TYPE>
+void PixelManager<PIXEL_TYPE>::detachPixels() {
+    if (!this->arePixelsShared()) {
+        return;
+    }
+
+    std::size_t bytes = BufferPool::getSize(this->pixels);
+    auto * copy = static_cast<PIXEL_TYPE *>(BufferPool::acquire(bytes));
+    std::memcpy(copy, this->pixels, bytes);
+
+    this->shared = std::make_shared<SharedPixels>(copy);
+    this->pixels = copy;
+}
+
+template<typename PIXEL_TYPE>
+std::size_t PixelManager<PIXEL_TYPE>::countPixels(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        throw AllocationSizeException();
+    }
+
+    auto count = static_cast<std::size_t>(width);
+    if (count > SIZE_MAX / sizeof(PIXEL_TYPE) / static_cast<std::size_t>(height)) {
+        throw AllocationSizeException();
+    }
+
+    return count * static_cast<std::size_t>(height);
+}
+
+template<typename PIXEL_TYPE>
+PIXEL_TYPE * PixelManager<PIXEL_TYPE>::allocatePixels(int width, int height) {
+    return static_cast<PIXEL_TYPE *>(BufferPool::acquire(countPixels(width, height) * sizeof(PIXEL_TYPE)));
+}
+
+template<typename PIXEL_TYPE>
+void PixelManager<PIXEL_TYPE>::releasePixels(PIXEL_TYPE * array) {
+    BufferPool::release(array);
+}
+
+template<typename PIXEL_TYPE>
+void PixelManager<PIXEL_TYPE>::copyRectangle(const PIXEL_TYPE * source, int sourceWidth, int sourceX, int sourceY,
+                                             PIXEL_TYPE * destination, int destinationWidth, int destinationX,
+                                             int destinationY, int width, int height) {
+    for (int row = 0; row < height; row++) {
+        const PIXEL_TYPE * sourceRow = source + sourceX + static_cast<std::ptrdiff_t>(sourceY + row) * sourceWidth;
+        std::copy(sourceRow, sourceRow + width,
+                  destination + destinationX + static_cast<std::ptrdiff_t>(destinationY + row) * destinationWidth);
+    }
+}
+
 #endif //PIXELMANAGER_H
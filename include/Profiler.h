@@ -0,0 +1,171 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PerfCounters.h"
+
+/**
+ * Measures the stages of the program (fe. reading, every operation, saving).
+ * For every stage it records the wall time, CPU time, number of threads and the memory allocated by it,
+ * optionally also the hardware performance counters.
+ * Results can be printed as the table or saved as the Chrome trace_event JSON (chrome://tracing, Perfetto).
+ */
+class Profiler {
+public:
+    /**
+     * Measurements of a single stage.
+     */
+    struct Stage {
+        std::string name;
+        /**
+         * Start of the stage counted from the creation of the profiler (in nanoseconds).
+         */
+        int64_t start;
+        int64_t duration;
+        /**
+         * User and system CPU time of the whole process spent during the stage (in nanoseconds).
+         */
+        int64_t cpuTime;
+        uint64_t allocatedBytes;
+        uint64_t allocations;
+        /**
+         * The highest number of threads of the process seen during the stage (sampled every millisecond).
+         */
+        int threads;
+        /**
+         * Number of pixels processed by the stage - 0 if it's unknown.
+         */
+        uint64_t pixels;
+        /**
+         * Hardware counters of the stage - all of them are unavailable if they weren't requested or if the stage
+         * ran more threads (only the calling thread is counted).
+         */
+        PerfCounters::Values counters;
+    };
+
+    /**
+     * Creates the profiler - if it's disabled, begin and end do nothing.
+     * @param enabled - true if the stages should be measured
+     * @param hardwareCounters - true if the hardware performance counters should be measured as well
+     */
+    explicit Profiler(bool enabled, bool hardwareCounters = false);
+
+    ~Profiler();
+
+    /**
+     * Starts the measurement of the new stage. Stages can't be nested.
+     * @param name - name of the stage
+     */
+    void begin(const std::string & name);
+
+    /**
+     * Ends the measurement of the current stage.
+     * @param name - final name of the stage, it replaces the one passed to begin if it's not empty
+     */
+    void end(const std::string & name = "");
+
+    /**
+     * Sets the number of pixels processed by the current stage - it's used to calculate the throughput (MP/s).
+     * @param pixels - number of pixels
+     */
+    void setPixels(uint64_t pixels);
+
+    /**
+     * Returns true if the profiler measures the stages.
+     */
+    bool isEnabled() const;
+
+    /**
+     * Returns all the finished stages.
+     */
+    const std::vector<Stage> & getStages() const;
+
+    /**
+     * Prints the summary table of all the stages.
+     * @param stream - stream to which the table will be written
+     */
+    void printSummary(std::ostream & stream) const;
+
+    /**
+     * Saves the stages as the Chrome trace_event JSON file.
+     * @param path - path to the file
+     */
+    void saveTrace(const std::string & path) const;
+
+    /**
+     * Counts the allocation - it's called by the global operator new of the program (imgm replaces it,
+     * the programs that don't replace it have no allocations counted).
+     * @param size - number of allocated bytes
+     */
+    static void countAllocation(std::size_t size);
+
+    /**
+     * Exception thrown when the trace couldn't be saved.
+     */
+    struct TraceSaveException : std::exception {
+        const char * what() const noexcept override {
+            return "The profiling trace couldn't be saved in the desired location.";
+        }
+    };
+
+private:
+    bool enabled;
+    bool running = false;
+    std::chrono::steady_clock::time_point created;
+    Stage current{};
+    std::vector<Stage> stages;
+    std::unique_ptr<PerfCounters> perfCounters;
+
+    /**
+     * Thread counting the threads of the process during the current stage.
+     */
+    std::thread sampler;
+    std::mutex samplerMutex;
+    std::condition_variable samplerStopped;
+    bool sampling = false;
+    std::atomic<int> sampledThreads{1};
+
+    /**
+     * True if the allocations should be counted - only one profiler can count them at a time.
+     */
+    static std::atomic<bool> countingAllocations;
+    static std::atomic<uint64_t> allocatedBytes;
+    static std::atomic<uint64_t> allocations;
+
+    /**
+     * Returns the nanoseconds since the creation of the profiler.
+     */
+    int64_t now() const;
+
+    /**
+     * Returns the CPU time (user and system) used by the process (in nanoseconds).
+     */
+    static int64_t getCpuTime();
+
+    /**
+     * Starts the sampling of the number of the threads.
+     */
+    void startSampling();
+
+    /**
+     * Stops the sampling.
+     * @return the highest number of the threads seen since startSampling
+     */
+    int stopSampling();
+
+    /**
+     * Returns the number of threads of the process or 1 if it can't be checked.
+     */
+    static int getThreadCount();
+};
+
+#endif //PROFILER_H
@@ -0,0 +1,176 @@
+#ifndef RASTERIMAGE_H
+#define RASTERIMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Image.h"
+#include "PixelManager.h"
+
+/**
+ * Image made of the 8-bit channels - it implements all the image operations once, for every format.
+ * The formats only read and write the pixels and describe how they are stored:
+ * the array has one or more planes (processed independently) and every plane has the interleaved channels,
+ * fe. PGM is one plane of one channel, interleaved BMP is one plane of three channels and planar BMP
+ * is three planes of one channel.
+ * The algorithms are in PixelEngine (specialized for the number of channels at the compile time)
+ * and in the vector kernels of Simd, the convolution filters are in Convolution.
+ */
+class RasterImage : public Image, public PixelManager<uint8_t> {
+public:
+    int getWidth() const override;
+    int getHeight() const override;
+    void processRegion(const Region & region, const std::function<void()> & operation) override;
+    void blur() override;
+    void toBinary(int threshold) override;
+    void toBinary(ThresholdMethod method) override;
+    void toBinary(AdaptiveThreshold::Method method, int radius, int percent) override;
+    Histogram getHistogram(int channel) const override;
+    void erode() override;
+    void dilate() override;
+    void erodeDisk(int radius) override;
+    void dilateDisk(int radius) override;
+    void morphology(Morphology::Operation operation) override;
+    std::vector<ConnectedComponents::Component> labelComponents(
+            ConnectedComponents::Connectivity connectivity) override;
+    void toNegative() override;
+    void equalize() override;
+    void stretchContrast(double percent) override;
+    void scale(int newWidth, int newHeight) override;
+    void scaleUp(int newWidth, int newHeight) override;
+    void scaleDown(int newWidth, int newHeight) override;
+    void edgeFilter() override;
+    void filter(Filter filter, const Convolution::Border & border) override;
+    void convolve(const Convolution::KernelMatrix & kernel, const Convolution::Border & border) override;
+    void denoise(int size) override;
+    void rotate(float degree) override;
+
+    /**
+     * Sets every colour channel to the gray value (r / 3 + g / 3 + b / 3), the single channel image is not changed.
+     */
+    void toGrayscale();
+
+protected:
+    /**
+     * Width of the image - in pixels
+     */
+    int width = 0;
+
+    /**
+     * Height of the image - in pixels
+     */
+    int height = 0;
+
+    /**
+     * Maximal value of the channel, used by the negative, binary image and edge filter.
+     */
+    uint8_t maxValue = 255;
+
+    /**
+     * Part of the image in the binary format - the whole image or the region of interest that was thresholded,
+     * its width is 0 if no part is binary. The binary operations need all their pixels inside it.
+     */
+    Region binaryRegion{0, 0, 0, 0};
+
+    /**
+     * Sets how the pixels are stored.
+     * @param channels - number of the colour channels, 1 or 3 (blue, green, red)
+     * @param planes - number of the planes, 1 or the number of the channels
+     * @param planeChannels - number of the interleaved values in one plane, it can contain the unused padding
+     * @param bottomUp - true if the first row of the array is the bottom row of the image
+     */
+    RasterImage(int channels, int planes, int planeChannels, bool bottomUp);
+
+    /**
+     * Copies the image information of the other image and shares its pixels.
+     * @param other - image to copy
+     */
+    RasterImage(const RasterImage & other);
+
+    /**
+     * Returns the number of bytes of one pixel in the memory (all the planes together).
+     */
+    std::size_t getBytesPerPixel() const;
+
+    /**
+     * Returns the number of the interleaved values in one plane - the distance between the neighbouring values
+     * of one channel in bytes.
+     */
+    int getPlaneChannels() const;
+
+    /**
+     * Returns the offset of the first value of the channel in the array of the image of the given size.
+     * @param channel - index of the colour channel (0 for blue, 1 for green, 2 for red)
+     * @param imageWidth - width of the image
+     * @param imageHeight - height of the image
+     */
+    std::size_t getChannelOffset(int channel, int imageWidth, int imageHeight) const;
+
+    /**
+     * Allocates the array for the image of the given size - it needs to be passed to setPixels or releasePixels.
+     */
+    uint8_t * allocateBytes(int imageWidth, int imageHeight) const;
+
+    /**
+     * Marks the whole image as binary or no part of it.
+     */
+    void setBinary(bool binary);
+
+private:
+    /**
+     * Radius of the square window of erode and dilate.
+     */
+    static const int ERODE_RADIUS = 3;
+    static const int DILATE_RADIUS = 2;
+
+    int channels;
+    int planes;
+    int planeChannels;
+    bool bottomUp;
+
+    /**
+     * Returns true if the whole image is inside the binary region.
+     */
+    bool isBinary() const;
+
+    /**
+     * Runs the operation on every plane of the image.
+     * @param destination - array of the result, it has the size of the image
+     * @param operation - operation getting the source plane and the destination plane
+     */
+    void forEachPlane(uint8_t * destination,
+                      const std::function<void(const uint8_t * source, uint8_t * destination)> & operation) const;
+
+    /**
+     * Creates the mask of the pixels that have the value in all the colour channels.
+     * @param value - value of the pixels
+     * @param first - index of the first pixel
+     * @param count - number of the pixels
+     * @param mask - 255 for the pixels with the value, 0 for the others
+     */
+    void matchValue(uint8_t value, std::size_t first, std::size_t count, uint8_t * mask) const;
+
+    /**
+     * Sets the pixels that have the given value in their window (erode and dilate of the binary image).
+     * @param value - value that is spread, it has to be in all the channels
+     * @param radius - radius of the window
+     * @param disk - true for the circular window (by the distance transform), false for the square one
+     */
+    void spreadPixels(uint8_t value, int radius, bool disk);
+
+    /**
+     * Changes the grayscale image to the binary one, the values above the threshold are set to the maximal value.
+     */
+    void applyThreshold(int threshold);
+
+    /**
+     * Returns the histogram of the gray values, the colour image is not changed.
+     */
+    Histogram getLuminanceHistogram() const;
+
+    /**
+     * Changes every value of every channel by the table (the padding stays zeroed, the tables map 0 to 0).
+     */
+    void applyTable(const std::array<uint8_t, Histogram::BINS> & table);
+};
+
+#endif //RASTERIMAGE_H
@@ -0,0 +1,156 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Pipeline.h"
+#include "Profiler.h"
+
+/**
+ * On-disk cache of the pipeline results, it's addressed by the content - the key is the hash of the input bytes
+ * and of the canonical form of the pipeline, so the same image processed again (fe. a retry or a duplicate upload)
+ * is not decoded at all, its outputs are copied from the cache. The output paths are not part of the key,
+ * they are expanded again for every job.
+ * Optionally also the images after the leading operations are stored (stages), so another pipeline starting
+ * with the same operations continues from the longest stored stage.
+ * Every entry is one file written to the temporary file and renamed, so the other processes never see it
+ * half written. The least recently used entries are removed when the cache is bigger than its limit.
+ */
+class ResultCache {
+public:
+    /**
+     * Default maximal size of all the entries.
+     */
+    static const std::size_t DEFAULT_SIZE_LIMIT = 256 * 1024 * 1024;
+
+    /**
+     * 128-bit hash of the data.
+     */
+    struct Digest {
+        uint64_t first;
+        uint64_t second;
+
+        /**
+         * Returns the 32 hexadecimal digits.
+         */
+        std::string toString() const;
+    };
+
+    /**
+     * Opens the cache, the directory is created if it doesn't exist.
+     * @param directory - directory with the entries
+     * @param sizeLimit - maximal size of all the entries in bytes
+     * @param storeStages - true if the images after the leading operations should be stored too
+     */
+    explicit ResultCache(std::string directory, std::size_t sizeLimit = DEFAULT_SIZE_LIMIT, bool storeStages = false);
+
+    /**
+     * Restores the outputs of the pipeline from the cache or executes it and stores them.
+     * Concatenated PGM images are processed as the frame stream.
+     * @param pipeline - pipeline to execute, it has to be cacheable
+     * @param data - encoded input image (BMP or PGM file content)
+     * @param inputPath - path of the input, used by the output templates
+     * @param threads - number of threads processing the PGM frames
+     * @param profiler - if passed, the lookup and every step is measured
+     * @return true if the outputs were restored from the cache
+     */
+    bool run(const Pipeline & pipeline, const std::vector<uint8_t> & data, const std::string & inputPath,
+             unsigned threads, Profiler * profiler = nullptr);
+
+    /**
+     * Returns true if the results of the pipeline can be cached - it has to write at least one file,
+     * nothing to the standard output and no statistics of the components.
+     */
+    static bool isCacheable(const Pipeline & pipeline);
+
+    /**
+     * Computes the 128-bit hash of the data - the 64-bit words are mixed in four independent lanes (like xxHash),
+     * so the big inputs are hashed at about the memory speed. It's not cryptographic, so the entries also store
+     * the digest and the size of the input and they are compared on the hit.
+     * @param data - data to hash
+     * @param size - number of bytes
+     * @param seed - hash of the previous data, so more parts can be hashed as one
+     * @return hash
+     */
+    static Digest hash(const uint8_t * data, std::size_t size, const Digest & seed = Digest{0, 0});
+
+    /**
+     * Returns the canonical form of the steps from the beginning to last - the flags with their parsed
+     * parameters (fe. "-dn 05" and "-dn 5" are the same), output paths are left out.
+     * @param pipeline - parsed pipeline
+     * @param last - index after the last step
+     */
+    static std::string canonicalize(const Pipeline & pipeline, std::size_t last);
+
+    /**
+     * Exception thrown when the cache directory can't be created.
+     */
+    struct CacheDirectoryException : std::exception {
+        const char * what() const noexcept override {
+            return "The cache directory couldn't be created.";
+        }
+    };
+
+private:
+    /**
+     * Value of size before the cache directory is scanned for the first time.
+     */
+    static const std::size_t UNKNOWN_SIZE = SIZE_MAX;
+
+    std::string directory;
+    std::size_t sizeLimit;
+    bool storeStages;
+    /**
+     * Size of all the entries seen by the last scan plus the entries stored since then (the entries stored
+     * by other processes are found by the next scan).
+     */
+    std::atomic<std::size_t> size;
+
+    /**
+     * Returns the number of the leading steps whose results can be stored as the stages - the operations
+     * before the first output, branch, region or binary image (the binary state is not kept in the file).
+     */
+    static std::size_t countStages(const Pipeline & pipeline);
+
+    /**
+     * Executes the pipeline on the single image, the leading operations continue from the stored stage
+     * and their results are stored if the stages are enabled.
+     * @return false if the input contains more frames and has to be processed as the stream
+     */
+    bool runImage(const Pipeline & pipeline, const std::vector<uint8_t> & data, const std::string & inputPath,
+                  const Digest & inputDigest, Profiler * profiler);
+
+    /**
+     * Returns the description stored in the entry - the size and the digest of the input and the canonical steps.
+     * The name of the entry is only the part of the key, so the entry is used only if its description matches.
+     */
+    static std::string describe(std::size_t inputSize, const Digest & inputDigest, const std::string & canonical);
+
+    std::string getEntryPath(uint64_t key, const char * extension) const;
+
+    /**
+     * Reads the entry and marks it as recently used.
+     * @param path - path of the entry
+     * @param description - description that has to match the stored one (the input size and the pipeline)
+     * @param blobs - stored data
+     * @return false if the entry doesn't exist, is damaged or belongs to another job
+     */
+    bool load(const std::string & path, const std::string & description, std::vector<std::vector<uint8_t>> & blobs);
+
+    /**
+     * Writes the entry atomically and removes the least recently used entries if the cache is too big - the directory
+     * is scanned by the first store and then only when the size is over the limit.
+     * Problems are ignored - the cache is only the optimization.
+     */
+    void store(const std::string & path, const std::string & description,
+               const std::vector<std::vector<uint8_t>> & blobs);
+
+    /**
+     * Removes the least recently used entries until the cache fits its limit, the size is updated.
+     */
+    void evict();
+};
+
+#endif //RESULTCACHE_H
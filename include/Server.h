@@ -0,0 +1,66 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+#include "JobProtocol.h"
+#include "ThreadPool.h"
+
+/**
+ * Long running imgm process accepting the jobs over the Unix domain socket.
+ * The workers and their pixel array pools (BufferPool) stay warm between the jobs, so a job costs only
+ * reading, processing and saving of the image instead of starting the whole program.
+ * Every connection is a single job, jobs are executed concurrently by the thread pool.
+ */
+class Server {
+public:
+    /**
+     * Maximal number of bytes of the pixel arrays kept for reuse by all the workers together.
+     */
+    static const std::size_t BUFFER_POOL_BYTES = 256 * 1024 * 1024;
+
+    /**
+     * Maximal number of seconds the worker waits for the client that stopped sending the request or receiving
+     * the response, the connection is then closed (so the idle clients can't block the workers).
+     */
+    static const int CONNECTION_TIMEOUT_SECONDS = 10;
+
+    /**
+     * Creates the socket.
+     * @param socketPath - path of the socket, the old file is replaced
+     * @param threads - number of worker threads, 0 means the number of hardware threads
+     */
+    Server(std::string socketPath, unsigned threads);
+
+    Server(const Server &) = delete;
+    Server & operator=(const Server &) = delete;
+
+    /**
+     * Closes and removes the socket.
+     */
+    ~Server();
+
+    /**
+     * Accepts the jobs until SIGINT or SIGTERM is received, then waits for the jobs in progress.
+     */
+    void run();
+
+    /**
+     * Executes the job - it never throws, problems are reported in the response.
+     * @param request - arguments of the job (-i <file|-> <flags>) and the inline image data
+     * @return response with the exit code and the times of reading and processing
+     */
+    static JobProtocol::Response execute(const JobProtocol::Request & request);
+
+private:
+    std::string socketPath;
+    int listening;
+    ThreadPool pool;
+
+    /**
+     * Reads the job from the connection, executes it and sends the response.
+     * @param connection - descriptor of the accepted connection, it's closed at the end
+     */
+    static void handle(int connection);
+};
+
+#endif //SERVER_H
@@ -0,0 +1,178 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+
+/**
+ * Kernels of the pixel operations working on the plain byte arrays (PGM pixels, or the bytes of the BMP pixels).
+ * Every kernel has the scalar, SSE4.1, AVX2 and AVX-512 (BW) implementation, the best one supported by
+ * the processor is chosen at the first use, so one binary runs optimally on every machine.
+ * All the implementations give exactly the same results, the level can be forced for testing and benchmarks.
+ * The instruction sets are enabled only for the kernel functions (target attributes), the rest of the program
+ * is compiled for the baseline processor.
+ */
+class Simd {
+public:
+    /**
+     * Instruction set used by the kernels.
+     */
+    enum Level {
+        SCALAR,
+        SSE41,
+        AVX2,
+        AVX512
+    };
+
+    /**
+     * Implementations of the kernels for one level - the row functions are used by the 2D operations below.
+     */
+    struct Kernels {
+        void (*invert)(const uint8_t * source, uint8_t * destination, std::size_t count, uint8_t maxValue);
+        void (*threshold)(const uint8_t * source, uint8_t * destination, std::size_t count, uint8_t limit,
+                          uint8_t low, uint8_t high);
+        void (*select)(const uint8_t * source, const uint8_t * mask, uint8_t * destination, std::size_t count,
+                       uint8_t value);
+        void (*convolveRow)(const uint8_t * above, const uint8_t * row, const uint8_t * below,
+                            uint8_t * destination, std::size_t count, std::size_t step, const int * weights,
+                            int divisor);
+        void (*extremeRow)(const uint8_t * source, uint8_t * destination, std::size_t count, int window,
+                           bool maximum);
+        void (*extremeRows)(const uint8_t * const * rows, int rowCount, uint8_t * destination, std::size_t count,
+                            bool maximum);
+        uint64_t (*sum)(const uint8_t * source, std::size_t count);
+        void (*bgrToGray)(const uint8_t * bgr, uint8_t * gray, std::size_t count);
+        void (*grayToBgr)(const uint8_t * gray, uint8_t * bgr, std::size_t count);
+        void (*matchBgr)(const uint8_t * bgr, uint8_t * mask, std::size_t count, uint8_t value);
+        void (*lookup)(const uint8_t * source, uint8_t * destination, std::size_t count, const uint8_t * table);
+    };
+
+    /**
+     * Returns the best level supported by the processor (and the operating system).
+     */
+    static Level detectLevel();
+
+    /**
+     * Returns the level used by the kernels.
+     */
+    static Level getLevel();
+
+    /**
+     * Forces the level of the kernels - it should be called before the threads are started.
+     * @param level - level to use
+     * @return false if the processor doesn't support it (the level is not changed)
+     */
+    static bool setLevel(Level level);
+
+    /**
+     * Returns the level by its name (scalar, sse4.1, avx2, avx512).
+     * @param name - name of the level
+     */
+    static Level parseLevel(const std::string & name);
+
+    /**
+     * Returns the name of the level.
+     */
+    static const char * getLevelName(Level level);
+
+    /**
+     * Returns the implementations of the given level, fe. to compare them in the benchmarks.
+     * The level has to be supported by the processor.
+     */
+    static const Kernels & getKernels(Level level);
+
+    /**
+     * destination = maxValue - source (modulo 256).
+     */
+    static void invert(const uint8_t * source, uint8_t * destination, std::size_t count, uint8_t maxValue);
+
+    /**
+     * destination = source <= limit ? low : high, the limit outside of the byte range gives only low or high.
+     */
+    static void threshold(const uint8_t * source, uint8_t * destination, std::size_t count, int limit,
+                          uint8_t low, uint8_t high);
+
+    /**
+     * destination = mask != 0 ? value : source.
+     */
+    static void select(const uint8_t * source, const uint8_t * mask, uint8_t * destination, std::size_t count,
+                       uint8_t value);
+
+    /**
+     * Convolution with the 3x3 kernel, the pixels have the given number of interleaved channels (1 for PGM, 3 for BMP).
+     * The result is the weighted sum divided by the divisor (truncated) and clamped to 0-255.
+     * The border pixels are copied.
+     * @param weights - 9 weights, row by row from the top left neighbour, the sum of their absolute values
+     *                  has to be at most 65535
+     * @param divisor - positive divisor of the sum
+     */
+    static void convolve3x3(const uint8_t * source, uint8_t * destination, int width, int height, int channels,
+                            const int * weights, int divisor);
+
+    /**
+     * Minimum or maximum of the square window (2 * radius + 1) around every pixel of the single channel image,
+     * the window is cut at the borders.
+     */
+    static void minFilter(const uint8_t * source, uint8_t * destination, int width, int height, int radius);
+    static void maxFilter(const uint8_t * source, uint8_t * destination, int width, int height, int radius);
+
+    /**
+     * Maximum of the square window of the rows firstRow - lastRow (exclusive) only, so the bands of the image
+     * can be filtered one by one. Only the rows up to the radius around them are read.
+     * @param height - number of the rows of the source
+     * @param destination - lastRow - firstRow rows
+     */
+    static void maxFilter(const uint8_t * source, uint8_t * destination, int width, int height, int radius,
+                          int firstRow, int lastRow);
+
+    /**
+     * Sum of all the bytes.
+     */
+    static uint64_t sum(const uint8_t * source, std::size_t count);
+
+    /**
+     * Converts the BGR pixels to gray (r / 3 + g / 3 + b / 3) and back (the same value in all the channels).
+     */
+    static void bgrToGray(const uint8_t * bgr, uint8_t * gray, std::size_t count);
+    static void grayToBgr(const uint8_t * gray, uint8_t * bgr, std::size_t count);
+
+    /**
+     * mask = 255 for the BGR pixels that have the value in all the channels, 0 for the others.
+     */
+    static void matchBgr(const uint8_t * bgr, uint8_t * mask, std::size_t count, uint8_t value);
+
+    /**
+     * destination = table[source], the table has 256 values.
+     */
+    static void lookup(const uint8_t * source, uint8_t * destination, std::size_t count, const uint8_t * table);
+
+    /**
+     * Exception thrown when the name of the level is not known.
+     */
+    struct UnknownLevelException : std::exception {
+        const char * what() const noexcept override {
+            return "Unknown SIMD level, expected: scalar, sse4.1, avx2 or avx512.";
+        }
+    };
+
+private:
+    static const Kernels scalarKernels;
+#if defined(__x86_64__) || defined(__i386__)
+    static const Kernels sse41Kernels;
+    static const Kernels avx2Kernels;
+    static const Kernels avx512Kernels;
+#endif
+
+    static const Kernels & get();
+
+    /**
+     * Separable minimum or maximum filter - the rows are filtered with the edges repeated, then the columns.
+     * The destination has the rows firstRow - lastRow (exclusive).
+     */
+    static void extremeFilter(const uint8_t * source, uint8_t * destination, int width, int height, int radius,
+                              bool maximum, int firstRow, int lastRow);
+};
+
+#endif //SIMD_H
@@ -0,0 +1,128 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Pool of the worker threads with the work stealing.
+ * Every worker has its own queue - it takes the newest task from it (the data is still in the cache)
+ * and when it's empty, it steals the oldest task from the other workers. Tasks submitted by the worker
+ * go to its own queue, tasks submitted from the outside are spread between all the queues.
+ */
+class ThreadPool {
+public:
+    /**
+     * Starts the workers.
+     * @param threads - number of workers, 0 means the number of hardware threads
+     */
+    explicit ThreadPool(unsigned threads = 0);
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    /**
+     * Waits for all the tasks and stops the workers.
+     */
+    ~ThreadPool();
+
+    /**
+     * Adds the task to the pool. Exceptions thrown by the task are ignored - the task should handle them itself.
+     * @param task - task to execute
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * Waits until all the submitted tasks are finished.
+     */
+    void wait();
+
+    /**
+     * Returns the number of workers.
+     */
+    unsigned getSize() const;
+
+    /**
+     * Returns the index of the worker executing the current thread or -1 if it's not the worker.
+     */
+    static int getWorkerIndex();
+
+    /**
+     * Returns the number of the parts the operation on the items should be split to - 1 for the small work and
+     * in the workers of the pools (they already process the images in parallel), at most the number of hardware
+     * threads otherwise.
+     * @param items - number of the items (rows, columns, bands) that can be processed separately
+     * @param work - number of the processed pixels (values) of all the items
+     */
+    static std::size_t countParts(std::size_t items, std::size_t work);
+
+    /**
+     * Processes the parts 0 - parts - 1 in parallel - the calling thread processes the first part and the others
+     * are processed by the shared pool, so all the threads of the process share its workers. Waits for all
+     * the parts and rethrows the first exception thrown by them.
+     * @param operation - processes the part with the index
+     */
+    static void runParts(std::size_t parts, const std::function<void(std::size_t)> & operation);
+
+    /**
+     * Splits first - last (exclusive) to countParts(last - first, work) parts of the same size and processes
+     * them by runParts.
+     * @param operation - processes the part (first, last)
+     */
+    static void parallelFor(std::size_t first, std::size_t last, std::size_t work,
+                            const std::function<void(std::size_t, std::size_t)> & operation);
+
+private:
+    /**
+     * Queue of the single worker.
+     */
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex stateMutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allFinished;
+    /**
+     * Number of tasks waiting in the queues.
+     */
+    long queued = 0;
+    /**
+     * Number of submitted tasks that are not finished yet.
+     */
+    long pending = 0;
+    bool stopping = false;
+
+    std::atomic<unsigned> nextQueue;
+
+    /**
+     * Returns the pool of the parts processed by runParts (it's started by the first call).
+     */
+    static ThreadPool & getShared();
+
+    /**
+     * Main loop of the worker.
+     * @param index - index of the worker
+     */
+    void work(unsigned index);
+
+    /**
+     * Takes the task from the worker's own queue or steals it from the others.
+     * @param index - index of the worker
+     * @param task - found task
+     * @return true if the task was found
+     */
+    bool findTask(unsigned index, std::function<void()> & task);
+};
+
+#endif //THREADPOOL_H
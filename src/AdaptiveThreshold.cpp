@@ -0,0 +1,151 @@
+#include "AdaptiveThreshold.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Smallest size of the tile - the table of the tile has the radius of the rows and the columns more on every side,
+ * so the tiles are at least as big as the window to sum every value at most nine times. The table of the smallest
+ * tile with the squares fits to the L2 cache.
+ */
+static const int TILE_ROWS = 128;
+static const int TILE_COLUMNS = 256;
+
+int AdaptiveThreshold::getDefaultPercent(Method method) {
+    return method == SAUVOLA ? 50 : 15;
+}
+
+void AdaptiveThreshold::apply(const uint8_t * values, std::size_t step, uint8_t * mask, int width, int height,
+                              Method method, int radius, int percent, uint8_t maxValue) {
+    if (radius < 1 || percent < 0 || percent > 100) {
+        throw InvalidParameterException();
+    }
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    // the bigger windows are clamped to the image anyway
+    radius = std::min(radius, std::max(width, height));
+    int tileRows = std::max(TILE_ROWS, 2 * radius);
+    int tileColumns = std::max(TILE_COLUMNS, 2 * radius);
+    int bands = (height + tileRows - 1) / tileRows;
+    std::size_t pixels = (std::size_t) width * height;
+    ThreadPool::parallelFor(0, bands, pixels, [=](std::size_t first, std::size_t last) {
+        IntegralImage integral;
+        for (std::size_t band = first; band < last; band++) {
+            int firstRow = (int) band * tileRows;
+            for (int firstColumn = 0; firstColumn < width; firstColumn += tileColumns) {
+                applyTile(integral, values, step, mask, width, height, firstRow, std::min(firstRow + tileRows, height),
+                          firstColumn, std::min(firstColumn + tileColumns, width), method, radius, percent, maxValue);
+            }
+        }
+    });
+}
+
+/**
+ * The sums of the window rows are extended to the radius around the tile with the sums at the borders of the image,
+ * so the sum of every window is the difference of two values and the loop over the pixels has no branches.
+ */
+void AdaptiveThreshold::applyTile(IntegralImage & integral, const uint8_t * values, std::size_t step,
+                                  uint8_t * mask, int width, int height, int firstRow, int lastRow, int firstColumn,
+                                  int lastColumn, Method method, int radius, int percent, uint8_t maxValue) {
+    bool squares = method == SAUVOLA;
+    int tableFirstColumn = std::max(firstColumn - radius, 0);
+    int tableLastColumn = std::min(lastColumn - 1 + radius, width - 1);
+    integral.build(values, step, width, std::max(firstRow - radius, 0), std::min(lastRow - 1 + radius, height - 1),
+                   tableFirstColumn, tableLastColumn, squares);
+
+    // [i] is the sum of the columns before the column firstColumn - radius + i, the sums before the image are zero
+    int tileColumns = lastColumn - firstColumn;
+    std::size_t extendedSize = (std::size_t) tileColumns + 2 * radius + 1;
+    std::size_t tableStart = tableFirstColumn - (firstColumn - radius);
+    std::size_t tableEnd = tableStart + (tableLastColumn - tableFirstColumn + 1);
+    std::vector<uint64_t> sums(extendedSize, 0);
+    std::vector<uint64_t> squareSums(squares ? extendedSize : 0, 0);
+    std::vector<uint32_t> columns((std::size_t) tileColumns);
+    for (int x = 0; x < tileColumns; x++) {
+        int column = firstColumn + x;
+        columns[x] = std::min(column + radius, width - 1) - std::max(column - radius, 0) + 1;
+    }
+
+    double k = percent / 100.0;
+    double range = (maxValue + 1) / 2.0;
+    for (int y = firstRow; y < lastRow; y++) {
+        int top = std::max(y - radius, 0);
+        int bottom = std::min(y + radius, height - 1);
+        auto rows = (uint64_t) (bottom - top + 1);
+        integral.sumRows(top, bottom, sums.data() + tableStart, squares ? squareSums.data() + tableStart : nullptr);
+        std::fill(sums.begin() + tableEnd + 1, sums.end(), sums[tableEnd]);
+        if (squares) {
+            std::fill(squareSums.begin() + tableEnd + 1, squareSums.end(), squareSums[tableEnd]);
+        }
+
+        const uint8_t * row = values + ((std::size_t) y * width + firstColumn) * step;
+        uint8_t * maskRow = mask + (std::size_t) y * width + firstColumn;
+        const uint64_t * windowEnds = sums.data() + 2 * radius + 1;
+        if (method == SAUVOLA) {
+            const uint64_t * squareEnds = squareSums.data() + 2 * radius + 1;
+            for (int x = 0; x < tileColumns; x++) {
+                double count = (double) (columns[x] * rows);
+                double mean = (double) (windowEnds[x] - sums[x]) / count;
+                double variance = (double) (squareEnds[x] - squareSums[x]) / count - mean * mean;
+                double deviation = std::sqrt(std::max(variance, 0.0));
+                maskRow[x] = row[x * step] <= mean * (1 + k * (deviation / range - 1)) ? 0 : maxValue;
+            }
+        } else {
+            // value <= mean * (100 - percent) / 100 without the division
+            auto scale = (uint64_t) (100 - percent);
+            for (int x = 0; x < tileColumns; x++) {
+                uint64_t count = columns[x] * rows;
+                maskRow[x] = row[x * step] * count * 100 <= (windowEnds[x] - sums[x]) * scale ? 0 : maxValue;
+            }
+        }
+    }
+}
+
+void AdaptiveThreshold::IntegralImage::build(const uint8_t * values, std::size_t step, int width, int firstRow,
+                                             int lastRow, int firstColumn, int lastColumn, bool squares) {
+    std::size_t rows = lastRow - firstRow + 1;
+    std::size_t columns = lastColumn - firstColumn + 1;
+    this->firstRow = firstRow;
+    this->rowSize = columns + 1;
+
+    // the first row and the first column are zero, so the rectangles at the border don't need any check
+    this->sums.assign((rows + 1) * this->rowSize, 0);
+    this->squareSums.assign(squares ? (rows + 1) * this->rowSize : 0, 0);
+
+    for (std::size_t y = 0; y < rows; y++) {
+        const uint8_t * row = values + ((firstRow + y) * width + firstColumn) * step;
+        const uint64_t * above = this->sums.data() + y * this->rowSize;
+        uint64_t * sumRow = this->sums.data() + (y + 1) * this->rowSize;
+        uint64_t rowSum = 0;
+        for (std::size_t x = 0; x < columns; x++) {
+            rowSum += row[x * step];
+            sumRow[x + 1] = above[x + 1] + rowSum;
+        }
+
+        if (squares) {
+            const uint64_t * squaresAbove = this->squareSums.data() + y * this->rowSize;
+            uint64_t * squareRow = this->squareSums.data() + (y + 1) * this->rowSize;
+            uint64_t rowSquareSum = 0;
+            for (std::size_t x = 0; x < columns; x++) {
+                rowSquareSum += (uint64_t) row[x * step] * row[x * step];
+                squareRow[x + 1] = squaresAbove[x + 1] + rowSquareSum;
+            }
+        }
+    }
+}
+
+void AdaptiveThreshold::IntegralImage::sumRows(int top, int bottom, uint64_t * sums, uint64_t * squareSums) const {
+    std::size_t topOffset = (top - this->firstRow) * this->rowSize;
+    std::size_t bottomOffset = (bottom + 1 - this->firstRow) * this->rowSize;
+    for (std::size_t x = 0; x < this->rowSize; x++) {
+        sums[x] = this->sums[bottomOffset + x] - this->sums[topOffset + x];
+    }
+    if (squareSums != nullptr) {
+        for (std::size_t x = 0; x < this->rowSize; x++) {
+            squareSums[x] = this->squareSums[bottomOffset + x] - this->squareSums[topOffset + x];
+        }
+    }
+}
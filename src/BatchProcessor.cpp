@@ -0,0 +1,207 @@
+#include "BatchProcessor.h"
+#include "BoundedQueue.h"
+#include "BufferPool.h"
+#include "ImageFactory.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/**
+ * Returns the number of seconds since the start.
+ */
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+BatchProcessor::BatchProcessor(const Pipeline & pipeline, unsigned threads, std::size_t readDepth,
+                               std::size_t writeDepth)
+        : pipeline(pipeline), threads(threads), readDepth(readDepth), writeDepth(writeDepth) {
+    if (!pipeline.hasUniqueOutputs()) {
+        throw OutputTemplateException();
+    }
+}
+
+std::vector<std::string> BatchProcessor::listInputs(const std::string & directoryOrList) {
+    std::vector<std::string> inputs;
+
+    struct stat info{};
+    if (stat(directoryOrList.c_str(), &info) != 0) {
+        throw InputListException();
+    }
+
+    if (S_ISDIR(info.st_mode)) {
+        DIR * directory = opendir(directoryOrList.c_str());
+        if (directory == nullptr) {
+            throw InputListException();
+        }
+
+        while (dirent * entry = readdir(directory)) {
+            std::string name = entry->d_name;
+            if (ImageFactory::detectFormat(name) != ImageFactory::UNKNOWN) {
+                inputs.push_back(directoryOrList + "/" + name);
+            }
+        }
+        closedir(directory);
+
+        std::sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    if (ImageFactory::detectFormat(directoryOrList) != ImageFactory::UNKNOWN) {
+        inputs.push_back(directoryOrList);
+        return inputs;
+    }
+
+    std::ifstream list(directoryOrList);
+    std::string line;
+    while (std::getline(list, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty() && line[0] != '#') {
+            inputs.push_back(line);
+        }
+    }
+
+    return inputs;
+}
+
+/**
+ * Every worker of the pool takes the decoded images as long as the reader provides them.
+ * Queues are closed by the last producer, so the consumers finish when everything was passed through.
+ */
+std::vector<BatchProcessor::FileResult> BatchProcessor::process(const std::vector<std::string> & inputs) const {
+    std::vector<FileResult> results(inputs.size());
+    for (std::size_t i = 0; i < inputs.size(); i++) {
+        results[i] = FileResult{inputs[i], false, "", 0, 0, 0};
+    }
+
+    BoundedQueue<Job> decoded(readDepth);
+    BoundedQueue<Job> computed(writeDepth);
+
+    std::thread reader([this, &results, &decoded] {
+        for (std::size_t i = 0; i < results.size(); i++) {
+            std::unique_ptr<Image> image = readFile(results[i]);
+            if (image != nullptr) {
+                decoded.push(Job{i, std::move(image)});
+            }
+        }
+        decoded.close();
+    });
+
+    std::thread writer([this, &results, &computed] {
+        Job job;
+        while (computed.pop(job)) {
+            writeFile(std::move(job.image), (int) job.index, results[job.index]);
+        }
+    });
+
+    {
+        ThreadPool pool(threads);
+        for (unsigned worker = 0; worker < pool.getSize(); worker++) {
+            pool.submit([this, &results, &decoded, &computed] {
+                BufferPool::enable(BUFFER_POOL_BYTES);
+
+                Job job;
+                while (decoded.pop(job)) {
+                    if (computeFile(*job.image, (int) job.index, results[job.index])) {
+                        computed.push(std::move(job));
+                    } else {
+                        job.image.reset();
+                    }
+                }
+
+                BufferPool::disable();
+            });
+        }
+        pool.wait();
+    }
+
+    reader.join();
+    computed.close();
+    writer.join();
+
+    return results;
+}
+
+std::unique_ptr<Image> BatchProcessor::readFile(FileResult & result) const {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<Image> image;
+
+    try {
+        std::fstream file(result.path, std::ios::in | std::ios::binary);
+        image.reset(ImageFactory::create(ImageFactory::detectFormat(result.path), file));
+        image->read();
+    } catch (std::exception &exception) {
+        result.message = exception.what();
+        image.reset();
+    }
+
+    result.readSeconds = secondsSince(start);
+    return image;
+}
+
+bool BatchProcessor::computeFile(Image & image, int index, FileResult & result) const {
+    auto start = std::chrono::steady_clock::now();
+    bool success = false;
+
+    try {
+        pipeline.run(image, result.path, index, 0, pipeline.getOutputStart());
+        success = true;
+    } catch (Pipeline::StepException &exception) {
+        result.message = exception.step + ": " + exception.description;
+    } catch (std::exception &exception) {
+        result.message = exception.what();
+    }
+
+    result.computeSeconds = secondsSince(start);
+    return success;
+}
+
+void BatchProcessor::writeFile(std::unique_ptr<Image> image, int index, FileResult & result) const {
+    auto start = std::chrono::steady_clock::now();
+
+    try {
+        pipeline.run(*image, result.path, index, pipeline.getOutputStart(), pipeline.getSteps().size());
+        result.success = true;
+    } catch (Pipeline::StepException &exception) {
+        result.message = exception.step + ": " + exception.description;
+    } catch (std::exception &exception) {
+        result.message = exception.what();
+    }
+    image.reset();
+
+    result.writeSeconds = secondsSince(start);
+}
+
+void BatchProcessor::printReport(const std::vector<FileResult> & results, double seconds, std::ostream & stream) {
+    std::size_t failed = 0;
+    double readSeconds = 0, computeSeconds = 0, writeSeconds = 0;
+    for (const FileResult & result : results) {
+        readSeconds += result.readSeconds;
+        computeSeconds += result.computeSeconds;
+        writeSeconds += result.writeSeconds;
+        if (!result.success) {
+            stream << "FAILED " << result.path << " - " << result.message << std::endl;
+            failed++;
+        }
+    }
+
+    stream << "Processed " << results.size() - failed << " of " << results.size() << " files";
+    if (failed > 0) {
+        stream << " (" << failed << " failed)";
+    }
+    stream << " in " << std::fixed << std::setprecision(3) << seconds << " s";
+    if (seconds > 0) {
+        stream << ", " << std::setprecision(1) << results.size() / seconds << " files/s";
+    }
+    stream << std::endl;
+    stream << "Busy time of the stages: read " << std::setprecision(3) << readSeconds << " s, compute "
+           << computeSeconds << " s (all workers), write " << writeSeconds << " s" << std::endl;
+}
@@ -0,0 +1,123 @@
+#include "BufferPool.h"
+#include "Profiler.h"
+
+#include <cstdlib>
+#include <new>
+
+std::atomic<std::size_t> BufferPool::totalKeptBytes(0);
+
+BufferPool::Pool::~Pool() {
+    for (void * buffer : buffers) {
+        freeBuffer(buffer);
+    }
+    totalKeptBytes -= keptBytes;
+}
+
+BufferPool::Pool & BufferPool::getPool() {
+    static thread_local Pool pool;
+    return pool;
+}
+
+/**
+ * The capacity and the requested size are stored in the ALIGNMENT bytes long header, so the array itself stays aligned.
+ * Best fitting kept array is reused if it's not more than two times bigger than needed.
+ */
+void * BufferPool::acquire(std::size_t bytes) {
+    Pool & pool = getPool();
+    if (pool.enabled) {
+        std::size_t bestIndex = pool.buffers.size();
+        for (std::size_t i = 0; i < pool.buffers.size(); i++) {
+            std::size_t capacity = getCapacity(pool.buffers[i]);
+            if (capacity >= bytes && capacity / 2 <= bytes &&
+                (bestIndex == pool.buffers.size() || capacity < getCapacity(pool.buffers[bestIndex]))) {
+                bestIndex = i;
+            }
+        }
+
+        if (bestIndex != pool.buffers.size()) {
+            void * buffer = pool.buffers[bestIndex];
+            pool.buffers.erase(pool.buffers.begin() + (std::ptrdiff_t) bestIndex);
+            pool.keptBytes -= getCapacity(buffer);
+            totalKeptBytes -= getCapacity(buffer);
+            pool.reused++;
+            static_cast<std::size_t *>(buffer)[-1] = bytes;
+            return buffer;
+        }
+    }
+
+    std::size_t capacity = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    if (capacity < bytes || capacity + ALIGNMENT < capacity) {
+        throw std::bad_alloc();
+    }
+
+    void * block = nullptr;
+    if (posix_memalign(&block, ALIGNMENT, capacity + ALIGNMENT) != 0) {
+        throw std::bad_alloc();
+    }
+
+    Profiler::countAllocation(capacity + ALIGNMENT);
+    void * buffer = static_cast<char *>(block) + ALIGNMENT;
+    *static_cast<std::size_t *>(block) = capacity;
+    static_cast<std::size_t *>(buffer)[-1] = bytes;
+    return buffer;
+}
+
+void BufferPool::release(void * buffer) {
+    if (buffer == nullptr) {
+        return;
+    }
+
+    Pool & pool = getPool();
+    std::size_t capacity = getCapacity(buffer);
+    if (pool.enabled && reserve(capacity, pool.maxBytes)) {
+        pool.buffers.push_back(buffer);
+        pool.keptBytes += capacity;
+        return;
+    }
+
+    freeBuffer(buffer);
+}
+
+void BufferPool::enable(std::size_t maxBytes) {
+    Pool & pool = getPool();
+    pool.enabled = true;
+    pool.maxBytes = maxBytes;
+}
+
+void BufferPool::disable() {
+    Pool & pool = getPool();
+    for (void * buffer : pool.buffers) {
+        freeBuffer(buffer);
+    }
+    pool.buffers.clear();
+    totalKeptBytes -= pool.keptBytes;
+    pool.keptBytes = 0;
+    pool.enabled = false;
+}
+
+bool BufferPool::reserve(std::size_t bytes, std::size_t maxBytes) {
+    std::size_t kept = totalKeptBytes.load();
+    do {
+        if (bytes > maxBytes || kept > maxBytes - bytes) {
+            return false;
+        }
+    } while (!totalKeptBytes.compare_exchange_weak(kept, kept + bytes));
+
+    return true;
+}
+
+std::size_t BufferPool::getReusedCount() {
+    return getPool().reused;
+}
+
+std::size_t BufferPool::getCapacity(const void * buffer) {
+    return *reinterpret_cast<const std::size_t *>(static_cast<const char *>(buffer) - ALIGNMENT);
+}
+
+std::size_t BufferPool::getSize(const void * buffer) {
+    return static_cast<const std::size_t *>(buffer)[-1];
+}
+
+void BufferPool::freeBuffer(void * buffer) {
+    std::free(static_cast<char *>(buffer) - ALIGNMENT);
+}
@@ -0,0 +1,249 @@
+#include "ConnectedComponents.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <iomanip>
+
+std::vector<ConnectedComponents::Component> ConnectedComponents::label(const uint8_t * mask, uint32_t * labels,
+                                                                       int width, int height, std::ptrdiff_t rowStep,
+                                                                       Connectivity connectivity) {
+    if (width <= 0 || height <= 0) {
+        return {};
+    }
+
+    std::size_t threads = ThreadPool::countParts((std::size_t) height, (std::size_t) width * height);
+    std::vector<Strip> strips(threads);
+    for (std::size_t i = 0; i < threads; i++) {
+        strips[i].firstRow = (int) (height * i / threads);
+        strips[i].lastRow = (int) (height * (i + 1) / threads);
+    }
+
+    ThreadPool::runParts(threads, [=, &strips](std::size_t i) {
+        labelStrip(mask, labels, width, rowStep, connectivity, strips[i]);
+    });
+
+    // the provisional labels of all the strips are numbered one after another
+    uint32_t total = 0;
+    for (Strip & strip : strips) {
+        strip.offset = total;
+        total += (uint32_t) strip.parents.size() - 1;
+    }
+    std::vector<uint32_t> parents(total + 1, 0);
+    for (const Strip & strip : strips) {
+        for (std::size_t local = 1; local < strip.parents.size(); local++) {
+            parents[strip.offset + local] = strip.offset + strip.parents[local];
+        }
+    }
+
+    for (std::size_t i = 1; i < strips.size(); i++) {
+        int row = strips[i].firstRow;
+        const uint32_t * labelRow = labels + row * rowStep;
+        const uint32_t * labelsAbove = labelRow - rowStep;
+        uint32_t offset = strips[i].offset;
+        uint32_t offsetAbove = strips[i - 1].offset;
+        for (int x = 0; x < width; x++) {
+            if (labelRow[x] == 0) {
+                continue;
+            }
+            int first = connectivity == EIGHT ? std::max(x - 1, 0) : x;
+            int last = connectivity == EIGHT ? std::min(x + 1, width - 1) : x;
+            for (int neighbour = first; neighbour <= last; neighbour++) {
+                if (labelsAbove[neighbour] != 0) {
+                    join(parents, offset + labelRow[x], offsetAbove + labelsAbove[neighbour]);
+                }
+            }
+        }
+    }
+
+    // the roots are the smallest labels of the components, so they get the final labels in the order of the pixels
+    std::vector<uint32_t> finalLabels(total + 1, 0);
+    uint32_t count = 0;
+    for (uint32_t provisional = 1; provisional <= total; provisional++) {
+        uint32_t root = find(parents, provisional);
+        if (finalLabels[root] == 0) {
+            finalLabels[root] = ++count;
+        }
+        finalLabels[provisional] = finalLabels[root];
+    }
+
+    ThreadPool::runParts(threads, [=, &strips, &finalLabels](std::size_t i) {
+        const Strip & strip = strips[i];
+        const uint32_t * final = finalLabels.data() + strip.offset;
+        for (int y = strip.firstRow; y < strip.lastRow; y++) {
+            uint32_t * labelRow = labels + y * rowStep;
+            for (int x = 0; x < width; x++) {
+                labelRow[x] = labelRow[x] == 0 ? 0 : final[labelRow[x]];
+            }
+        }
+    });
+
+    std::vector<Component> components(count, Component{0, 0, INT_MAX, INT_MAX, -1, -1, 0, 0});
+    std::vector<uint64_t> sumsX(count, 0);
+    std::vector<uint64_t> sumsY(count, 0);
+    for (const Strip & strip : strips) {
+        for (std::size_t local = 1; local < strip.sums.size(); local++) {
+            uint32_t index = finalLabels[strip.offset + local] - 1;
+            const Sums & sums = strip.sums[local];
+            Component & component = components[index];
+            component.area += sums.area;
+            component.left = std::min(component.left, sums.left);
+            component.top = std::min(component.top, sums.top);
+            component.right = std::max(component.right, sums.right);
+            component.bottom = std::max(component.bottom, sums.bottom);
+            sumsX[index] += sums.sumX;
+            sumsY[index] += sums.sumY;
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        components[i].label = i + 1;
+        components[i].centroidX = (double) sumsX[i] / (double) components[i].area;
+        components[i].centroidY = (double) sumsY[i] / (double) components[i].area;
+    }
+
+    return components;
+}
+
+/**
+ * The pixel takes the label of the neighbour above it or on its left, the labels of its other neighbours are joined
+ * with it. For 8 neighbours the pixel above touches all the others (they were joined with it before), so only
+ * the pixel above right can bring the new label. The sums are counted for the runs of the pixels with one label.
+ */
+void ConnectedComponents::labelStrip(const uint8_t * mask, uint32_t * labels, int width, std::ptrdiff_t rowStep,
+                                     Connectivity connectivity, Strip & strip) {
+    strip.parents.assign(1, 0);
+    strip.sums.assign(1, Sums{});
+
+    for (int y = strip.firstRow; y < strip.lastRow; y++) {
+        const uint8_t * row = mask + y * rowStep;
+        uint32_t * labelRow = labels + y * rowStep;
+        const uint32_t * labelsAbove = y > strip.firstRow ? labelRow - rowStep : nullptr;
+
+        for (int x = 0; x < width; x++) {
+            if (row[x] == 0) {
+                labelRow[x] = 0;
+                continue;
+            }
+
+            uint32_t left = x > 0 ? labelRow[x - 1] : 0;
+            uint32_t up = labelsAbove != nullptr ? labelsAbove[x] : 0;
+            uint32_t label = up != 0 ? up : left;
+            if (labelsAbove != nullptr && connectivity == EIGHT && up == 0) {
+                uint32_t upLeft = x > 0 ? labelsAbove[x - 1] : 0;
+                uint32_t upRight = x + 1 < width ? labelsAbove[x + 1] : 0;
+                uint32_t other = left != 0 ? left : upLeft;
+                label = upRight != 0 ? upRight : other;
+                if (upRight != 0 && other != 0 && upRight != other) {
+                    join(strip.parents, upRight, other);
+                }
+            } else if (up != 0 && left != 0 && up != left) {
+                join(strip.parents, up, left);
+            }
+
+            if (label == 0) {
+                label = (uint32_t) strip.parents.size();
+                strip.parents.push_back(label);
+                strip.sums.push_back(Sums{0, 0, 0, x, y, x, y});
+            }
+            labelRow[x] = label;
+
+            // the run continues while its pixels would get the same label without joining anything
+            int end = x + 1;
+            while (end < width && row[end] != 0 && continuesRun(labelsAbove, width, end, label, connectivity)) {
+                labelRow[end++] = label;
+            }
+            Sums & sums = strip.sums[label];
+            auto run = (uint64_t) (end - x);
+            sums.area += run;
+            sums.sumX += run * (uint64_t) (x + end - 1) / 2;
+            sums.sumY += run * (uint64_t) y;
+            sums.left = std::min(sums.left, x);
+            sums.top = std::min(sums.top, y);
+            sums.right = std::max(sums.right, end - 1);
+            sums.bottom = std::max(sums.bottom, y);
+            x = end - 1;
+        }
+    }
+}
+
+bool ConnectedComponents::continuesRun(const uint32_t * labelsAbove, int width, int x, uint32_t label,
+                                       Connectivity connectivity) {
+    if (labelsAbove == nullptr) {
+        return true;
+    }
+    if (labelsAbove[x] != 0) {
+        return labelsAbove[x] == label;
+    }
+
+    return connectivity == FOUR || x + 1 >= width || labelsAbove[x + 1] == 0 || labelsAbove[x + 1] == label;
+}
+
+uint32_t ConnectedComponents::find(std::vector<uint32_t> & parents, uint32_t label) {
+    uint32_t root = label;
+    while (parents[root] != root) {
+        root = parents[root];
+    }
+    while (parents[label] != root) {
+        uint32_t parent = parents[label];
+        parents[label] = root;
+        label = parent;
+    }
+
+    return root;
+}
+
+uint32_t ConnectedComponents::join(std::vector<uint32_t> & parents, uint32_t first, uint32_t second) {
+    uint32_t firstRoot = find(parents, first);
+    uint32_t secondRoot = find(parents, second);
+    uint32_t root = std::min(firstRoot, secondRoot);
+    parents[firstRoot] = root;
+    parents[secondRoot] = root;
+
+    return root;
+}
+
+void ConnectedComponents::writeCsv(std::ostream & stream, const std::vector<Component> & components) {
+    stream << "label,area,left,top,width,height,centroid_x,centroid_y" << std::endl;
+    stream << std::fixed << std::setprecision(3);
+    for (const Component & component : components) {
+        stream << component.label << "," << component.area << "," << component.left << "," << component.top << ","
+               << component.right - component.left + 1 << "," << component.bottom - component.top + 1 << ","
+               << component.centroidX << "," << component.centroidY << std::endl;
+    }
+}
+
+void ConnectedComponents::writeJson(std::ostream & stream, const std::vector<Component> & components) {
+    stream << "{\"components\": [" << std::endl;
+    stream << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < components.size(); i++) {
+        const Component & component = components[i];
+        stream << "  {\"label\": " << component.label << ", \"area\": " << component.area
+               << ", \"left\": " << component.left << ", \"top\": " << component.top
+               << ", \"width\": " << component.right - component.left + 1
+               << ", \"height\": " << component.bottom - component.top + 1
+               << ", \"centroid_x\": " << component.centroidX << ", \"centroid_y\": " << component.centroidY << "}"
+               << (i + 1 < components.size() ? "," : "") << std::endl;
+    }
+    stream << "]}" << std::endl;
+}
+
+void ConnectedComponents::save(const std::vector<Component> & components, const std::string & path) {
+    std::ofstream file(path);
+    if (!file) {
+        throw StatisticsSaveException();
+    }
+
+    std::string extension = ".json";
+    bool json = path.size() >= extension.size() &&
+                path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+    if (json) {
+        writeJson(file, components);
+    } else {
+        writeCsv(file, components);
+    }
+
+    if (!file) {
+        throw StatisticsSaveException();
+    }
+}
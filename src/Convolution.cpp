@@ -0,0 +1,408 @@
+#include "Convolution.h"
+#include "Fft.h"
+
+#include <cstring>
+#include <sstream>
+
+/**
+ * Cost of one operation of the FFT (size * log2(size) per transform) relative to one tap of the direct
+ * convolution, measured by imgm_bench (kernel15x15, kernel31x31 and kernel63x63 with --convolution direct and fft).
+ * The FFT is faster from about 150 taps (fe. the full 13x13 kernel or the 15x15 disk).
+ */
+static const double FFT_COST = 8.5;
+
+/**
+ * The biggest FFT used for the tiles (unless the kernel needs more) - the spectrum of the tile fits in L2 cache,
+ * the bigger tiles have fewer overlaps, but their column transforms miss the cache.
+ */
+static const int MAX_FFT_SIZE = 256;
+
+Convolution::Method Convolution::method = Convolution::AUTO;
+
+Convolution::KernelMatrix::KernelMatrix(std::vector<int> weights, int divisor, int bias)
+        : divisor(divisor), bias(bias), weights(std::move(weights)) {
+    this->size = (int) std::lround(std::sqrt((double) this->weights.size()));
+    if (this->weights.empty() || this->size % 2 == 0 || (std::size_t) this->size * this->size != this->weights.size()) {
+        throw InvalidKernelException();
+    }
+
+    long weightSum = 0, absoluteSum = 0;
+    for (int weight : this->weights) {
+        weightSum += weight;
+        absoluteSum += std::abs((long) weight);
+        if (absoluteSum > MAX_WEIGHT_SUM) {
+            throw InvalidKernelException();
+        }
+    }
+    if (this->divisor == 0) {
+        this->divisor = weightSum > 0 ? (int) weightSum : 1;
+    }
+
+    for (int row = 0; row < this->size; row++) {
+        for (int column = 0; column < this->size; column++) {
+            if (int weight = this->getWeight(row, column)) {
+                this->taps.push_back({row, column, weight});
+            }
+        }
+    }
+
+    // the kernel is split through its first non zero weight like the kernels known at the compile time
+    if (this->taps.empty()) {
+        return;
+    }
+    const Tap & pivotTap = this->taps.front();
+    std::vector<Tap> rowTaps, columnTaps;
+    long rowSum = 0, columnSum = 0;
+    for (int i = 0; i < this->size; i++) {
+        if (int weight = this->getWeight(pivotTap.row, i)) {
+            rowTaps.push_back({0, i, weight});
+            rowSum += std::abs((long) weight);
+        }
+        if (int weight = this->getWeight(i, pivotTap.column)) {
+            columnTaps.push_back({i, 0, weight});
+            columnSum += std::abs((long) weight);
+        }
+        for (int j = 0; j < this->size; j++) {
+            if ((long) this->getWeight(i, j) * pivotTap.weight !=
+                (long) this->getWeight(i, pivotTap.column) * this->getWeight(pivotTap.row, j)) {
+                return;
+            }
+        }
+    }
+    if (rowTaps.size() + columnTaps.size() < this->taps.size() && rowSum * columnSum <= MAX_WEIGHT_SUM) {
+        this->rowTaps = std::move(rowTaps);
+        this->columnTaps = std::move(columnTaps);
+        this->pivot = pivotTap.weight;
+    }
+}
+
+Convolution::KernelMatrix Convolution::KernelMatrix::parse(const std::string & weights) {
+    std::vector<int> values;
+    std::stringstream stream(weights);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        char * end = nullptr;
+        long weight = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || std::abs(weight) > MAX_WEIGHT_SUM) {
+            throw InvalidKernelException();
+        }
+        values.push_back((int) weight);
+    }
+
+    return KernelMatrix(values);
+}
+
+int Convolution::KernelMatrix::getSize() const {
+    return this->size;
+}
+
+int Convolution::KernelMatrix::getDivisor() const {
+    return this->divisor;
+}
+
+int Convolution::KernelMatrix::getBias() const {
+    return this->bias;
+}
+
+int Convolution::KernelMatrix::getWeight(int row, int column) const {
+    return this->weights[row * this->size + column];
+}
+
+Convolution::KernelMatrix Convolution::KernelMatrix::flip() const {
+    std::vector<int> flipped;
+    for (int row = this->size - 1; row >= 0; row--) {
+        flipped.insert(flipped.end(), this->weights.begin() + row * this->size,
+                       this->weights.begin() + (row + 1) * this->size);
+    }
+
+    return KernelMatrix(flipped, this->divisor, this->bias);
+}
+
+bool Convolution::KernelMatrix::isSeparable() const {
+    return this->pivot != 0;
+}
+
+/**
+ * The taps are in the outer loop, so the inner loop over the row is the same for every tap.
+ */
+void Convolution::filter(const KernelMatrix & kernel, const uint8_t * source, uint8_t * destination, int width,
+                         int height, int channels, Border border, uint8_t maxValue) {
+    if (int fftSize = chooseFftSize(kernel, width, height)) {
+        filterFft(kernel, fftSize, source, destination, width, height, channels, border, maxValue);
+        return;
+    }
+
+    int radius = kernel.getSize() / 2;
+    int size = kernel.getSize();
+    Rows rows(source, width, height, channels, radius, border);
+    auto step = (std::size_t) channels;
+    std::size_t rowValues = (std::size_t) width * channels;
+
+    std::vector<int> sums(rowValues);
+    std::vector<int> rowSums(kernel.isSeparable() ? size * rowValues : 0);
+    std::vector<int> summedRows(size, INT_MIN);
+    for (int row = 0; row < height; row++) {
+        const uint8_t * const * window = rows.get(row);
+        std::fill(sums.begin(), sums.end(), 0);
+
+        if (kernel.isSeparable()) {
+            for (const auto & columnTap : kernel.columnTaps) {
+                int sourceRow = row - radius + columnTap.row;
+                int slot = rows.getSlot(sourceRow);
+                int * rowSum = rowSums.data() + slot * rowValues;
+                if (summedRows[slot] != sourceRow) {
+                    std::fill(rowSum, rowSum + rowValues, 0);
+                    for (const auto & rowTap : kernel.rowTaps) {
+                        const uint8_t * values = window[columnTap.row] + rowTap.column * step;
+                        for (std::size_t i = 0; i < rowValues; i++) {
+                            rowSum[i] += rowTap.weight * values[i];
+                        }
+                    }
+                    summedRows[slot] = sourceRow;
+                }
+                for (std::size_t i = 0; i < rowValues; i++) {
+                    sums[i] += columnTap.weight * rowSum[i];
+                }
+            }
+            for (std::size_t i = 0; i < rowValues; i++) {
+                sums[i] /= kernel.pivot;
+            }
+        } else {
+            for (const auto & tap : kernel.taps) {
+                const uint8_t * values = window[tap.row] + tap.column * step;
+                for (std::size_t i = 0; i < rowValues; i++) {
+                    sums[i] += tap.weight * values[i];
+                }
+            }
+        }
+
+        uint8_t * result = destination + row * rowValues;
+        int divisor = kernel.getDivisor(), bias = kernel.getBias();
+        for (std::size_t i = 0; i < rowValues; i++) {
+            result[i] = (uint8_t) std::min(std::max(sums[i] / divisor + bias, 0), (int) maxValue);
+        }
+    }
+}
+
+void Convolution::filterFft(const KernelMatrix & kernel, int fftSize, const uint8_t * source, uint8_t * destination,
+                            int width, int height, int channels, Border border, uint8_t maxValue) {
+    int size = kernel.getSize();
+    int radius = size / 2;
+    int tileSize = fftSize - size + 1;
+    int paddedWidth = width + 2 * radius;
+    int paddedHeight = height + 2 * radius;
+    // the result of the tile is bigger by size - 1, the band keeps the rows of the tiles below
+    int bandHeight = tileSize + size - 1;
+    int bandWidth = paddedWidth + size - 1;
+    std::size_t spectrumSize = (std::size_t) fftSize * (fftSize / 2 + 1);
+    Fft fft(fftSize);
+
+    // the kernel is flipped, so the convolution computes the same sum as the direct one
+    std::vector<double> tile((std::size_t) fftSize * fftSize);
+    for (int row = 0; row < size; row++) {
+        for (int column = 0; column < size; column++) {
+            tile[row * fftSize + column] = kernel.getWeight(size - 1 - row, size - 1 - column);
+        }
+    }
+    std::vector<Fft::Complex> kernelSpectrum(spectrumSize);
+    fft.forwardReal(tile.data(), size, kernelSpectrum.data());
+
+    Rows rows(source, width, height, channels, radius, border);
+    std::vector<uint8_t> paddedRow((std::size_t) paddedWidth * channels);
+    std::vector<double> values((std::size_t) tileSize * paddedWidth);
+    std::vector<double> band((std::size_t) bandHeight * bandWidth);
+    std::vector<Fft::Complex> spectrum(spectrumSize);
+    std::size_t rowValues = (std::size_t) width * channels;
+
+    for (int channel = 0; channel < channels; channel++) {
+        std::fill(band.begin(), band.end(), 0.0);
+        for (int bandRow = 0; bandRow < paddedHeight; bandRow += tileSize) {
+            int tileRows = std::min(tileSize, paddedHeight - bandRow);
+            for (int row = 0; row < tileRows; row++) {
+                rows.copyRow(bandRow + row - radius, paddedRow.data());
+                for (int x = 0; x < paddedWidth; x++) {
+                    values[row * paddedWidth + x] = paddedRow[x * channels + channel];
+                }
+            }
+
+            for (int tileColumn = 0; tileColumn < paddedWidth; tileColumn += tileSize) {
+                int tileColumns = std::min(tileSize, paddedWidth - tileColumn);
+                std::fill(tile.begin(), tile.end(), 0.0);
+                for (int row = 0; row < tileRows; row++) {
+                    std::copy(values.begin() + row * paddedWidth + tileColumn,
+                              values.begin() + row * paddedWidth + tileColumn + tileColumns,
+                              tile.begin() + row * fftSize);
+                }
+
+                fft.forwardReal(tile.data(), tileRows, spectrum.data());
+                for (std::size_t i = 0; i < spectrumSize; i++) {
+                    const Fft::Complex & a = spectrum[i];
+                    const Fft::Complex & b = kernelSpectrum[i];
+                    spectrum[i] = Fft::Complex(a.real() * b.real() - a.imag() * b.imag(),
+                                               a.real() * b.imag() + a.imag() * b.real());
+                }
+                fft.inverseReal(spectrum.data(), tileRows + size - 1, tile.data());
+
+                for (int row = 0; row < tileRows + size - 1; row++) {
+                    double * bandValues = band.data() + row * bandWidth + tileColumn;
+                    const double * tileValues = tile.data() + row * fftSize;
+                    for (int column = 0; column < tileColumns + size - 1; column++) {
+                        bandValues[column] += tileValues[column];
+                    }
+                }
+            }
+
+            // the rows of the band above the next tiles are complete, the pixel (x, y) is at (x + 2r, y + 2r)
+            int divisor = kernel.getDivisor(), bias = kernel.getBias();
+            for (int row = 0; row < tileRows; row++) {
+                int y = bandRow + row - 2 * radius;
+                if (y < 0 || y >= height) {
+                    continue;
+                }
+                const double * bandValues = band.data() + row * bandWidth + 2 * radius;
+                uint8_t * result = destination + y * rowValues + channel;
+                for (int x = 0; x < width; x++) {
+                    auto sum = (int) std::lround(bandValues[x]);
+                    result[x * channels] = (uint8_t) std::min(std::max(sum / divisor + bias, 0), (int) maxValue);
+                }
+            }
+            std::copy(band.begin() + tileRows * bandWidth, band.begin() + (tileRows + size - 1) * bandWidth,
+                      band.begin());
+            std::fill(band.begin() + (size - 1) * bandWidth, band.end(), 0.0);
+        }
+    }
+}
+
+void Convolution::setMethod(Method method) {
+    Convolution::method = method;
+}
+
+Convolution::Method Convolution::getMethod() {
+    return method;
+}
+
+Convolution::Method Convolution::parseMethod(const std::string & name) {
+    if (name == "auto") return AUTO;
+    if (name == "direct") return DIRECT;
+    if (name == "fft") return FFT;
+
+    throw UnknownMethodException();
+}
+
+/**
+ * One tile needs the forward transforms of its rows (two rows at once) and of the half of the columns,
+ * the same inverse transforms (of the rows of the bigger result) and the product of the spectra.
+ */
+int Convolution::chooseFftSize(const KernelMatrix & kernel, int width, int height) {
+    if (method == DIRECT) {
+        return 0;
+    }
+
+    int size = kernel.getSize();
+    int paddedWidth = width + 2 * (size / 2);
+    int paddedHeight = height + 2 * (size / 2);
+    int bestSize = 0;
+    double bestCost = 0;
+    for (int fftSize = size + 1; fftSize <= std::max(MAX_FFT_SIZE, 2 * size); fftSize++) {
+        if (!Fft::isSupported(fftSize)) {
+            continue;
+        }
+
+        int tileSize = fftSize - size + 1;
+        double tileColumns = std::min(tileSize, paddedWidth);
+        double tileRows = std::min(tileSize, paddedHeight);
+        double transforms = (tileRows + 1) / 2 + (tileRows + size) / 2 + 2 * (fftSize / 2 + 1);
+        double operations = transforms * fftSize * std::log2(fftSize) + (double) fftSize * (fftSize / 2 + 1);
+        double cost = FFT_COST * operations / (tileColumns * tileRows);
+        if (bestSize == 0 || cost < bestCost) {
+            bestSize = fftSize;
+            bestCost = cost;
+        }
+
+        // bigger tiles don't help once one tile covers the image
+        if (tileSize >= paddedWidth && tileSize >= paddedHeight) {
+            break;
+        }
+    }
+
+    std::size_t taps = kernel.isSeparable() ? kernel.rowTaps.size() + kernel.columnTaps.size() : kernel.taps.size();
+    return method == FFT || bestCost < (double) taps ? bestSize : 0;
+}
+
+Convolution::BorderType Convolution::parseBorderType(const std::string & name) {
+    if (name == "clamp") return CLAMP;
+    if (name == "reflect") return REFLECT;
+    if (name == "constant") return CONSTANT;
+
+    throw UnknownBorderException();
+}
+
+Convolution::Rows::Rows(const uint8_t * source, int width, int height, int channels, int radius, Border border)
+        : source(source), width(width), height(height), channels(channels), radius(radius), border(border),
+          ring((std::size_t) (2 * radius + 1) * (width + 2 * radius) * channels),
+          rowsInRing(2 * radius + 1, INT_MIN), window(2 * radius + 1) {}
+
+const uint8_t * const * Convolution::Rows::get(int row) {
+    std::size_t rowSize = (std::size_t) (this->width + 2 * this->radius) * this->channels;
+    for (int i = 0; i <= 2 * this->radius; i++) {
+        int windowRow = row - this->radius + i;
+        int slot = this->getSlot(windowRow);
+        uint8_t * ringRow = this->ring.data() + slot * rowSize;
+        if (this->rowsInRing[slot] != windowRow) {
+            this->copyRow(windowRow, ringRow);
+            this->rowsInRing[slot] = windowRow;
+        }
+        this->window[i] = ringRow;
+    }
+
+    return this->window.data();
+}
+
+int Convolution::Rows::getSlot(int row) const {
+    int size = 2 * this->radius + 1;
+    return ((row + this->radius) % size + size) % size;
+}
+
+int Convolution::Rows::mapRow(int row) const {
+    if (row >= 0 && row < this->height) {
+        return row;
+    }
+    return this->border.type == CONSTANT ? -1 : this->mapIndex(row, this->height);
+}
+
+int Convolution::Rows::mapIndex(int index, int count) const {
+    if (this->border.type == CLAMP || count == 1) {
+        return std::min(std::max(index, 0), count - 1);
+    }
+
+    // the kernel can be bigger than the image, so the reflection is repeated
+    while (index < 0 || index >= count) {
+        index = index < 0 ? -index : 2 * (count - 1) - index;
+    }
+    return index;
+}
+
+void Convolution::Rows::copyRow(int row, uint8_t * destination) const {
+    int sourceRow = this->mapRow(row);
+    std::size_t borderSize = (std::size_t) this->radius * this->channels;
+    std::size_t rowValues = (std::size_t) this->width * this->channels;
+    if (sourceRow < 0) {
+        std::fill(destination, destination + rowValues + 2 * borderSize, this->border.value);
+        return;
+    }
+
+    const uint8_t * values = this->source + sourceRow * rowValues;
+    std::memcpy(destination + borderSize, values, rowValues);
+    if (this->border.type == CONSTANT) {
+        std::fill(destination, destination + borderSize, this->border.value);
+        std::fill(destination + borderSize + rowValues, destination + rowValues + 2 * borderSize, this->border.value);
+        return;
+    }
+
+    for (int x = 1; x <= this->radius; x++) {
+        const uint8_t * left = values + this->mapIndex(-x, this->width) * this->channels;
+        const uint8_t * right = values + this->mapIndex(this->width - 1 + x, this->width) * this->channels;
+        std::memcpy(destination + borderSize - x * this->channels, left, this->channels);
+        std::memcpy(destination + borderSize + rowValues + (x - 1) * this->channels, right, this->channels);
+    }
+}
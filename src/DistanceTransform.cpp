@@ -0,0 +1,130 @@
+#include "DistanceTransform.h"
+#include "BufferPool.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <vector>
+
+constexpr uint32_t DistanceTransform::INFINITE;
+
+void DistanceTransform::compute(const uint8_t * mask, uint32_t * distances, int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    std::size_t pixels = (std::size_t) width * height;
+    ThreadPool::parallelFor(0, width, pixels, [=](std::size_t first, std::size_t last) {
+        transformColumns(mask, distances, width, height, (int) first, (int) last);
+    });
+    ThreadPool::parallelFor(0, height, pixels, [=](std::size_t first, std::size_t last) {
+        std::vector<int> vertices((std::size_t) width);
+        std::vector<double> bounds((std::size_t) width + 1);
+        std::vector<uint32_t> values((std::size_t) width);
+        for (std::size_t row = first; row < last; row++) {
+            transformRow(distances + row * width, width, vertices.data(), bounds.data(), values.data());
+        }
+    });
+}
+
+void DistanceTransform::spread(const uint8_t * mask, uint8_t * destination, int width, int height, int radius) {
+    if (radius < 0 || radius > MAX_RADIUS) {
+        throw InvalidRadiusException();
+    }
+
+    std::size_t pixels = (std::size_t) width * height;
+    BufferPool::TemporaryBuffer buffer(pixels * sizeof(uint32_t));
+    auto * distances = reinterpret_cast<uint32_t *>(buffer.get());
+    compute(mask, distances, width, height);
+
+    auto limit = (uint32_t) radius * (uint32_t) radius;
+    for (std::size_t i = 0; i < pixels; i++) {
+        destination[i] = distances[i] <= limit ? 255 : 0;
+    }
+}
+
+/**
+ * The rows are scanned down and up (the columns of one row are next to each other in the memory), the distances
+ * are counted in the rows and squared in the second scan. Height is the distance of the column without any set pixel.
+ */
+void DistanceTransform::transformColumns(const uint8_t * mask, uint32_t * distances, int width, int height,
+                                         int first, int last) {
+    auto far = (uint32_t) height;
+    auto columns = (std::size_t) (last - first);
+    const uint8_t * maskRow = mask + first;
+    uint32_t * row = distances + first;
+    for (std::size_t x = 0; x < columns; x++) {
+        row[x] = maskRow[x] != 0 ? 0 : far;
+    }
+    for (int y = 1; y < height; y++) {
+        const uint32_t * above = row;
+        maskRow += width;
+        row += width;
+        for (std::size_t x = 0; x < columns; x++) {
+            row[x] = maskRow[x] != 0 ? 0 : std::min(above[x] + 1, far);
+        }
+    }
+
+    // the row below is final when the row above it is done, so it's squared right away
+    auto square = [far, columns](uint32_t * values) {
+        for (std::size_t x = 0; x < columns; x++) {
+            values[x] = values[x] >= far ? INFINITE
+                                         : (uint32_t) std::min<uint64_t>((uint64_t) values[x] * values[x], INFINITE);
+        }
+    };
+    for (int y = height - 2; y >= 0; y--) {
+        uint32_t * below = row;
+        row -= width;
+        for (std::size_t x = 0; x < columns; x++) {
+            row[x] = std::min(row[x], below[x] + 1);
+        }
+        square(below);
+    }
+    square(row);
+}
+
+/**
+ * The parabola of the column q is (x - q)^2 + f(q), the columns without any set pixel (INFINITE) have no parabola.
+ * The envelope keeps the parabolas that are the lowest somewhere, bounds[k] is where the parabola k starts to be
+ * the lowest one. The set pixels inside the runs of the set pixels are skipped - they are the nearest ones only
+ * for themselves, their distance stays 0. The distances bigger than INFINITE are saturated.
+ */
+void DistanceTransform::transformRow(uint32_t * distances, int width, int * vertices, double * bounds,
+                                     uint32_t * values) {
+    int parabolas = 0;
+    for (int q = 0; q < width; q++) {
+        bool inside = distances[q] == 0 && q > 0 && q + 1 < width && distances[q - 1] == 0 && distances[q + 1] == 0;
+        if (distances[q] == INFINITE || inside) {
+            continue;
+        }
+
+        double value = (double) distances[q] + (double) q * q;
+        double bound = -1;
+        while (parabolas > 0) {
+            int vertex = vertices[parabolas - 1];
+            bound = (value - ((double) values[parabolas - 1] + (double) vertex * vertex)) / (2.0 * (q - vertex));
+            if (bound > bounds[parabolas - 1]) {
+                break;
+            }
+            parabolas--;
+            bound = -1;
+        }
+        vertices[parabolas] = q;
+        values[parabolas] = distances[q];
+        bounds[parabolas] = bound;
+        parabolas++;
+    }
+    if (parabolas == 0) {
+        return;
+    }
+    bounds[parabolas] = width;
+
+    int k = 0;
+    for (int x = 0; x < width; x++) {
+        while (bounds[k + 1] <= x) {
+            k++;
+        }
+        auto offset = (int64_t) (x - vertices[k]);
+        auto distance = (uint64_t) (offset * offset) + values[k];
+        distances[x] = distances[x] == 0 ? 0 : (uint32_t) std::min<uint64_t>(distance, INFINITE);
+    }
+}
@@ -0,0 +1,234 @@
+#include "Fft.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Product of the complex numbers without the checks of the infinities (the operator * calls the library for them).
+ */
+static inline Fft::Complex multiply(const Fft::Complex & a, const Fft::Complex & b) {
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+}
+
+Fft::Fft(int size) : size(size), buffer((std::size_t) size) {
+    const double pi = std::acos(-1.0);
+    for (int i = 0; i < size; i++) {
+        this->twiddles.push_back(std::polar(1.0, -2 * pi * i / size));
+        this->inverseTwiddles.push_back(std::conj(this->twiddles.back()));
+    }
+
+    // radix 4 first, it needs the fewest multiplications
+    int remaining = size;
+    for (int radix : {4, 2, 3, 5}) {
+        while (remaining > 1 && remaining % radix == 0) {
+            this->factors.push_back(radix);
+            remaining /= radix;
+        }
+    }
+}
+
+int Fft::getSize() const {
+    return this->size;
+}
+
+bool Fft::isSupported(int size) {
+    if (size < 2 || size % 2 != 0) {
+        return false;
+    }
+    for (int radix : {2, 3, 5}) {
+        while (size % radix == 0) {
+            size /= radix;
+        }
+    }
+    return size == 1;
+}
+
+/**
+ * The stages write to the buffer, so the strided data are read once and written once.
+ */
+void Fft::transform(Complex * data, std::size_t stride, bool inverse) const {
+    const Complex * table = inverse ? this->inverseTwiddles.data() : this->twiddles.data();
+    transformStage(this->buffer.data(), data, stride, 1, 0, table, inverse);
+    for (int i = 0; i < this->size; i++) {
+        data[i * stride] = this->buffer[i];
+    }
+}
+
+void Fft::transformStage(Complex * output, const Complex * input, std::size_t inputStride,
+                         std::size_t twiddleStride, std::size_t factor, const Complex * table, bool inverse) const {
+    int radix = this->factors[factor];
+    std::size_t length = this->size / twiddleStride / radix;
+    Complex * end = output + radix * length;
+
+    if (length == 1) {
+        for (Complex * value = output; value != end; value++) {
+            *value = *input;
+            input += twiddleStride * inputStride;
+        }
+    } else {
+        for (Complex * part = output; part != end; part += length) {
+            transformStage(part, input, inputStride, twiddleStride * radix, factor + 1, table, inverse);
+            input += twiddleStride * inputStride;
+        }
+    }
+
+    switch (radix) {
+        case 2:
+            butterfly2(output, twiddleStride, length, table);
+            break;
+        case 3:
+            butterfly3(output, twiddleStride, length, table);
+            break;
+        case 4:
+            butterfly4(output, twiddleStride, length, table, inverse);
+            break;
+        default:
+            butterfly5(output, twiddleStride, length, table);
+            break;
+    }
+}
+
+void Fft::butterfly2(Complex * output, std::size_t twiddleStride, std::size_t length, const Complex * table) {
+    Complex * second = output + length;
+    for (std::size_t k = 0; k < length; k++) {
+        Complex value = multiply(second[k], table[k * twiddleStride]);
+        second[k] = output[k] - value;
+        output[k] += value;
+    }
+}
+
+void Fft::butterfly3(Complex * output, std::size_t twiddleStride, std::size_t length, const Complex * table) {
+    // sin(2 pi / 3) with the sign of the transform
+    double sine = table[twiddleStride * length].imag();
+    for (std::size_t k = 0; k < length; k++) {
+        Complex first = multiply(output[k + length], table[k * twiddleStride]);
+        Complex second = multiply(output[k + 2 * length], table[2 * k * twiddleStride]);
+        Complex sum = first + second;
+        Complex difference = (first - second) * sine;
+
+        Complex middle = output[k] - sum * 0.5;
+        output[k] += sum;
+        output[k + length] = Complex(middle.real() - difference.imag(), middle.imag() + difference.real());
+        output[k + 2 * length] = Complex(middle.real() + difference.imag(), middle.imag() - difference.real());
+    }
+}
+
+void Fft::butterfly4(Complex * output, std::size_t twiddleStride, std::size_t length, const Complex * table,
+                     bool inverse) {
+    for (std::size_t k = 0; k < length; k++) {
+        Complex first = multiply(output[k + length], table[k * twiddleStride]);
+        Complex second = multiply(output[k + 2 * length], table[2 * k * twiddleStride]);
+        Complex third = multiply(output[k + 3 * length], table[3 * k * twiddleStride]);
+
+        Complex difference = output[k] - second;
+        output[k] += second;
+        Complex sum = first + third;
+        Complex rotated = first - third;
+        // multiplication by -i (forward) or i (inverse)
+        rotated = inverse ? Complex(-rotated.imag(), rotated.real()) : Complex(rotated.imag(), -rotated.real());
+
+        output[k + 2 * length] = output[k] - sum;
+        output[k] += sum;
+        output[k + length] = difference + rotated;
+        output[k + 3 * length] = difference - rotated;
+    }
+}
+
+void Fft::butterfly5(Complex * output, std::size_t twiddleStride, std::size_t length, const Complex * table) {
+    // exp(-+2 pi i / 5) and exp(-+4 pi i / 5)
+    Complex a = table[twiddleStride * length];
+    Complex b = table[2 * twiddleStride * length];
+    for (std::size_t k = 0; k < length; k++) {
+        Complex value = output[k];
+        Complex first = multiply(output[k + length], table[k * twiddleStride]);
+        Complex second = multiply(output[k + 2 * length], table[2 * k * twiddleStride]);
+        Complex third = multiply(output[k + 3 * length], table[3 * k * twiddleStride]);
+        Complex fourth = multiply(output[k + 4 * length], table[4 * k * twiddleStride]);
+
+        Complex outerSum = first + fourth, outerDifference = first - fourth;
+        Complex innerSum = second + third, innerDifference = second - third;
+        output[k] = value + outerSum + innerSum;
+
+        Complex near = value + outerSum * a.real() + innerSum * b.real();
+        Complex nearRotated(outerDifference.imag() * a.imag() + innerDifference.imag() * b.imag(),
+                            -(outerDifference.real() * a.imag() + innerDifference.real() * b.imag()));
+        output[k + length] = near - nearRotated;
+        output[k + 4 * length] = near + nearRotated;
+
+        Complex far = value + outerSum * b.real() + innerSum * a.real();
+        Complex farRotated(-outerDifference.imag() * b.imag() + innerDifference.imag() * a.imag(),
+                           outerDifference.real() * b.imag() - innerDifference.real() * a.imag());
+        output[k + 2 * length] = far + farRotated;
+        output[k + 3 * length] = far - farRotated;
+    }
+}
+
+/**
+ * The rows a and b are transformed as a + ib, their spectra are separated by the symmetry of the real signals:
+ * A(k) = (Z(k) + conj(Z(n - k))) / 2, B(k) = (Z(k) - conj(Z(n - k))) / 2i.
+ */
+void Fft::forwardReal(const double * real, int rows, Complex * spectrum) const {
+    int n = this->size;
+    std::size_t halfSize = n / 2 + 1;
+    std::vector<Complex> row((std::size_t) n);
+
+    for (int y = 0; y < n; y += 2) {
+        Complex * first = spectrum + y * halfSize;
+        Complex * second = first + halfSize;
+        if (y >= rows) {
+            std::fill(first, second + halfSize, Complex());
+            continue;
+        }
+
+        for (int x = 0; x < n; x++) {
+            row[x] = Complex(real[y * n + x], y + 1 < rows ? real[(y + 1) * n + x] : 0.0);
+        }
+        transform(row.data());
+        for (std::size_t k = 0; k < halfSize; k++) {
+            Complex value = row[k];
+            Complex mirrored = std::conj(row[(n - k) % n]);
+            first[k] = (value + mirrored) * 0.5;
+            Complex difference = (value - mirrored) * 0.5;
+            second[k] = Complex(difference.imag(), -difference.real());
+        }
+    }
+
+    for (std::size_t k = 0; k < halfSize; k++) {
+        transform(spectrum + k, halfSize);
+    }
+}
+
+void Fft::inverseReal(Complex * spectrum, int rows, double * real) const {
+    int n = this->size;
+    std::size_t halfSize = n / 2 + 1;
+    std::vector<Complex> row((std::size_t) n);
+    double scale = 1.0 / ((double) n * n);
+
+    for (std::size_t k = 0; k < halfSize; k++) {
+        transform(spectrum + k, halfSize, true);
+    }
+
+    for (int y = 0; y < rows && y < n; y += 2) {
+        const Complex * first = spectrum + y * halfSize;
+        const Complex * second = first + halfSize;
+        // a + ib, the second half of the spectra is the complex conjugate of the first one
+        for (std::size_t k = 0; k < halfSize; k++) {
+            row[k] = Complex(first[k].real() - second[k].imag(), first[k].imag() + second[k].real());
+        }
+        for (std::size_t k = halfSize; k < (std::size_t) n; k++) {
+            const Complex & a = first[n - k];
+            const Complex & b = second[n - k];
+            row[k] = Complex(a.real() + b.imag(), -a.imag() + b.real());
+        }
+        transform(row.data(), 1, true);
+
+        for (int x = 0; x < n; x++) {
+            real[y * n + x] = row[x].real() * scale;
+        }
+        if (y + 1 < rows) {
+            for (int x = 0; x < n; x++) {
+                real[(y + 1) * n + x] = row[x].imag() * scale;
+            }
+        }
+    }
+}
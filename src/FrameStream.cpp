@@ -0,0 +1,223 @@
+#include "FrameStream.h"
+#include "BoundedQueue.h"
+#include "BufferPool.h"
+#include "PgmImage.h"
+#include "ThreadPool.h"
+
+#include <cctype>
+#include <exception>
+#include <future>
+#include <memory>
+#include <thread>
+
+FrameStream::FrameStream(std::istream & input, const Pipeline & pipeline, unsigned threads)
+        : input(input), pipeline(pipeline), threads(threads) {
+    if (this->threads == 0) {
+        this->threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+std::size_t FrameStream::run(const std::string & inputPath, Profiler * profiler) {
+    if (this->input.fail()) {
+        throw ImageReader::OpeningTheFileException();
+    }
+    if (!hasNextFrame(this->input)) {
+        throw ImageReader::WrongFileFormatException();
+    }
+
+    if (this->threads > 1 && canRunInParallel()) {
+        if (profiler != nullptr) {
+            profiler->begin("frames");
+        }
+        std::size_t frames = runParallel(inputPath);
+        if (profiler != nullptr) {
+            profiler->end();
+        }
+        return frames;
+    }
+
+    return runSequential(inputPath, profiler);
+}
+
+bool FrameStream::hasNextFrame(std::istream & input) {
+    while (std::isspace(input.peek())) {
+        input.get();
+    }
+
+    return input.peek() == 'P';
+}
+
+std::size_t FrameStream::runSequential(const std::string & inputPath, Profiler * profiler) {
+    BufferPool::enable(BUFFER_POOL_BYTES);
+
+    PgmImage image(this->input);
+    bool frameOutputs = hasFrameOutputs();
+    std::size_t index = 0;
+    try {
+        for (; hasNextFrame(this->input); index++) {
+            if (index == 1 && !frameOutputs) {
+                throw SharedOutputException();
+            }
+            if (profiler != nullptr) {
+                profiler->begin(index == 0 ? "read" : "read frame " + std::to_string(index));
+            }
+            image.readFrame();
+            if (!this->input) {
+                throw ImageReader::OpeningTheFileException();
+            }
+            if (profiler != nullptr) {
+                profiler->setPixels((uint64_t) image.getWidth() * image.getHeight());
+                profiler->end();
+            }
+
+            this->pipeline.run(image, inputPath, (int) index, profiler);
+        }
+    } catch (...) {
+        BufferPool::disable();
+        throw;
+    }
+
+    BufferPool::disable();
+    return index;
+}
+
+/**
+ * Frame read by the calling thread, processed by the worker and written by the writer.
+ */
+struct FrameJob {
+    std::size_t index;
+    std::unique_ptr<PgmImage> image;
+    std::promise<void> processed;
+};
+
+/**
+ * The calling thread reads the frames and passes them to the workers and, in the same order, to the writer.
+ * The writer waits for every frame to be processed, so the outputs keep the order of the frames.
+ * Written frames go back to the reader, their pixel arrays are reused by the next frames of the same size.
+ */
+std::size_t FrameStream::runParallel(const std::string & inputPath) {
+    std::size_t outputStart = this->pipeline.getOutputStart();
+    std::size_t depth = 2 * (std::size_t) this->threads;
+
+    BoundedQueue<std::shared_ptr<FrameJob>> ordered(depth);
+    BoundedQueue<std::unique_ptr<PgmImage>> written(depth + this->threads + 1);
+
+    std::exception_ptr writeError;
+    std::thread writer([this, &inputPath, outputStart, &ordered, &written, &writeError] {
+        std::shared_ptr<FrameJob> job;
+        while (ordered.pop(job)) {
+            if (writeError) {
+                continue;
+            }
+
+            try {
+                job->processed.get_future().get();
+                this->pipeline.run(*job->image, inputPath, (int) job->index, outputStart,
+                                   this->pipeline.getSteps().size());
+                written.tryPush(job->image);
+            } catch (...) {
+                writeError = std::current_exception();
+                ordered.close();
+            }
+        }
+    });
+
+    std::exception_ptr readError;
+    bool frameOutputs = hasFrameOutputs();
+    std::size_t index = 0;
+    {
+        ThreadPool pool(this->threads);
+        BufferPool::enable(BUFFER_POOL_BYTES);
+
+        try {
+            for (; hasNextFrame(this->input); index++) {
+                if (index == 1 && !frameOutputs) {
+                    throw SharedOutputException();
+                }
+                auto job = std::make_shared<FrameJob>();
+                job->index = index;
+                if (!written.tryPop(job->image)) {
+                    job->image.reset(new PgmImage(this->input));
+                }
+                job->image->readFrame();
+                if (!this->input) {
+                    throw ImageReader::OpeningTheFileException();
+                }
+
+                if (!ordered.push(job)) {
+                    break;
+                }
+                pool.submit([this, job, &inputPath, outputStart] {
+                    BufferPool::enable(BUFFER_POOL_BYTES);
+                    try {
+                        this->pipeline.run(*job->image, inputPath, (int) job->index, 0, outputStart);
+                        job->processed.set_value();
+                    } catch (...) {
+                        job->processed.set_exception(std::current_exception());
+                    }
+                });
+            }
+        } catch (...) {
+            readError = std::current_exception();
+        }
+
+        ordered.close();
+        pool.wait();
+    }
+    writer.join();
+
+    // the frames that were written don't need their buffers anymore
+    std::unique_ptr<PgmImage> image;
+    while (written.tryPop(image)) {
+        image.reset();
+    }
+    BufferPool::disable();
+
+    // the problem with the earlier frame is reported first
+    if (writeError) {
+        std::rethrow_exception(writeError);
+    }
+    if (readError) {
+        std::rethrow_exception(readError);
+    }
+
+    return index;
+}
+
+bool FrameStream::canRunInParallel() const {
+    const std::vector<Pipeline::Step> & steps = this->pipeline.getSteps();
+    for (std::size_t stepNum = 0; stepNum < this->pipeline.getOutputStart(); stepNum++) {
+        std::vector<std::string> paths;
+        if (steps[stepNum].argument == Pipeline::OUTPUT ||
+            (steps[stepNum].argument == Pipeline::COMPONENTS && !steps[stepNum].path.empty())) {
+            paths.push_back(steps[stepNum].path);
+        } else if (steps[stepNum].argument == Pipeline::BRANCH) {
+            paths = steps[stepNum].branch->getOutputPaths();
+            std::vector<std::string> statisticsPaths = steps[stepNum].branch->getStatisticsPaths();
+            paths.insert(paths.end(), statisticsPaths.begin(), statisticsPaths.end());
+        }
+
+        for (const std::string & path : paths) {
+            if (path.find("{index}") == std::string::npos) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool FrameStream::hasFrameOutputs() const {
+    for (const std::string & path : this->pipeline.getOutputPaths()) {
+        if (path != Pipeline::STANDARD_STREAM && path.find("{index}") == std::string::npos) {
+            return false;
+        }
+    }
+    for (const std::string & path : this->pipeline.getStatisticsPaths()) {
+        if (path.find("{index}") == std::string::npos) {
+            return false;
+        }
+    }
+
+    return true;
+}
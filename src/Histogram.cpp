@@ -0,0 +1,242 @@
+#include "Histogram.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+Histogram Histogram::compute(const uint8_t * values, std::size_t count, std::size_t step) {
+    return countParts(count, [values, step](Histogram & histogram, std::size_t first, std::size_t partCount) {
+        const uint8_t * part = values + first * step;
+        histogram.countValues(partCount, [part, step](std::size_t i) { return part[i * step]; });
+    });
+}
+
+Histogram Histogram::computeLuminance(const uint8_t * blue, const uint8_t * green, const uint8_t * red,
+                                      std::size_t count, std::size_t step) {
+    return countParts(count, [=](Histogram & histogram, std::size_t first, std::size_t partCount) {
+        std::size_t offset = first * step;
+        histogram.countValues(partCount, [blue, green, red, step, offset](std::size_t i) {
+            std::size_t index = offset + i * step;
+            return red[index] / 3 + green[index] / 3 + blue[index] / 3;
+        });
+    });
+}
+
+template<typename Counter>
+Histogram Histogram::countParts(std::size_t count, Counter counter) {
+    std::size_t parts = ThreadPool::countParts(count, count);
+    std::vector<Histogram> histograms(parts);
+    ThreadPool::runParts(parts, [&histograms, &counter, count, parts](std::size_t part) {
+        std::size_t first = count * part / parts;
+        counter(histograms[part], first, count * (part + 1) / parts - first);
+    });
+
+    Histogram histogram;
+    for (const Histogram & part : histograms) {
+        histogram.add(part);
+    }
+    return histogram;
+}
+
+template<typename Value>
+void Histogram::countValues(std::size_t count, Value value) {
+    std::vector<uint64_t> counters(4 * BINS);
+    uint64_t * first = counters.data();
+    uint64_t * second = first + BINS;
+    uint64_t * third = second + BINS;
+    uint64_t * fourth = third + BINS;
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        first[value(i)]++;
+        second[value(i + 1)]++;
+        third[value(i + 2)]++;
+        fourth[value(i + 3)]++;
+    }
+    for (; i < count; i++) {
+        first[value(i)]++;
+    }
+
+    for (int bin = 0; bin < BINS; bin++) {
+        this->bins[bin] += first[bin] + second[bin] + third[bin] + fourth[bin];
+    }
+}
+
+void Histogram::add(const Histogram & other) {
+    for (int value = 0; value < BINS; value++) {
+        this->bins[value] += other.bins[value];
+    }
+}
+
+uint64_t Histogram::getCount() const {
+    uint64_t count = 0;
+    for (uint64_t bin : this->bins) {
+        count += bin;
+    }
+    return count;
+}
+
+uint64_t Histogram::getCount(int value) const {
+    return this->bins[value];
+}
+
+int Histogram::getMin() const {
+    for (int value = 0; value < BINS; value++) {
+        if (this->bins[value] != 0) {
+            return value;
+        }
+    }
+    return 0;
+}
+
+int Histogram::getMax() const {
+    for (int value = BINS - 1; value >= 0; value--) {
+        if (this->bins[value] != 0) {
+            return value;
+        }
+    }
+    return 0;
+}
+
+double Histogram::getMean() const {
+    uint64_t count = 0, sum = 0;
+    for (int value = 0; value < BINS; value++) {
+        count += this->bins[value];
+        sum += this->bins[value] * value;
+    }
+    return count == 0 ? 0 : (double) sum / count;
+}
+
+double Histogram::getStandardDeviation() const {
+    uint64_t count = 0, sum = 0, squares = 0;
+    for (int value = 0; value < BINS; value++) {
+        count += this->bins[value];
+        sum += this->bins[value] * value;
+        squares += this->bins[value] * value * value;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    double mean = (double) sum / count;
+    return std::sqrt(std::max(0.0, (double) squares / count - mean * mean));
+}
+
+int Histogram::getPercentile(double percent) const {
+    uint64_t count = getCount();
+    auto rank = (uint64_t) std::ceil(std::min(std::max(percent, 0.0), 100.0) / 100 * count);
+    uint64_t seen = 0;
+    for (int value = 0; value < BINS; value++) {
+        seen += this->bins[value];
+        if (seen >= std::max<uint64_t>(rank, 1)) {
+            return value;
+        }
+    }
+    return 0;
+}
+
+/**
+ * The variance between the classes is w0 * w1 * (mean0 - mean1)^2, the first of the best thresholds is used.
+ */
+int Histogram::getOtsuThreshold() const {
+    double count = (double) getCount();
+    double sum = 0;
+    for (int value = 0; value < BINS; value++) {
+        sum += (double) this->bins[value] * value;
+    }
+
+    int threshold = getMin();
+    double best = 0, backgroundCount = 0, backgroundSum = 0;
+    for (int value = 0; value < BINS - 1; value++) {
+        backgroundCount += (double) this->bins[value];
+        backgroundSum += (double) this->bins[value] * value;
+        double foregroundCount = count - backgroundCount;
+        if (backgroundCount == 0 || foregroundCount == 0) {
+            continue;
+        }
+
+        double difference = backgroundSum / backgroundCount - (sum - backgroundSum) / foregroundCount;
+        double variance = backgroundCount * foregroundCount * difference * difference;
+        if (variance > best) {
+            best = variance;
+            threshold = value;
+        }
+    }
+    return threshold;
+}
+
+/**
+ * The line goes from the peak to the first empty value after the longer tail, the distance of the histogram
+ * below it is compared as the vertical one (it's proportional to the perpendicular one for the same line).
+ */
+int Histogram::getTriangleThreshold() const {
+    int min = getMin(), max = getMax();
+    int peak = (int) (std::max_element(this->bins.begin(), this->bins.end()) - this->bins.begin());
+    if (min == max) {
+        return min;
+    }
+
+    bool rightTail = max - peak >= peak - min;
+    int end = rightTail ? std::min(max + 1, BINS - 1) : std::max(min - 1, 0);
+    double peakHeight = (double) this->bins[peak];
+    double endHeight = (double) this->bins[end];
+
+    int threshold = peak;
+    double best = -1;
+    int direction = rightTail ? 1 : -1;
+    for (int value = peak; value != end + direction; value += direction) {
+        double line = peakHeight + (endHeight - peakHeight) * (value - peak) / (end - peak);
+        double distance = line - (double) this->bins[value];
+        if (distance > best) {
+            best = distance;
+            threshold = value;
+        }
+    }
+
+    // the values up to the threshold are the background for the right tail, the object for the left one
+    return rightTail ? threshold : std::max(threshold - 1, 0);
+}
+
+/**
+ * value -> (cdf(value) - cdf(min)) / (count - cdf(min)) * maxValue, rounded.
+ */
+std::array<uint8_t, Histogram::BINS> Histogram::getEqualizationTable(uint8_t maxValue) const {
+    std::array<uint8_t, BINS> table{};
+    uint64_t count = getCount();
+    uint64_t minCount = this->bins[getMin()];
+    if (count == minCount) {
+        for (int value = 0; value < BINS; value++) {
+            table[value] = (uint8_t) std::min<int>(value, maxValue);
+        }
+        return table;
+    }
+
+    uint64_t cumulative = 0;
+    for (int value = 0; value < BINS; value++) {
+        cumulative += this->bins[value];
+        uint64_t above = cumulative > minCount ? cumulative - minCount : 0;
+        table[value] = (uint8_t) ((above * maxValue * 2 + (count - minCount)) / (2 * (count - minCount)));
+    }
+    return table;
+}
+
+std::array<uint8_t, Histogram::BINS> Histogram::getStretchTable(double percent, uint8_t maxValue) const {
+    percent = std::min(std::max(percent, 0.0), 50.0);
+    int low = getPercentile(percent);
+    int high = getPercentile(100 - percent);
+
+    std::array<uint8_t, BINS> table{};
+    for (int value = 0; value < BINS; value++) {
+        if (high <= low) {
+            table[value] = (uint8_t) std::min<int>(value, maxValue);
+        } else if (value <= low) {
+            table[value] = 0;
+        } else if (value >= high) {
+            table[value] = maxValue;
+        } else {
+            table[value] = (uint8_t) (((value - low) * maxValue * 2 + (high - low)) / (2 * (high - low)));
+        }
+    }
+    return table;
+}
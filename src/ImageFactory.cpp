@@ -0,0 +1,67 @@
+#include "ImageFactory.h"
+#include "BmpImage.h"
+#include "PgmImage.h"
+#include "MemoryStream.h"
+
+#include <cctype>
+#include <memory>
+
+/**
+ * Checks if the path ends with the given extension, ignoring the case.
+ */
+static bool hasExtension(const std::string & path, const std::string & extension) {
+    if (path.size() < extension.size()) {
+        return false;
+    }
+
+    return std::equal(extension.begin(), extension.end(), path.end() - (std::ptrdiff_t) extension.size(),
+                      [](char expected, char actual) { return expected == std::tolower(actual); });
+}
+
+ImageFactory::Format ImageFactory::detectFormat(const std::string & path) {
+    if (hasExtension(path, ".bmp")) {
+        return BMP;
+    }
+    if (hasExtension(path, ".pgm")) {
+        return PGM;
+    }
+
+    return UNKNOWN;
+}
+
+ImageFactory::Format ImageFactory::sniffFormat(const char * data, std::size_t size) {
+    if (size < 2) {
+        return UNKNOWN;
+    }
+    if (data[0] == 'B' && data[1] == 'M') {
+        return BMP;
+    }
+    if (data[0] == 'P' && data[1] == '5') {
+        return PGM;
+    }
+
+    return UNKNOWN;
+}
+
+Image * ImageFactory::create(Format format, std::istream & file) {
+    switch (format) {
+        case BMP:
+            return new BmpImage(file);
+        case PGM:
+            return new PgmImage(file);
+        default:
+            throw UnsupportedFormatException();
+    }
+}
+
+Image * ImageFactory::decode(const uint8_t * data, std::size_t size) {
+    Format format = sniffFormat(reinterpret_cast<const char *>(data), size);
+    MemoryInputStream stream(data, size);
+
+    std::unique_ptr<Image> image(create(format, stream));
+    image->read();
+    // the stream is destroyed with this function
+    image->clearFileStream();
+
+    return image.release();
+}
@@ -0,0 +1,185 @@
+#include "JobProtocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * Fills the address of the socket, the path has to fit into sun_path.
+ */
+static sockaddr_un makeAddress(const std::string & socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        throw JobProtocol::ProtocolException("The socket path is empty or too long: " + socketPath);
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    return address;
+}
+
+int JobProtocol::connectTo(const std::string & socketPath) {
+    sockaddr_un address = makeAddress(socketPath);
+
+    int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connection < 0) {
+        throw ProtocolException(std::string("Couldn't create the socket: ") + std::strerror(errno));
+    }
+    if (connect(connection, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        int error = errno;
+        close(connection);
+        throw ProtocolException("Couldn't connect to the server " + socketPath + ": " + std::strerror(error));
+    }
+
+    return connection;
+}
+
+int JobProtocol::listenOn(const std::string & socketPath, int backlog) {
+    sockaddr_un address = makeAddress(socketPath);
+
+    int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server < 0) {
+        throw ProtocolException(std::string("Couldn't create the socket: ") + std::strerror(errno));
+    }
+
+    unlink(socketPath.c_str());
+    if (bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(server, backlog) != 0) {
+        int error = errno;
+        close(server);
+        throw ProtocolException("Couldn't listen on " + socketPath + ": " + std::strerror(error));
+    }
+
+    return server;
+}
+
+void JobProtocol::writeRequest(int connection, const Request & request) {
+    if (request.data.size() > MAX_DATA) {
+        throw ProtocolException("The inline data is bigger than " + std::to_string(MAX_DATA) + " bytes.");
+    }
+
+    std::ostringstream header;
+    header << "IMGM " << request.arguments.size() << " " << request.data.size() << "\n";
+    for (const std::string & argument : request.arguments) {
+        if (argument.find('\n') != std::string::npos) {
+            throw ProtocolException("Arguments can't contain the new line character.");
+        }
+        header << argument << "\n";
+    }
+
+    std::string message = header.str();
+    writeAll(connection, message.data(), message.size());
+    writeAll(connection, request.data.data(), request.data.size());
+}
+
+JobProtocol::Request JobProtocol::readRequest(int connection) {
+    std::istringstream header(readLine(connection));
+    std::string magic;
+    std::size_t argumentCount = 0;
+    std::size_t dataSize = 0;
+    if (!(header >> magic >> argumentCount >> dataSize) || magic != "IMGM" || argumentCount > MAX_ARGUMENTS ||
+        dataSize > MAX_DATA) {
+        throw ProtocolException("Wrong request header.");
+    }
+
+    Request request;
+    for (std::size_t i = 0; i < argumentCount; i++) {
+        request.arguments.push_back(readLine(connection));
+    }
+
+    request.data.resize(dataSize);
+    readAll(connection, request.data.data(), dataSize);
+
+    return request;
+}
+
+void JobProtocol::writeResponse(int connection, const Response & response) {
+    std::ostringstream message;
+    message << response.code << " " << response.readSeconds << " " << response.processSeconds << "\n";
+
+    // descriptions are single line messages, but the step comes from the client
+    for (const std::string * line : {&response.step, &response.description}) {
+        std::string text = *line;
+        std::replace(text.begin(), text.end(), '\n', ' ');
+        message << text << "\n";
+    }
+
+    std::string text = message.str();
+    writeAll(connection, text.data(), text.size());
+}
+
+JobProtocol::Response JobProtocol::readResponse(int connection) {
+    Response response{};
+    std::istringstream header(readLine(connection));
+    if (!(header >> response.code >> response.readSeconds >> response.processSeconds)) {
+        throw ProtocolException("Wrong response header.");
+    }
+    response.step = readLine(connection);
+    response.description = readLine(connection);
+
+    return response;
+}
+
+void JobProtocol::setTimeout(int connection, int seconds) {
+    timeval timeout{seconds, 0};
+    if (setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+        setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) != 0) {
+        throw ProtocolException(std::string("Couldn't set the timeout of the connection: ") + std::strerror(errno));
+    }
+}
+
+void JobProtocol::writeAll(int connection, const char * data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = send(connection, data, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            throw ProtocolException("The other side didn't receive the message in time.");
+        }
+        if (written <= 0) {
+            throw ProtocolException(std::string("Couldn't send the message: ") + std::strerror(errno));
+        }
+        data += written;
+        size -= (std::size_t) written;
+    }
+}
+
+void JobProtocol::readAll(int connection, char * data, std::size_t size) {
+    while (size > 0) {
+        ssize_t received = recv(connection, data, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            throw ProtocolException("The other side didn't send the message in time.");
+        }
+        if (received <= 0) {
+            throw ProtocolException("The connection was closed before the whole message was received.");
+        }
+        data += received;
+        size -= (std::size_t) received;
+    }
+}
+
+/**
+ * Lines are short, so they are read byte by byte - the inline data after them stays in the socket.
+ */
+std::string JobProtocol::readLine(int connection) {
+    std::string line;
+    char sign;
+    while (true) {
+        readAll(connection, &sign, 1);
+        if (sign == '\n') {
+            return line;
+        }
+        if (line.size() >= MAX_LINE) {
+            throw ProtocolException("The line of the message is too long.");
+        }
+        line += sign;
+    }
+}
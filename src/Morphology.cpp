@@ -0,0 +1,119 @@
+#include "Morphology.h"
+#include "BufferPool.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * Number of the pixels of one band - the masks of the band stay in the L2 cache.
+ */
+static const std::size_t BAND_PIXELS = 1 << 16;
+
+/**
+ * Smallest height of the band in the radiuses - the rows around the band are computed by both of its neighbours,
+ * so the small bands would repeat most of the work.
+ */
+static const int BAND_RADIUSES = 8;
+
+bool Morphology::isChained(Operation operation) {
+    return operation != GRADIENT;
+}
+
+bool Morphology::startsWithDilate(Operation operation) {
+    return operation == CLOSING || operation == BLACK_HAT;
+}
+
+void Morphology::apply(int width, int height, const Spread & first, const Spread & second, bool chained,
+                       const Matcher & match, const Writer & write) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    int bandRows = std::max((int) (BAND_PIXELS / width), BAND_RADIUSES * (first.radius + second.radius));
+    bandRows = std::max(std::min(bandRows, height), 1);
+    int bands = (height + bandRows - 1) / bandRows;
+    std::size_t pixels = (std::size_t) width * height;
+    ThreadPool::parallelFor(0, bands, pixels, [&](std::size_t firstBand, std::size_t lastBand) {
+        for (std::size_t band = firstBand; band < lastBand; band++) {
+            int firstRow = (int) band * bandRows;
+            applyBand(width, height, first, second, chained, match, write, firstRow,
+                      std::min(firstRow + bandRows, height));
+        }
+    });
+}
+
+/**
+ * The chained second spread needs the result of the first one in its whole window, so the first mask is computed
+ * for the band and the radius of the second spread around it, and the second match excludes the pixels already
+ * changed to the first value (the values differ). The first mask is passed only for the rows of the band.
+ */
+void Morphology::applyBand(int width, int height, const Spread & first, const Spread & second, bool chained,
+                           const Matcher & match, const Writer & write, int firstRow, int lastRow) {
+    auto rowBytes = (std::size_t) width;
+    int secondTop = std::max(firstRow - second.radius, 0);
+    int secondBottom = std::min(lastRow + second.radius, height);
+    int firstTop = chained ? secondTop : firstRow;
+    int firstBottom = chained ? secondBottom : lastRow;
+    int matchTop = std::max(firstTop - first.radius, 0);
+    int matchBottom = std::min(firstBottom + first.radius, height);
+
+    BufferPool::TemporaryBuffer firstMatches(rowBytes * (matchBottom - matchTop));
+    BufferPool::TemporaryBuffer firstMask(rowBytes * (firstBottom - firstTop));
+    BufferPool::TemporaryBuffer secondMatches(rowBytes * (secondBottom - secondTop));
+    BufferPool::TemporaryBuffer secondMask(rowBytes * (lastRow - firstRow));
+
+    // the source of the filter starts at matchTop, so the image rows are shifted by it
+    match(first.value, matchTop * rowBytes, (matchBottom - matchTop) * rowBytes, firstMatches.get());
+    Simd::maxFilter(firstMatches.get(), firstMask.get(), width, matchBottom - matchTop, first.radius,
+                    firstTop - matchTop, firstBottom - matchTop);
+
+    std::size_t secondSize = (secondBottom - secondTop) * rowBytes;
+    match(second.value, secondTop * rowBytes, secondSize, secondMatches.get());
+    if (chained) {
+        uint8_t * matches = secondMatches.get();
+        const uint8_t * changed = firstMask.get();
+        for (std::size_t i = 0; i < secondSize; i++) {
+            matches[i] &= (uint8_t) ~changed[i];
+        }
+    }
+    Simd::maxFilter(secondMatches.get(), secondMask.get(), width, secondBottom - secondTop, second.radius,
+                    firstRow - secondTop, lastRow - secondTop);
+
+    write(firstRow * rowBytes, (lastRow - firstRow) * rowBytes,
+          firstMask.get() + (firstRow - firstTop) * rowBytes, secondMask.get());
+}
+
+/**
+ * The masks are 0 or 255, so the values are selected without the branches (the loops are vectorized).
+ */
+void Morphology::combine(Operation operation, const uint8_t * values, const uint8_t * firstMask,
+                         const uint8_t * secondMask, uint8_t * destination, std::size_t count, const Spread & first,
+                         const Spread & second) {
+    uint8_t firstValue = first.value;
+    uint8_t secondValue = second.value;
+
+    if (operation == GRADIENT) {
+        for (std::size_t i = 0; i < count; i++) {
+            int dilated = (secondMask[i] & secondValue) | (~secondMask[i] & values[i]);
+            int eroded = (firstMask[i] & firstValue) | (~firstMask[i] & values[i]);
+            destination[i] = (uint8_t) std::max(dilated - eroded, 0);
+        }
+        return;
+    }
+
+    for (std::size_t i = 0; i < count; i++) {
+        int spread = (firstMask[i] & firstValue) | (~firstMask[i] & values[i]);
+        destination[i] = (uint8_t) ((secondMask[i] & secondValue) | (~secondMask[i] & spread));
+    }
+    if (operation == TOP_HAT) {
+        for (std::size_t i = 0; i < count; i++) {
+            destination[i] = (uint8_t) std::max(values[i] - destination[i], 0);
+        }
+    } else if (operation == BLACK_HAT) {
+        for (std::size_t i = 0; i < count; i++) {
+            destination[i] = (uint8_t) std::max(destination[i] - values[i], 0);
+        }
+    }
+}
@@ -0,0 +1,185 @@
+#include "PerfCounters.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+PerfCounters::Values PerfCounters::Values::operator-(const Values & earlier) const {
+    Values difference{};
+    for (int counter = 0; counter < COUNTERS_COUNT; counter++) {
+        difference.available[counter] = available[counter] && earlier.available[counter];
+        difference.values[counter] = difference.available[counter] ? values[counter] - earlier.values[counter] : 0;
+    }
+
+    return difference;
+}
+
+double PerfCounters::Values::getIpc() const {
+    if (!available[CYCLES] || !available[INSTRUCTIONS] || values[CYCLES] == 0) {
+        return -1;
+    }
+
+    return (double) values[INSTRUCTIONS] / values[CYCLES];
+}
+
+double PerfCounters::Values::getCacheMissRate() const {
+    if (!available[CACHE_REFERENCES] || !available[CACHE_MISSES] || values[CACHE_REFERENCES] == 0) {
+        return -1;
+    }
+
+    return 100.0 * values[CACHE_MISSES] / values[CACHE_REFERENCES];
+}
+
+double PerfCounters::Values::getBranchMissRate() const {
+    if (!available[BRANCHES] || !available[BRANCH_MISSES] || values[BRANCHES] == 0) {
+        return -1;
+    }
+
+    return 100.0 * values[BRANCH_MISSES] / values[BRANCHES];
+}
+
+double PerfCounters::Values::getMemoryBandwidth(double seconds) const {
+    if (!available[CACHE_MISSES] || seconds <= 0) {
+        return -1;
+    }
+
+    return values[CACHE_MISSES] * 64.0 / seconds / 1e9;
+}
+
+#ifdef __linux__
+
+/**
+ * Counters of every ratio (IPC, cache misses, branch misses) are opened as one group - the first one is the leader.
+ * The kernel schedules the whole group at once, so both counts of the ratio come from the same time even when
+ * the groups are multiplexed. The small groups fit to the hardware counters of any processor.
+ */
+static const PerfCounters::Counter GROUPS[][2] = {
+        {PerfCounters::CYCLES, PerfCounters::INSTRUCTIONS},
+        {PerfCounters::CACHE_REFERENCES, PerfCounters::CACHE_MISSES},
+        {PerfCounters::BRANCHES, PerfCounters::BRANCH_MISSES}
+};
+
+PerfCounters::PerfCounters() : descriptors() {
+    const uint64_t configs[COUNTERS_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_REFERENCES,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
+            PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    for (const auto & group : GROUPS) {
+        int leader = -1;
+        for (Counter counter : group) {
+            perf_event_attr attributes{};
+            attributes.size = sizeof(perf_event_attr);
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.config = configs[counter];
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            // the member can't be opened without its leader
+            descriptors[counter] = counter == group[0] || leader >= 0
+                                   ? (int) syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0) : -1;
+            if (counter == group[0]) {
+                leader = descriptors[counter];
+            }
+            if (descriptors[counter] < 0 && errorMessage.empty()) {
+                errorMessage = std::string(getName(counter)) + ": " + std::strerror(errno);
+                if (errno == EACCES || errno == EPERM) {
+                    errorMessage += " (see /proc/sys/kernel/perf_event_paranoid)";
+                }
+            }
+        }
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int descriptor : descriptors) {
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+    }
+}
+
+/**
+ * The leader returns the values of the whole group - number of the values, time enabled, time running and
+ * the values in the order of opening (the member that couldn't be opened is missing).
+ */
+PerfCounters::Values PerfCounters::read() const {
+    Values values{};
+    for (const auto & group : GROUPS) {
+        uint64_t data[5];
+        ssize_t size = descriptors[group[0]] < 0 ? -1 : ::read(descriptors[group[0]], data, sizeof(data));
+        if (size < (ssize_t) (3 * sizeof(uint64_t)) || data[2] == 0 ||
+            size < (ssize_t) ((3 + data[0]) * sizeof(uint64_t))) {
+            continue;
+        }
+
+        for (uint64_t i = 0; i < data[0]; i++) {
+            Counter counter = group[i];
+            values.available[counter] = true;
+            values.values[counter] = data[2] < data[1] ? (uint64_t) ((double) data[3 + i] * data[1] / data[2])
+                                                       : data[3 + i];
+        }
+    }
+
+    return values;
+}
+
+#else
+
+PerfCounters::PerfCounters() : descriptors(), errorMessage("hardware counters are supported only on Linux") {
+    for (int & descriptor : descriptors) {
+        descriptor = -1;
+    }
+}
+
+PerfCounters::~PerfCounters() = default;
+
+PerfCounters::Values PerfCounters::read() const {
+    return Values{};
+}
+
+#endif
+
+bool PerfCounters::isAvailable() const {
+    for (int descriptor : descriptors) {
+        if (descriptor >= 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const std::string & PerfCounters::getErrorMessage() const {
+    return errorMessage;
+}
+
+const char * PerfCounters::getName(Counter counter) {
+    switch (counter) {
+        case CYCLES:
+            return "cycles";
+        case INSTRUCTIONS:
+            return "instructions";
+        case CACHE_REFERENCES:
+            return "cache-references";
+        case CACHE_MISSES:
+            return "cache-misses";
+        case BRANCHES:
+            return "branches";
+        case BRANCH_MISSES:
+            return "branch-misses";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,608 @@
+#include "Pipeline.h"
+#include "DistanceTransform.h"
+
+#include <exception>
+#include <iostream>
+#include <thread>
+
+Pipeline::Pipeline(const std::vector<std::string> & arguments) {
+    for (std::size_t argNum = 0; argNum < arguments.size(); argNum++) {
+        std::size_t firstArgNum = argNum;
+
+        Step step{};
+        step.argument = stringToArgument(arguments[argNum]);
+        try {
+            switch (step.argument) {
+                case OUTPUT:
+                    if (argNum + 1 >= arguments.size() ||
+                        !(arguments[argNum + 1] == STANDARD_STREAM || isParameter(arguments[argNum + 1]))) {
+                        throw NoFileNameException();
+                    }
+                    step.path = arguments[++argNum];
+                    break;
+                case RESOLUTION_CHANGE:
+                    step.values.push_back(parseInt(arguments, ++argNum));
+                    step.values.push_back(parseInt(arguments, ++argNum));
+                    break;
+                case BLUR:
+                case GRADIENT:
+                    if (parseInt(arguments, ++argNum) != 1) {
+                        throw UnsupportedTypeParameter();
+                    }
+                    break;
+                case BINARY: {
+                    ImageProcessing::ThresholdMethod method;
+                    AdaptiveThreshold::Method adaptiveMethod;
+                    if (argNum + 1 < arguments.size() && stringToThresholdMethod(arguments[argNum + 1], method)) {
+                        step.values = {AUTOMATIC_THRESHOLD, method};
+                        argNum++;
+                        break;
+                    }
+                    if (argNum + 1 < arguments.size() &&
+                        stringToAdaptiveMethod(arguments[argNum + 1], adaptiveMethod)) {
+                        argNum++;
+                        int radius = parseOptionalInt(arguments, argNum, AdaptiveThreshold::DEFAULT_RADIUS);
+                        int percent = parseOptionalInt(arguments, argNum,
+                                                       AdaptiveThreshold::getDefaultPercent(adaptiveMethod));
+                        if (radius < 1 || percent > 100) {
+                            throw WrongArgumentParameter();
+                        }
+                        step.values = {ADAPTIVE_THRESHOLD, adaptiveMethod, radius, percent};
+                        break;
+                    }
+                    step.values.push_back(parseInt(arguments, ++argNum));
+                    break;
+                }
+                case DENOISE:
+                    step.values.push_back(parseInt(arguments, ++argNum));
+                    break;
+                case ROTATE:
+                    if (argNum + 1 >= arguments.size() || !isParameter(arguments[argNum + 1])) {
+                        throw MissingArgumentParameter();
+                    }
+                    try {
+                        step.degree = std::stof(arguments[++argNum]);
+                    } catch (std::exception &e) {
+                        throw WrongArgumentParameter();
+                    }
+                    break;
+                case FILTER:
+                    if (argNum + 1 >= arguments.size() || !isParameter(arguments[argNum + 1])) {
+                        throw MissingArgumentParameter();
+                    }
+                    step.values.push_back(stringToFilter(arguments[++argNum]));
+                    step.border = parseBorder(arguments, argNum);
+                    step.values.push_back(step.border.type);
+                    step.values.push_back(step.border.value);
+                    break;
+                case KERNEL: {
+                    // the weights are one parameter made of the numbers, so the negative weights are not the flags
+                    if (argNum + 1 >= arguments.size() || arguments[argNum + 1].empty() ||
+                        arguments[argNum + 1].find_first_not_of("-0123456789,") != std::string::npos) {
+                        throw MissingArgumentParameter();
+                    }
+                    step.kernel = std::make_shared<const Convolution::KernelMatrix>(
+                            Convolution::KernelMatrix::parse(arguments[++argNum]));
+                    step.border = parseBorder(arguments, argNum);
+                    step.values.push_back(step.border.type);
+                    step.values.push_back(step.border.value);
+                    int size = step.kernel->getSize();
+                    for (int i = 0; i < size * size; i++) {
+                        step.values.push_back(step.kernel->getWeight(i / size, i % size));
+                    }
+                    break;
+                }
+                case REGION:
+                    if (argNum + 1 < arguments.size() && arguments[argNum + 1] == "all") {
+                        step.wholeImage = true;
+                        argNum++;
+                        break;
+                    }
+                    for (int i = 0; i < 4; i++) {
+                        step.values.push_back(parseInt(arguments, ++argNum));
+                    }
+                    break;
+                case BRANCH: {
+                    std::size_t end = argNum + 1;
+                    for (int depth = 1; end < arguments.size(); end++) {
+                        if (arguments[end] == "{") {
+                            depth++;
+                        } else if (arguments[end] == "}" && --depth == 0) {
+                            break;
+                        }
+                    }
+                    if (end >= arguments.size()) {
+                        throw UnclosedBranchException();
+                    }
+
+                    step.branch = std::make_shared<const Pipeline>(
+                            std::vector<std::string>(arguments.begin() + (std::ptrdiff_t) argNum + 1,
+                                                     arguments.begin() + (std::ptrdiff_t) end));
+                    argNum = end;
+                    break;
+                }
+                case COMPONENTS: {
+                    int connectivity = parseOptionalInt(arguments, argNum, ConnectedComponents::EIGHT);
+                    if (connectivity != ConnectedComponents::FOUR && connectivity != ConnectedComponents::EIGHT) {
+                        throw WrongArgumentParameter();
+                    }
+                    step.values.push_back(connectivity);
+                    if (argNum + 1 < arguments.size() && isParameter(arguments[argNum + 1]) &&
+                        arguments[argNum + 1] != "{") {
+                        step.path = arguments[++argNum];
+                    }
+                    break;
+                }
+                case MORPHOLOGY:
+                    if (argNum + 1 >= arguments.size() || !isParameter(arguments[argNum + 1])) {
+                        throw MissingArgumentParameter();
+                    }
+                    step.values.push_back(stringToMorphology(arguments[++argNum]));
+                    break;
+                case STRETCH:
+                    step.values.push_back(parseOptionalInt(arguments, argNum, 0));
+                    if (step.values[0] > 50) {
+                        throw WrongArgumentParameter();
+                    }
+                    break;
+                case ERODE:
+                case DILATE:
+                    if (argNum + 1 < arguments.size() && arguments[argNum + 1] == "disk") {
+                        argNum++;
+                        int radius = parseInt(arguments, ++argNum);
+                        if (radius < 0 || radius > DistanceTransform::MAX_RADIUS) {
+                            throw WrongArgumentParameter();
+                        }
+                        step.values.push_back(radius);
+                    }
+                    break;
+                case NEGATIVE:
+                case EQUALIZE:
+                case HELP:
+                    break;
+                case INVALID:
+                default:
+                    throw WrongArgument();
+            }
+        } catch (StepException &exception) {
+            // the problem inside the branch
+            throw;
+        } catch (std::exception &exception) {
+            throw StepException(arguments[firstArgNum], exception.what());
+        }
+
+        step.name = arguments[firstArgNum];
+        for (std::size_t i = firstArgNum + 1; i <= argNum; i++) {
+            step.name += " " + arguments[i];
+        }
+
+        if (step.argument == HELP) {
+            helpRequested = true;
+        } else {
+            steps.push_back(step);
+        }
+    }
+}
+
+/**
+ * Operations are executed inside the region of interest if it was set by the earlier REGION step.
+ * Saving always writes the whole image.
+ */
+void Pipeline::run(Image & image, const std::string & inputPath, int index, Profiler * profiler) const {
+    run(image, inputPath, index, 0, steps.size(), profiler);
+}
+
+void Pipeline::run(Image & image, const std::string & inputPath, int index, std::size_t first, std::size_t last,
+                   Profiler * profiler) const {
+    execute(image, inputPath, index, first, last, profiler, ImageProcessing::Region{}, false);
+}
+
+void Pipeline::execute(Image & image, const std::string & inputPath, int index, std::size_t first, std::size_t last,
+                       Profiler * profiler, ImageProcessing::Region region, bool regionSet) const {
+    last = std::min(last, steps.size());
+    for (std::size_t stepNum = first; stepNum < last; stepNum++) {
+        const Step & step = steps[stepNum];
+
+        if (step.argument == BRANCH) {
+            std::size_t groupEnd = stepNum;
+            std::string groupName;
+            while (groupEnd < last && steps[groupEnd].argument == BRANCH) {
+                groupName += (groupName.empty() ? "" : " ") + steps[groupEnd++].name;
+            }
+
+            // the profiler measures only the calling thread, so the branches are one stage
+            if (profiler != nullptr) {
+                profiler->begin(groupName);
+                profiler->setPixels((uint64_t) image.getWidth() * image.getHeight());
+            }
+            executeBranches(image, inputPath, index, stepNum, groupEnd, region, regionSet);
+            if (profiler != nullptr) {
+                profiler->end();
+            }
+
+            stepNum = groupEnd - 1;
+            continue;
+        }
+        if (profiler != nullptr) {
+            profiler->begin(step.name);
+            profiler->setPixels((uint64_t) image.getWidth() * image.getHeight());
+        }
+
+        std::vector<ConnectedComponents::Component> components;
+        auto operation = [&image, &step, &components]() {
+            switch (step.argument) {
+                case RESOLUTION_CHANGE:
+                    image.scale(step.values[0], step.values[1]);
+                    break;
+                case NEGATIVE:
+                    image.toNegative();
+                    break;
+                case BLUR:
+                    image.blur();
+                    break;
+                case DENOISE:
+                    image.denoise(step.values[0]);
+                    break;
+                case GRADIENT:
+                    image.edgeFilter();
+                    break;
+                case BINARY:
+                    if (step.values[0] == AUTOMATIC_THRESHOLD) {
+                        image.toBinary((ImageProcessing::ThresholdMethod) step.values[1]);
+                    } else if (step.values[0] == ADAPTIVE_THRESHOLD) {
+                        image.toBinary((AdaptiveThreshold::Method) step.values[1], step.values[2], step.values[3]);
+                    } else {
+                        image.toBinary(step.values[0]);
+                    }
+                    break;
+                case EQUALIZE:
+                    image.equalize();
+                    break;
+                case STRETCH:
+                    image.stretchContrast(step.values[0]);
+                    break;
+                case ERODE:
+                    if (step.values.empty()) {
+                        image.erode();
+                    } else {
+                        image.erodeDisk(step.values[0]);
+                    }
+                    break;
+                case DILATE:
+                    if (step.values.empty()) {
+                        image.dilate();
+                    } else {
+                        image.dilateDisk(step.values[0]);
+                    }
+                    break;
+                case MORPHOLOGY:
+                    image.morphology((Morphology::Operation) step.values[0]);
+                    break;
+                case COMPONENTS:
+                    components = image.labelComponents((ConnectedComponents::Connectivity) step.values[0]);
+                    break;
+                case ROTATE:
+                    image.rotate(step.degree);
+                    break;
+                case FILTER:
+                    image.filter((ImageProcessing::Filter) step.values[0], step.border);
+                    break;
+                case KERNEL:
+                    image.convolve(*step.kernel, step.border);
+                    break;
+                default:
+                    break;
+            }
+        };
+
+        try {
+            if (step.argument == OUTPUT && step.path == STANDARD_STREAM) {
+                image.save(static_cast<std::ostream &>(std::cout));
+                std::cout.flush();
+            } else if (step.argument == OUTPUT) {
+                image.save(expandOutputPath(step.path, inputPath, index));
+            } else if (step.argument == REGION) {
+                regionSet = !step.wholeImage;
+                if (regionSet) {
+                    region = ImageProcessing::Region{step.values[0], step.values[1], step.values[2], step.values[3]};
+                }
+            } else if (regionSet) {
+                image.processRegion(region, operation);
+            } else {
+                operation();
+            }
+
+            if (step.argument == COMPONENTS && !step.path.empty()) {
+                saveComponents(components, expandOutputPath(step.path, inputPath, index), region, regionSet);
+            }
+        } catch (std::exception &exception) {
+            throw StepException(step.name, exception.what());
+        }
+
+        if (profiler != nullptr) {
+            profiler->end();
+        }
+    }
+}
+
+void Pipeline::saveComponents(std::vector<ConnectedComponents::Component> & components, const std::string & path,
+                              const ImageProcessing::Region & region, bool regionSet) {
+    if (regionSet) {
+        for (ConnectedComponents::Component & component : components) {
+            component.left += region.x;
+            component.right += region.x;
+            component.top += region.y;
+            component.bottom += region.y;
+            component.centroidX += region.x;
+            component.centroidY += region.y;
+        }
+    }
+
+    ConnectedComponents::save(components, path);
+}
+
+/**
+ * Branches that write to the standard output are executed one after another, so the images are not mixed.
+ * The operations of the concurrent branches split their images between the workers of one shared pool
+ * (ThreadPool::runParts), so more branches don't start more threads.
+ */
+void Pipeline::executeBranches(Image & image, const std::string & inputPath, int index, std::size_t first,
+                               std::size_t last, ImageProcessing::Region region, bool regionSet) const {
+    std::size_t count = last - first;
+    bool imageNeededLater = last < steps.size();
+
+    std::size_t standardOutputs = 0;
+    std::vector<std::unique_ptr<Image>> copies(count);
+    for (std::size_t i = 0; i < count; i++) {
+        if (i + 1 < count || imageNeededLater) {
+            copies[i].reset(image.clone());
+        }
+        if (steps[first + i].branch->writesToStandardOutput()) {
+            standardOutputs++;
+        }
+    }
+
+    std::vector<std::exception_ptr> errors(count);
+    auto runBranch = [&](std::size_t i) {
+        try {
+            const Pipeline & branch = *steps[first + i].branch;
+            branch.execute(copies[i] != nullptr ? *copies[i] : image, inputPath, index, 0, branch.steps.size(),
+                           nullptr, region, regionSet);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+        copies[i].reset();
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i + 1 < count; i++) {
+        if (standardOutputs <= 1) {
+            threads.emplace_back(runBranch, i);
+        } else {
+            runBranch(i);
+        }
+    }
+    runBranch(count - 1);
+    for (std::thread & thread : threads) {
+        thread.join();
+    }
+
+    for (const std::exception_ptr & error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+std::size_t Pipeline::getOutputStart() const {
+    std::size_t start = steps.size();
+    while (start > 0 && (steps[start - 1].argument == OUTPUT || steps[start - 1].argument == REGION)) {
+        start--;
+    }
+
+    return start;
+}
+
+const std::vector<Pipeline::Step> & Pipeline::getSteps() const {
+    return steps;
+}
+
+bool Pipeline::isHelpRequested() const {
+    return helpRequested;
+}
+
+std::vector<std::string> Pipeline::getOutputPaths() const {
+    std::vector<std::string> paths;
+    for (const Step & step : steps) {
+        if (step.argument == OUTPUT) {
+            paths.push_back(step.path);
+        } else if (step.argument == BRANCH) {
+            std::vector<std::string> branchPaths = step.branch->getOutputPaths();
+            paths.insert(paths.end(), branchPaths.begin(), branchPaths.end());
+        }
+    }
+
+    return paths;
+}
+
+std::vector<std::string> Pipeline::getStatisticsPaths() const {
+    std::vector<std::string> paths;
+    for (const Step & step : steps) {
+        if (step.argument == COMPONENTS && !step.path.empty()) {
+            paths.push_back(step.path);
+        } else if (step.argument == BRANCH) {
+            std::vector<std::string> branchPaths = step.branch->getStatisticsPaths();
+            paths.insert(paths.end(), branchPaths.begin(), branchPaths.end());
+        }
+    }
+
+    return paths;
+}
+
+bool Pipeline::writesToStandardOutput() const {
+    for (const std::string & path : getOutputPaths()) {
+        if (path == STANDARD_STREAM) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Pipeline::hasUniqueOutputs() const {
+    std::vector<std::string> paths = getOutputPaths();
+    std::vector<std::string> statisticsPaths = getStatisticsPaths();
+    paths.insert(paths.end(), statisticsPaths.begin(), statisticsPaths.end());
+    for (const std::string & path : paths) {
+        if (path.find("{name}") == std::string::npos && path.find("{index}") == std::string::npos) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string Pipeline::expandOutputPath(const std::string & pattern, const std::string & inputPath, int index) {
+    std::size_t slash = inputPath.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : inputPath.substr(0, slash);
+    std::string fileName = slash == std::string::npos ? inputPath : inputPath.substr(slash + 1);
+
+    std::size_t dot = fileName.find_last_of('.');
+    std::string name = dot == std::string::npos ? fileName : fileName.substr(0, dot);
+    std::string extension = dot == std::string::npos ? "" : fileName.substr(dot + 1);
+
+    std::string path;
+    for (std::size_t i = 0; i < pattern.size(); i++) {
+        if (pattern.compare(i, 6, "{name}") == 0) {
+            path += name;
+            i += 5;
+        } else if (pattern.compare(i, 5, "{ext}") == 0) {
+            path += extension;
+            i += 4;
+        } else if (pattern.compare(i, 5, "{dir}") == 0) {
+            path += directory;
+            i += 4;
+        } else if (pattern.compare(i, 7, "{index}") == 0) {
+            path += std::to_string(index);
+            i += 6;
+        } else {
+            path += pattern[i];
+        }
+    }
+
+    return path;
+}
+
+bool Pipeline::isParameter(const std::string & toValidate) {
+    return !toValidate.empty() && toValidate[0] != '-';
+}
+
+Pipeline::Arguments Pipeline::stringToArgument(const std::string & argument) {
+    if (argument == "-o") return OUTPUT;
+    if (argument == "-rs") return RESOLUTION_CHANGE;
+    if (argument == "-n") return NEGATIVE;
+    if (argument == "-eq") return EQUALIZE;
+    if (argument == "-cs") return STRETCH;
+    if (argument == "-b") return BLUR;
+    if (argument == "-dn") return DENOISE;
+    if (argument == "-g") return GRADIENT;
+    if (argument == "-ib") return BINARY;
+    if (argument == "-e") return ERODE;
+    if (argument == "-d") return DILATE;
+    if (argument == "-m") return MORPHOLOGY;
+    if (argument == "-cc") return COMPONENTS;
+    if (argument == "-r") return ROTATE;
+    if (argument == "-f") return FILTER;
+    if (argument == "-k") return KERNEL;
+    if (argument == "-roi") return REGION;
+    if (argument == "{") return BRANCH;
+    if (argument == "-h") return HELP;
+
+    return INVALID;
+}
+
+int Pipeline::parseInt(const std::vector<std::string> & arguments, std::size_t index) {
+    if (index >= arguments.size() || !isParameter(arguments[index])) {
+        throw MissingArgumentParameter();
+    }
+
+    try {
+        return std::stoi(arguments[index]);
+    } catch (std::exception &exception) {
+        throw WrongArgumentParameter();
+    }
+}
+
+int Pipeline::parseOptionalInt(const std::vector<std::string> & arguments, std::size_t & argNum, int defaultValue) {
+    if (argNum + 1 >= arguments.size() || arguments[argNum + 1].empty() ||
+        arguments[argNum + 1].find_first_not_of("0123456789") != std::string::npos) {
+        return defaultValue;
+    }
+
+    return parseInt(arguments, ++argNum);
+}
+
+bool Pipeline::stringToAdaptiveMethod(const std::string & name, AdaptiveThreshold::Method & method) {
+    if (name == "bradley") {
+        method = AdaptiveThreshold::BRADLEY;
+    } else if (name == "sauvola") {
+        method = AdaptiveThreshold::SAUVOLA;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool Pipeline::stringToThresholdMethod(const std::string & name, ImageProcessing::ThresholdMethod & method) {
+    if (name == "auto" || name == "otsu") {
+        method = ImageProcessing::OTSU;
+    } else if (name == "triangle") {
+        method = ImageProcessing::TRIANGLE;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+ImageProcessing::Filter Pipeline::stringToFilter(const std::string & name) {
+    if (name == "sharpen") return ImageProcessing::SHARPEN;
+    if (name == "emboss") return ImageProcessing::EMBOSS;
+    if (name == "laplacian") return ImageProcessing::LAPLACIAN;
+    if (name == "sobel") return ImageProcessing::SOBEL;
+    if (name == "scharr") return ImageProcessing::SCHARR;
+    if (name == "prewitt") return ImageProcessing::PREWITT;
+
+    throw UnsupportedTypeParameter();
+}
+
+Morphology::Operation Pipeline::stringToMorphology(const std::string & name) {
+    if (name == "open") return Morphology::OPENING;
+    if (name == "close") return Morphology::CLOSING;
+    if (name == "tophat") return Morphology::TOP_HAT;
+    if (name == "blackhat") return Morphology::BLACK_HAT;
+    if (name == "gradient") return Morphology::GRADIENT;
+
+    throw UnsupportedTypeParameter();
+}
+
+Convolution::Border Pipeline::parseBorder(const std::vector<std::string> & arguments, std::size_t & argNum) {
+    Convolution::Border border{Convolution::CLAMP, 0};
+    if (argNum + 1 >= arguments.size() ||
+        (arguments[argNum + 1] != "clamp" && arguments[argNum + 1] != "reflect" &&
+         arguments[argNum + 1] != "constant")) {
+        return border;
+    }
+
+    border.type = Convolution::parseBorderType(arguments[++argNum]);
+    if (border.type == Convolution::CONSTANT) {
+        int value = parseInt(arguments, ++argNum);
+        if (value < 0 || value > 255) {
+            throw WrongArgumentParameter();
+        }
+        border.value = (uint8_t) value;
+    }
+
+    return border;
+}
@@ -0,0 +1,261 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <sys/resource.h>
+#include <unistd.h>
+
+std::atomic<bool> Profiler::countingAllocations(false);
+std::atomic<uint64_t> Profiler::allocatedBytes(0);
+std::atomic<uint64_t> Profiler::allocations(0);
+
+Profiler::Profiler(bool enabled, bool hardwareCounters) : enabled(enabled),
+                                                          created(std::chrono::steady_clock::now()) {
+    if (enabled) {
+        countingAllocations = true;
+    }
+    if (enabled && hardwareCounters) {
+        perfCounters.reset(new PerfCounters());
+    }
+}
+
+Profiler::~Profiler() {
+    stopSampling();
+    if (enabled) {
+        countingAllocations = false;
+    }
+}
+
+void Profiler::countAllocation(std::size_t size) {
+    if (countingAllocations.load(std::memory_order_relaxed)) {
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::begin(const std::string & name) {
+    if (!enabled) {
+        return;
+    }
+
+    // the sampler is started first, so its allocations are not counted to the stage
+    startSampling();
+    current = Stage{};
+    current.name = name;
+    current.allocatedBytes = allocatedBytes;
+    current.allocations = allocations;
+    current.cpuTime = getCpuTime();
+    if (perfCounters) {
+        current.counters = perfCounters->read();
+    }
+    current.start = now();
+    running = true;
+}
+
+void Profiler::end(const std::string & name) {
+    if (!enabled || !running) {
+        return;
+    }
+
+    current.duration = now() - current.start;
+    if (perfCounters) {
+        current.counters = perfCounters->read() - current.counters;
+    }
+    current.cpuTime = getCpuTime() - current.cpuTime;
+    current.allocatedBytes = allocatedBytes - current.allocatedBytes;
+    current.allocations = allocations - current.allocations;
+    current.threads = stopSampling();
+    if (current.threads > 1) {
+        // the counters of the calling thread would describe only its part of the stage (or its waiting)
+        current.counters = PerfCounters::Values{};
+    }
+    if (!name.empty()) {
+        current.name = name;
+    }
+
+    stages.push_back(current);
+    running = false;
+}
+
+void Profiler::setPixels(uint64_t pixels) {
+    current.pixels = pixels;
+}
+
+bool Profiler::isEnabled() const {
+    return enabled;
+}
+
+const std::vector<Profiler::Stage> & Profiler::getStages() const {
+    return stages;
+}
+
+/**
+ * Prints the value or n/a if it's negative (can't be calculated).
+ */
+static void printMetric(std::ostream & stream, int width, double value) {
+    if (value < 0) {
+        stream << std::setw(width) << "n/a";
+    } else {
+        stream << std::setw(width) << value;
+    }
+}
+
+void Profiler::printSummary(std::ostream & stream) const {
+    int64_t total = 0;
+    for (const Stage & stage : stages) {
+        total += stage.duration;
+    }
+
+    if (perfCounters && !perfCounters->getErrorMessage().empty()) {
+        stream << "Hardware counters are not fully available - " << perfCounters->getErrorMessage() << std::endl;
+    }
+
+    stream << std::left << std::setw(28) << "stage"
+           << std::right << std::setw(12) << "wall ms" << std::setw(8) << "%"
+           << std::setw(12) << "cpu ms" << std::setw(9) << "threads"
+           << std::setw(14) << "alloc MB" << std::setw(10) << "allocs" << std::setw(10) << "MP/s";
+    if (perfCounters) {
+        stream << std::setw(8) << "IPC" << std::setw(11) << "cache-m %" << std::setw(12) << "branch-m %"
+               << std::setw(12) << "mem GB/s*";
+    }
+    stream << std::endl;
+
+    for (const Stage & stage : stages) {
+        double seconds = stage.duration / 1e9;
+
+        stream << std::left << std::setw(28) << stage.name.substr(0, 27)
+               << std::right << std::fixed << std::setprecision(3)
+               << std::setw(12) << stage.duration / 1e6
+               << std::setw(8) << std::setprecision(1) << (total > 0 ? 100.0 * stage.duration / total : 0.0)
+               << std::setw(12) << std::setprecision(3) << stage.cpuTime / 1e6
+               << std::setw(9) << stage.threads
+               << std::setw(14) << stage.allocatedBytes / (1024.0 * 1024.0)
+               << std::setw(10) << stage.allocations << std::setprecision(2);
+        printMetric(stream, 10, stage.pixels > 0 && seconds > 0 ? stage.pixels / 1e6 / seconds : -1);
+        if (perfCounters) {
+            printMetric(stream, 8, stage.counters.getIpc());
+            printMetric(stream, 11, stage.counters.getCacheMissRate());
+            printMetric(stream, 12, stage.counters.getBranchMissRate());
+            printMetric(stream, 12, stage.counters.getMemoryBandwidth(seconds));
+        }
+        stream << std::endl;
+    }
+
+    stream << std::left << std::setw(28) << "total"
+           << std::right << std::setw(12) << std::setprecision(3) << total / 1e6 << std::endl;
+    if (perfCounters) {
+        stream << "* estimated from the last level cache misses (64 bytes per miss)" << std::endl;
+    }
+}
+
+/**
+ * Every stage is saved as the complete ("X") event, the other measurements are passed in args.
+ */
+void Profiler::saveTrace(const std::string & path) const {
+    std::ofstream file(path);
+    if (!file) {
+        throw TraceSaveException();
+    }
+
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+    for (std::size_t i = 0; i < stages.size(); i++) {
+        const Stage & stage = stages[i];
+
+        std::string name;
+        for (char sign : stage.name) {
+            if (sign == '"' || sign == '\\') {
+                name += '\\';
+            }
+            name += sign;
+        }
+
+        file << std::fixed << std::setprecision(3)
+             << "  {\"name\": \"" << name << "\", \"cat\": \"imgm\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1"
+             << ", \"ts\": " << stage.start / 1e3 << ", \"dur\": " << stage.duration / 1e3
+             << ", \"args\": {\"cpu_ms\": " << stage.cpuTime / 1e6
+             << ", \"threads\": " << stage.threads
+             << ", \"allocated_bytes\": " << stage.allocatedBytes
+             << ", \"allocations\": " << stage.allocations
+             << ", \"pixels\": " << stage.pixels;
+        for (int counter = 0; counter < PerfCounters::COUNTERS_COUNT; counter++) {
+            if (stage.counters.available[counter]) {
+                file << ", \"" << PerfCounters::getName((PerfCounters::Counter) counter) << "\": "
+                     << stage.counters.values[counter];
+            }
+        }
+        file << "}}"
+             << (i + 1 < stages.size() ? "," : "") << std::endl;
+    }
+    file << "]}" << std::endl;
+
+    if (!file) {
+        throw TraceSaveException();
+    }
+}
+
+int64_t Profiler::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - created).count();
+}
+
+int64_t Profiler::getCpuTime() {
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * (int64_t) 1000000000 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * (int64_t) 1000;
+}
+
+/**
+ * The sampler checks the threads every millisecond, so the threads started and joined inside the stage are seen too.
+ */
+void Profiler::startSampling() {
+    stopSampling();
+    sampling = true;
+    sampledThreads = getThreadCount();
+    sampler = std::thread([this] {
+        std::unique_lock<std::mutex> lock(samplerMutex);
+        while (!samplerStopped.wait_for(lock, std::chrono::milliseconds(1), [this] { return !sampling; })) {
+            // the sampler itself is not counted
+            sampledThreads = std::max(sampledThreads.load(), getThreadCount() - 1);
+        }
+    });
+}
+
+int Profiler::stopSampling() {
+    if (!sampler.joinable()) {
+        return sampledThreads;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(samplerMutex);
+        sampling = false;
+    }
+    samplerStopped.notify_all();
+    sampler.join();
+
+    return std::max(sampledThreads.load(), getThreadCount());
+}
+
+/**
+ * The status is read without any allocation, so the sampler doesn't change the allocations of the stage.
+ */
+int Profiler::getThreadCount() {
+    char status[4096];
+    int file = open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+    if (file < 0) {
+        return 1;
+    }
+    ssize_t size = ::read(file, status, sizeof(status) - 1);
+    close(file);
+    if (size <= 0) {
+        return 1;
+    }
+    status[size] = '\0';
+
+    const char * line = std::strstr(status, "\nThreads:");
+    return line != nullptr ? std::max(std::atoi(line + 9), 1) : 1;
+}
@@ -0,0 +1,637 @@
+#include "RasterImage.h"
+#include "DistanceTransform.h"
+#include "PixelEngine.h"
+#include "Simd.h"
+
+/**
+ * Weights of the blur, row by row - the bottom left neighbour is counted twice and the bottom right is skipped.
+ */
+static const int BLUR_WEIGHTS[9] = {1, 1, 1, 1, 1, 1, 2, 1, 0};
+
+static bool contains(const ImageProcessing::Region & outer, const ImageProcessing::Region & inner) {
+    return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+// kernels of the filters, row by row from the top - the bottom-up images use the kernels flipped upside down
+using SharpenKernel = Convolution::Kernel<3, 0, -1, 0, -1, 5, -1, 0, -1, 0>;
+using EmbossKernel = Convolution::Kernel<3, -2, -1, 0, -1, 1, 1, 0, 1, 2>;
+using EmbossFlippedKernel = Convolution::Kernel<3, 0, 1, 2, -1, 1, 1, -2, -1, 0>;
+using LaplacianKernel = Convolution::Kernel<3, 0, 1, 0, 1, -4, 1, 0, 1, 0>;
+using SobelXKernel = Convolution::Kernel<3, -1, 0, 1, -2, 0, 2, -1, 0, 1>;
+using SobelYKernel = Convolution::Kernel<3, -1, -2, -1, 0, 0, 0, 1, 2, 1>;
+using ScharrXKernel = Convolution::Kernel<3, -3, 0, 3, -10, 0, 10, -3, 0, 3>;
+using ScharrYKernel = Convolution::Kernel<3, -3, -10, -3, 0, 0, 0, 3, 10, 3>;
+using PrewittXKernel = Convolution::Kernel<3, -1, 0, 1, -1, 0, 1, -1, 0, 1>;
+using PrewittYKernel = Convolution::Kernel<3, -1, -1, -1, 0, 0, 0, 1, 1, 1>;
+
+RasterImage::RasterImage(int channels, int planes, int planeChannels, bool bottomUp)
+        : PixelManager(), channels(channels), planes(planes), planeChannels(planeChannels), bottomUp(bottomUp) {}
+
+RasterImage::RasterImage(const RasterImage & other)
+        : Image(other), PixelManager(other), width(other.width), height(other.height), maxValue(other.maxValue),
+          binaryRegion(other.binaryRegion), channels(other.channels), planes(other.planes),
+          planeChannels(other.planeChannels), bottomUp(other.bottomUp) {}
+
+std::size_t RasterImage::getBytesPerPixel() const {
+    return (std::size_t) this->planes * this->planeChannels;
+}
+
+int RasterImage::getPlaneChannels() const {
+    return this->planeChannels;
+}
+
+std::size_t RasterImage::getChannelOffset(int channel, int imageWidth, int imageHeight) const {
+    return this->planes > 1 ? channel * countPixels(imageWidth, imageHeight) : (std::size_t) channel;
+}
+
+uint8_t * RasterImage::allocateBytes(int imageWidth, int imageHeight) const {
+    std::size_t count = countPixels(imageWidth, imageHeight);
+    if (count > SIZE_MAX / this->getBytesPerPixel()) {
+        throw AllocationSizeException();
+    }
+
+    return static_cast<uint8_t *>(BufferPool::acquire(count * this->getBytesPerPixel()));
+}
+
+void RasterImage::forEachPlane(uint8_t * destination,
+                               const std::function<void(const uint8_t *, uint8_t *)> & operation) const {
+    std::size_t planeSize = countPixels(this->width, this->height) * this->planeChannels;
+    for (int plane = 0; plane < this->planes; plane++) {
+        operation(this->getPixels() + plane * planeSize, destination + plane * planeSize);
+    }
+}
+
+void RasterImage::setBinary(bool binary) {
+    this->binaryRegion = binary ? Region{0, 0, this->width, this->height} : Region{0, 0, 0, 0};
+}
+
+bool RasterImage::isBinary() const {
+    return contains(this->binaryRegion, Region{0, 0, this->width, this->height});
+}
+
+int RasterImage::getWidth() const {
+    return this->width;
+}
+
+int RasterImage::getHeight() const {
+    return this->height;
+}
+
+/**
+ * Runs the operation on the copy of the region and puts the result back in place.
+ * Every plane is copied as the rectangle of bytes, the region is flipped first if the rows are stored bottom-up.
+ * The region is binary if it's inside the binary region of the image. If the operation thresholds it, it becomes
+ * the binary region of the image (only one rectangle is kept), if the operation changes it from binary,
+ * no part of the image is binary anymore.
+ */
+void RasterImage::processRegion(const Region & region, const std::function<void()> & operation) {
+    int imageWidth = this->width;
+    int imageHeight = this->height;
+
+    if (region.width <= 0 || region.height <= 0 || region.x < 0 || region.y < 0 ||
+        region.width > imageWidth - region.x || region.height > imageHeight - region.y) {
+        throw RegionOutOfBoundsException();
+    }
+
+    int arrayY = this->bottomUp ? imageHeight - region.y - region.height : region.y;
+    int rowValues = this->planeChannels;
+    std::size_t planeSize = countPixels(imageWidth, imageHeight) * rowValues;
+    std::size_t regionPlaneSize = countPixels(region.width, region.height) * rowValues;
+    uint8_t * regionPixels = allocateBytes(region.width, region.height);
+    for (int plane = 0; plane < this->planes; plane++) {
+        copyRectangle(this->getPixels() + plane * planeSize, imageWidth * rowValues, region.x * rowValues, arrayY,
+                      regionPixels + plane * regionPlaneSize, region.width * rowValues, 0, 0,
+                      region.width * rowValues, region.height);
+    }
+
+    uint8_t * image = this->takePixels();
+    this->setPixels(regionPixels);
+    this->width = region.width;
+    this->height = region.height;
+    Region imageBinaryRegion = this->binaryRegion;
+    bool regionWasBinary = contains(imageBinaryRegion, region);
+    setBinary(regionWasBinary);
+
+    bool sizeChanged;
+    bool regionIsBinary;
+    try {
+        operation();
+        sizeChanged = this->width != region.width || this->height != region.height;
+        regionIsBinary = this->isBinary();
+    } catch (...) {
+        this->setPixels(image);
+        this->width = imageWidth;
+        this->height = imageHeight;
+        this->binaryRegion = imageBinaryRegion;
+        throw;
+    }
+
+    if (!sizeChanged) {
+        for (int plane = 0; plane < this->planes; plane++) {
+            copyRectangle(this->getPixels() + plane * regionPlaneSize, region.width * rowValues, 0, 0,
+                          image + plane * planeSize, imageWidth * rowValues, region.x * rowValues, arrayY,
+                          region.width * rowValues, region.height);
+        }
+    }
+
+    this->setPixels(image);
+    this->width = imageWidth;
+    this->height = imageHeight;
+    if (sizeChanged || regionIsBinary == regionWasBinary) {
+        this->binaryRegion = imageBinaryRegion;
+    } else {
+        this->binaryRegion = regionIsBinary ? region : Region{0, 0, 0, 0};
+    }
+
+    if (sizeChanged) {
+        throw RegionSizeChangedException();
+    }
+}
+
+/**
+ * Applies blur filter (average filter) to the image.
+ * It skips the border pixels.
+ */
+void RasterImage::blur() {
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    forEachPlane(modifiedImg, [this](const uint8_t * source, uint8_t * destination) {
+        Simd::convolve3x3(source, destination, this->width, this->height, this->planeChannels, BLUR_WEIGHTS, 9);
+    });
+    this->setPixels(modifiedImg);
+}
+
+/**
+ * The interleaved BGR pixels use the vector kernels, the other layouts are converted channel by channel.
+ */
+void RasterImage::toGrayscale() {
+    if (this->channels == 1) {
+        return;
+    }
+
+    std::size_t size = countPixels(this->width, this->height);
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+
+    if (this->planes == 1 && this->planeChannels == 3) {
+        BufferPool::TemporaryBuffer gray(size);
+        Simd::bgrToGray(this->getPixels(), gray.get(), size);
+        Simd::grayToBgr(gray.get(), modifiedImg, size);
+    } else {
+        std::size_t step = this->planeChannels;
+        const uint8_t * blue = this->getPixels() + getChannelOffset(0, this->width, this->height);
+        const uint8_t * green = this->getPixels() + getChannelOffset(1, this->width, this->height);
+        const uint8_t * red = this->getPixels() + getChannelOffset(2, this->width, this->height);
+        uint8_t * modifiedBlue = modifiedImg + getChannelOffset(0, this->width, this->height);
+        uint8_t * modifiedGreen = modifiedImg + getChannelOffset(1, this->width, this->height);
+        uint8_t * modifiedRed = modifiedImg + getChannelOffset(2, this->width, this->height);
+
+        for (std::size_t i = 0; i < size; i++) {
+            std::size_t index = i * step;
+            auto gray = (uint8_t) (red[index] / 3 + green[index] / 3 + blue[index] / 3);
+            modifiedBlue[index] = modifiedGreen[index] = modifiedRed[index] = gray;
+        }
+
+        // the padding is kept zeroed
+        for (int padding = 3; padding < this->planeChannels; padding++) {
+            for (std::size_t i = 0; i < size; i++) {
+                modifiedImg[i * step + padding] = 0;
+            }
+        }
+    }
+
+    this->setPixels(modifiedImg);
+}
+
+/**
+ * Creating a binary image using threshold given by the parameter.
+ */
+void RasterImage::toBinary(int threshold) {
+    // create grayscale image, it will be easier to work with it
+    toGrayscale();
+    applyThreshold(threshold);
+}
+
+/**
+ * The threshold is computed from the grayscale image that is then compared with it (the conversion isn't repeated,
+ * the gray values would be rounded down to the multiples of 3).
+ */
+void RasterImage::toBinary(ThresholdMethod method) {
+    toGrayscale();
+
+    Histogram histogram = getHistogram(0);
+    applyThreshold(method == TRIANGLE ? histogram.getTriangleThreshold() : histogram.getOtsuThreshold());
+}
+
+/**
+ * The mask of the single channel is copied to every colour channel, the padding is kept zeroed.
+ */
+void RasterImage::toBinary(AdaptiveThreshold::Method method, int radius, int percent) {
+    toGrayscale();
+
+    std::size_t size = countPixels(this->width, this->height);
+    BufferPool::TemporaryBuffer mask(size);
+    AdaptiveThreshold::apply(this->getPixels(), this->planeChannels, mask.get(), this->width, this->height, method,
+                             radius, percent, this->maxValue);
+
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    if (this->planeChannels == 1) {
+        for (int channel = 0; channel < this->channels; channel++) {
+            std::copy(mask.get(), mask.get() + size,
+                      modifiedImg + getChannelOffset(channel, this->width, this->height));
+        }
+    } else if (this->planeChannels == 3) {
+        Simd::grayToBgr(mask.get(), modifiedImg, size);
+    } else {
+        for (std::size_t i = 0; i < size; i++) {
+            for (int channel = 0; channel < this->planeChannels; channel++) {
+                modifiedImg[i * this->planeChannels + channel] = channel < 3 ? mask.get()[i] : 0;
+            }
+        }
+    }
+    this->setPixels(modifiedImg);
+    setBinary(true);
+}
+
+void RasterImage::applyThreshold(int threshold) {
+    // all the channels are the same, so they are compared at once
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    Simd::threshold(this->getPixels(), modifiedImg, this->getBytesPerPixel() * countPixels(this->width, this->height),
+                    threshold, 0, this->maxValue);
+    this->setPixels(modifiedImg);
+    setBinary(true);
+}
+
+Histogram RasterImage::getHistogram(int channel) const {
+    return Histogram::compute(this->getPixels() + getChannelOffset(channel, this->width, this->height),
+                              countPixels(this->width, this->height), this->planeChannels);
+}
+
+/**
+ * The pixel is set to 0 if there is any 0 in its window.
+ */
+void RasterImage::erode() {
+    if (!this->isBinary()) {
+        throw NotInBinaryFormatException();
+    }
+
+    spreadPixels(0, ERODE_RADIUS, false);
+}
+
+/**
+ * The pixel is set to maxValue if there is any maxValue in its window.
+ */
+void RasterImage::dilate() {
+    if (!this->isBinary()) {
+        throw NotInBinaryFormatException();
+    }
+
+    spreadPixels(this->maxValue, DILATE_RADIUS, false);
+}
+
+void RasterImage::erodeDisk(int radius) {
+    if (!this->isBinary()) {
+        throw NotInBinaryFormatException();
+    }
+
+    spreadPixels(0, radius, true);
+}
+
+void RasterImage::dilateDisk(int radius) {
+    if (!this->isBinary()) {
+        throw NotInBinaryFormatException();
+    }
+
+    spreadPixels(this->maxValue, radius, true);
+}
+
+/**
+ * The masks of the pixels are repeated for every colour channel, the padding is not changed by any operation.
+ */
+void RasterImage::morphology(Morphology::Operation operation) {
+    if (!this->isBinary()) {
+        throw NotInBinaryFormatException();
+    }
+
+    Morphology::Spread erosion{0, ERODE_RADIUS};
+    Morphology::Spread dilation{this->maxValue, DILATE_RADIUS};
+    const Morphology::Spread & first = Morphology::startsWithDilate(operation) ? dilation : erosion;
+    const Morphology::Spread & second = Morphology::startsWithDilate(operation) ? erosion : dilation;
+
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    std::size_t planeSize = countPixels(this->width, this->height) * this->planeChannels;
+    auto match = [this](uint8_t value, std::size_t firstPixel, std::size_t count, uint8_t * mask) {
+        matchValue(value, firstPixel, count, mask);
+    };
+    auto write = [&](std::size_t firstPixel, std::size_t count, const uint8_t * firstMask,
+                     const uint8_t * secondMask) {
+        if (this->planeChannels == 1) {
+            for (int plane = 0; plane < this->planes; plane++) {
+                std::size_t offset = plane * planeSize + firstPixel;
+                Morphology::combine(operation, this->getPixels() + offset, firstMask, secondMask,
+                                    modifiedImg + offset, count, first, second);
+            }
+            return;
+        }
+
+        std::size_t values = count * this->planeChannels;
+        BufferPool::TemporaryBuffer firstChannels(values);
+        BufferPool::TemporaryBuffer secondChannels(values);
+        if (this->planeChannels == 3) {
+            Simd::grayToBgr(firstMask, firstChannels.get(), count);
+            Simd::grayToBgr(secondMask, secondChannels.get(), count);
+        } else {
+            for (std::size_t i = 0; i < values; i++) {
+                bool colour = (int) (i % this->planeChannels) < 3;
+                firstChannels.get()[i] = colour ? firstMask[i / this->planeChannels] : 0;
+                secondChannels.get()[i] = colour ? secondMask[i / this->planeChannels] : 0;
+            }
+        }
+        std::size_t offset = firstPixel * this->planeChannels;
+        Morphology::combine(operation, this->getPixels() + offset, firstChannels.get(), secondChannels.get(),
+                            modifiedImg + offset, values, first, second);
+    };
+
+    Morphology::apply(this->width, this->height, first, second, Morphology::isChained(operation), match, write);
+    this->setPixels(modifiedImg);
+}
+
+/**
+ * The single channel and the interleaved BGR pixels use the vector kernels (value - pixel is 0 only for the value).
+ */
+void RasterImage::matchValue(uint8_t value, std::size_t first, std::size_t count, uint8_t * mask) const {
+    if (this->channels == 1) {
+        const uint8_t * differences = this->getPixels() + first;
+        if (value != 0) {
+            Simd::invert(this->getPixels() + first, mask, count, value);
+            differences = mask;
+        }
+        Simd::threshold(differences, mask, count, 0, 255, 0);
+    } else if (this->planes == 1 && this->planeChannels == 3) {
+        Simd::matchBgr(this->getPixels() + 3 * first, mask, count, value);
+    } else {
+        std::size_t step = this->planeChannels;
+        const uint8_t * blue = this->getPixels() + getChannelOffset(0, this->width, this->height) + first * step;
+        const uint8_t * green = this->getPixels() + getChannelOffset(1, this->width, this->height) + first * step;
+        const uint8_t * red = this->getPixels() + getChannelOffset(2, this->width, this->height) + first * step;
+
+        for (std::size_t i = 0; i < count; i++) {
+            bool match = blue[i * step] == value && green[i * step] == value && red[i * step] == value;
+            mask[i] = match ? 255 : 0;
+        }
+    }
+}
+
+/**
+ * The mask of the pixels with the value is spread by the maximum filter (or by the distance to the nearest pixel
+ * with the value) and the value is selected in every channel where the mask is set.
+ */
+void RasterImage::spreadPixels(uint8_t value, int radius, bool disk) {
+    std::size_t size = countPixels(this->width, this->height);
+
+    BufferPool::TemporaryBuffer matches(size);
+    BufferPool::TemporaryBuffer toSet(size);
+    matchValue(value, 0, size, matches.get());
+    if (disk) {
+        DistanceTransform::spread(matches.get(), toSet.get(), this->width, this->height, radius);
+    } else {
+        Simd::maxFilter(matches.get(), toSet.get(), this->width, this->height, radius);
+    }
+
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    if (this->planeChannels == 1) {
+        forEachPlane(modifiedImg, [&toSet, size, value](const uint8_t * source, uint8_t * destination) {
+            Simd::select(source, toSet.get(), destination, size, value);
+        });
+    } else if (this->planeChannels == 3) {
+        BufferPool::TemporaryBuffer toSetChannels(3 * size);
+        Simd::grayToBgr(toSet.get(), toSetChannels.get(), size);
+        Simd::select(this->getPixels(), toSetChannels.get(), modifiedImg, 3 * size, value);
+    } else {
+        for (std::size_t i = 0; i < size; i++) {
+            for (int channel = 0; channel < this->planeChannels; channel++) {
+                std::size_t index = i * this->planeChannels + channel;
+                modifiedImg[index] = toSet.get()[i] != 0 && channel < 3 ? value : this->getPixels()[index];
+            }
+        }
+    }
+    this->setPixels(modifiedImg);
+}
+
+/**
+ * The labels are computed for the rows from the top (the bottom-up array is passed from its last row), so the labels
+ * and the statistics don't depend on the format. The colour of the label is its hash, every channel is 1 - maxValue.
+ */
+std::vector<ConnectedComponents::Component> RasterImage::labelComponents(
+        ConnectedComponents::Connectivity connectivity) {
+    if (!this->isBinary()) {
+        throw NotInBinaryFormatException();
+    }
+
+    std::size_t size = countPixels(this->width, this->height);
+    BufferPool::TemporaryBuffer mask(size);
+    BufferPool::TemporaryBuffer labelBuffer(size * sizeof(uint32_t));
+    auto * labels = reinterpret_cast<uint32_t *>(labelBuffer.get());
+    matchValue(this->maxValue, 0, size, mask.get());
+
+    std::size_t topRow = this->bottomUp ? (std::size_t) (this->height - 1) * this->width : 0;
+    std::ptrdiff_t rowStep = this->bottomUp ? -(std::ptrdiff_t) this->width : this->width;
+    std::vector<ConnectedComponents::Component> components = ConnectedComponents::label(
+            mask.get() + topRow, labels + topRow, this->width, this->height, rowStep, connectivity);
+
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    std::size_t step = this->planeChannels;
+    for (int channel = 0; channel < this->channels; channel++) {
+        uint8_t * values = modifiedImg + getChannelOffset(channel, this->width, this->height);
+        for (std::size_t i = 0; i < size; i++) {
+            uint32_t hash = labels[i] * 2654435761u >> (24 - 8 * channel);
+            values[i * step] = labels[i] == 0 ? 0 : (uint8_t) (1 + (hash & 0xff) * (this->maxValue - 1) / 255);
+        }
+    }
+    for (int padding = this->channels; padding < this->planeChannels; padding++) {
+        for (std::size_t i = 0; i < size; i++) {
+            modifiedImg[i * step + padding] = 0;
+        }
+    }
+
+    this->setPixels(modifiedImg);
+    setBinary(false);
+    return components;
+}
+
+void RasterImage::toNegative() {
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    Simd::invert(this->getPixels(), modifiedImg, this->getBytesPerPixel() * countPixels(this->width, this->height),
+                 this->maxValue);
+    this->setPixels(modifiedImg);
+}
+
+void RasterImage::equalize() {
+    applyTable(getLuminanceHistogram().getEqualizationTable(this->maxValue));
+}
+
+void RasterImage::stretchContrast(double percent) {
+    applyTable(getLuminanceHistogram().getStretchTable(percent, this->maxValue));
+}
+
+Histogram RasterImage::getLuminanceHistogram() const {
+    if (this->channels == 1) {
+        return getHistogram(0);
+    }
+
+    return Histogram::computeLuminance(this->getPixels() + getChannelOffset(0, this->width, this->height),
+                                       this->getPixels() + getChannelOffset(1, this->width, this->height),
+                                       this->getPixels() + getChannelOffset(2, this->width, this->height),
+                                       countPixels(this->width, this->height), this->planeChannels);
+}
+
+/**
+ * One pass over all the bytes of the image (the vector kernels look up 32 or 64 values at once).
+ */
+void RasterImage::applyTable(const std::array<uint8_t, Histogram::BINS> & table) {
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    Simd::lookup(this->getPixels(), modifiedImg, this->getBytesPerPixel() * countPixels(this->width, this->height),
+                 table.data());
+    this->setPixels(modifiedImg);
+}
+
+void RasterImage::scale(int newWidth, int newHeight) {
+    if (newWidth > this->width || newHeight > this->height) {
+        scaleUp(newWidth, newHeight);
+    } else {
+        scaleDown(newWidth, newHeight);
+    }
+}
+
+void RasterImage::scaleUp(int newWidth, int newHeight) {
+    bool binary = isBinary();
+    std::size_t planeSize = countPixels(this->width, this->height) * this->planeChannels;
+    std::size_t newPlaneSize = countPixels(newWidth, newHeight) * this->planeChannels;
+
+    auto * modifiedImg = allocateBytes(newWidth, newHeight);
+    for (int plane = 0; plane < this->planes; plane++) {
+        forChannels(this->planeChannels, [&](auto engine) {
+            decltype(engine)::scaleUp(this->getPixels() + plane * planeSize, this->width, this->height,
+                                      modifiedImg + plane * newPlaneSize, newWidth, newHeight);
+        });
+    }
+    this->setPixels(modifiedImg);
+
+    this->width = newWidth;
+    this->height = newHeight;
+    setBinary(binary);
+}
+
+void RasterImage::scaleDown(int newWidth, int newHeight) {
+    bool binary = isBinary();
+    std::size_t planeSize = countPixels(this->width, this->height) * this->planeChannels;
+    std::size_t newPlaneSize = countPixels(newWidth, newHeight) * this->planeChannels;
+
+    auto * modifiedImg = allocateBytes(newWidth, newHeight);
+    for (int plane = 0; plane < this->planes; plane++) {
+        forChannels(this->planeChannels, [&](auto engine) {
+            decltype(engine)::scaleDown(this->getPixels() + plane * planeSize, this->width, this->height,
+                                        modifiedImg + plane * newPlaneSize, newWidth, newHeight);
+        });
+    }
+    this->setPixels(modifiedImg);
+
+    this->width = newWidth;
+    this->height = newHeight;
+    setBinary(binary);
+}
+
+/**
+ * Edge filter using the Sobel operator on the grayscale image.
+ */
+void RasterImage::edgeFilter() {
+    toGrayscale();
+
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    forEachPlane(modifiedImg, [this](const uint8_t * source, uint8_t * destination) {
+        forChannels(this->planeChannels, [&](auto engine) {
+            decltype(engine)::edgeFilter(source, destination, this->width, this->height, this->maxValue);
+        });
+    });
+    this->setPixels(modifiedImg);
+}
+
+void RasterImage::filter(Filter filter, const Convolution::Border & border) {
+    if (filter != SHARPEN && filter != EMBOSS) {
+        toGrayscale();
+    }
+
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    forEachPlane(modifiedImg, [&](const uint8_t * source, uint8_t * destination) {
+        int width = this->width, height = this->height, channels = this->planeChannels;
+        uint8_t maxValue = this->maxValue;
+        switch (filter) {
+            case SHARPEN:
+                Convolution::filter<SharpenKernel>(source, destination, width, height, channels, border, 1, 0,
+                                                   maxValue);
+                break;
+            case EMBOSS:
+                if (this->bottomUp) {
+                    Convolution::filter<EmbossFlippedKernel>(source, destination, width, height, channels, border,
+                                                             1, 0, maxValue);
+                } else {
+                    Convolution::filter<EmbossKernel>(source, destination, width, height, channels, border, 1, 0,
+                                                      maxValue);
+                }
+                break;
+            case LAPLACIAN:
+                Convolution::absolute<LaplacianKernel>(source, destination, width, height, channels, border,
+                                                       maxValue);
+                break;
+            case SOBEL:
+                Convolution::gradient<SobelXKernel, SobelYKernel>(source, destination, width, height, channels,
+                                                                  border, 1, maxValue);
+                break;
+            case SCHARR:
+                Convolution::gradient<ScharrXKernel, ScharrYKernel>(source, destination, width, height, channels,
+                                                                    border, 4, maxValue);
+                break;
+            case PREWITT:
+                Convolution::gradient<PrewittXKernel, PrewittYKernel>(source, destination, width, height, channels,
+                                                                      border, 1, maxValue);
+                break;
+        }
+    });
+    this->setPixels(modifiedImg);
+}
+
+void RasterImage::convolve(const Convolution::KernelMatrix & kernel, const Convolution::Border & border) {
+    Convolution::KernelMatrix imageKernel = this->bottomUp ? kernel.flip() : kernel;
+
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    forEachPlane(modifiedImg, [&](const uint8_t * source, uint8_t * destination) {
+        Convolution::filter(imageKernel, source, destination, this->width, this->height, this->planeChannels,
+                            border, this->maxValue);
+    });
+    this->setPixels(modifiedImg);
+}
+
+void RasterImage::denoise(int size) {
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    forEachPlane(modifiedImg, [this, size](const uint8_t * source, uint8_t * destination) {
+        forChannels(this->planeChannels, [&](auto engine) {
+            decltype(engine)::denoise(source, destination, this->width, this->height, size);
+        });
+    });
+    this->setPixels(modifiedImg);
+}
+
+/**
+ * The angle is the same for every format - it's negated for the rows stored bottom-up,
+ * so the image rotates in the same direction when it's displayed.
+ */
+void RasterImage::rotate(float degree) {
+    double arrayDegree = this->bottomUp ? -degree : degree;
+
+    auto * modifiedImg = allocateBytes(this->width, this->height);
+    forEachPlane(modifiedImg, [this, arrayDegree](const uint8_t * source, uint8_t * destination) {
+        forChannels(this->planeChannels, [&](auto engine) {
+            decltype(engine)::rotate(source, destination, this->width, this->height, arrayDegree);
+        });
+    });
+    this->setPixels(modifiedImg);
+}
@@ -0,0 +1,364 @@
+#include "ResultCache.h"
+#include "FrameStream.h"
+#include "ImageFactory.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+// constants of xxHash
+static const uint64_t PRIME_1 = 11400714785074694791ULL;
+static const uint64_t PRIME_2 = 14029467366897019727ULL;
+static const uint64_t PRIME_3 = 1609587929392839161ULL;
+
+static inline uint64_t rotateLeft(uint64_t value, int bits) {
+    return value << bits | value >> (64 - bits);
+}
+
+static inline uint64_t mixLane(uint64_t lane, const uint8_t * data) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return rotateLeft(lane + word * PRIME_2, 31) * PRIME_1;
+}
+
+/**
+ * Final mix of MurmurHash3 - every bit of the value changes about half of the bits of the result.
+ */
+static inline uint64_t avalanche(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    return value ^ value >> 33;
+}
+
+std::string ResultCache::Digest::toString() const {
+    std::ostringstream digits;
+    digits << std::hex << std::setfill('0') << std::setw(16) << this->first << std::setw(16) << this->second;
+    return digits.str();
+}
+
+ResultCache::ResultCache(std::string directory, std::size_t sizeLimit, bool storeStages)
+        : directory(std::move(directory)), sizeLimit(sizeLimit), storeStages(storeStages), size(UNKNOWN_SIZE) {
+    struct stat info{};
+    if (mkdir(this->directory.c_str(), 0755) != 0 &&
+        (errno != EEXIST || stat(this->directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))) {
+        throw CacheDirectoryException();
+    }
+}
+
+bool ResultCache::run(const Pipeline & pipeline, const std::vector<uint8_t> & data, const std::string & inputPath,
+                      unsigned threads, Profiler * profiler) {
+    std::vector<std::string> paths = pipeline.getOutputPaths();
+    std::string canonical = canonicalize(pipeline, pipeline.getSteps().size());
+
+    if (profiler != nullptr) {
+        profiler->begin("cache lookup");
+    }
+    Digest inputDigest = hash(data.data(), data.size());
+    Digest key = hash(reinterpret_cast<const uint8_t *>(canonical.data()), canonical.size(), inputDigest);
+    std::string entryPath = getEntryPath(key.first, ".out");
+    std::string description = describe(data.size(), inputDigest, canonical);
+
+    std::vector<std::vector<uint8_t>> outputs;
+    bool hit = load(entryPath, description, outputs) && !outputs.empty() && outputs.size() % paths.size() == 0;
+    if (profiler != nullptr) {
+        profiler->end();
+    }
+
+    if (hit) {
+        if (profiler != nullptr) {
+            profiler->begin("cache restore");
+        }
+        for (std::size_t i = 0; i < outputs.size(); i++) {
+            std::string path = Pipeline::expandOutputPath(paths[i % paths.size()], inputPath,
+                                                          (int) (i / paths.size()));
+            std::ofstream file(path, std::ios::out | std::ios::binary);
+            file.write(reinterpret_cast<const char *>(outputs[i].data()), (std::streamsize) outputs[i].size());
+            file.close();
+            if (!file) {
+                throw ImageReader::ImageSaveException();
+            }
+        }
+        if (profiler != nullptr) {
+            profiler->end();
+        }
+        return true;
+    }
+
+    std::size_t frames = 1;
+    if (!runImage(pipeline, data, inputPath, inputDigest, profiler)) {
+        MemoryInputStream stream(data.data(), data.size());
+        frames = FrameStream(stream, pipeline, threads).run(inputPath, profiler);
+    }
+
+    // the outputs are read back from the files, the last write wins if more outputs have the same path
+    outputs.clear();
+    for (std::size_t frame = 0; frame < frames; frame++) {
+        for (const std::string & pattern : paths) {
+            std::ifstream file(Pipeline::expandOutputPath(pattern, inputPath, (int) frame), std::ios::binary);
+            if (!file) {
+                return false;
+            }
+            outputs.emplace_back((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        }
+    }
+    store(entryPath, description, outputs);
+
+    return false;
+}
+
+bool ResultCache::runImage(const Pipeline & pipeline, const std::vector<uint8_t> & data,
+                           const std::string & inputPath, const Digest & inputDigest, Profiler * profiler) {
+    std::size_t stages = this->storeStages ? countStages(pipeline) : 0;
+    std::size_t first = 0;
+    std::unique_ptr<Image> image;
+
+    // the longest stored stage, its image is decoded instead of the input
+    for (std::size_t stage = stages; stage > 0 && image == nullptr; stage--) {
+        std::string canonical = canonicalize(pipeline, stage);
+        Digest key = hash(reinterpret_cast<const uint8_t *>(canonical.data()), canonical.size(), inputDigest);
+        std::vector<std::vector<uint8_t>> blobs;
+        if (load(getEntryPath(key.first, ".img"), describe(data.size(), inputDigest, canonical), blobs) &&
+            blobs.size() == 1) {
+            if (profiler != nullptr) {
+                profiler->begin("read stage " + std::to_string(stage));
+            }
+            image.reset(ImageFactory::decode(blobs[0].data(), blobs[0].size()));
+            if (profiler != nullptr) {
+                profiler->end();
+            }
+            first = stage;
+        }
+    }
+
+    if (image == nullptr) {
+        ImageFactory::Format format = ImageFactory::sniffFormat(reinterpret_cast<const char *>(data.data()),
+                                                                data.size());
+        if (format == ImageFactory::UNKNOWN) {
+            throw ImageReader::WrongFileFormatException();
+        }
+
+        if (profiler != nullptr) {
+            profiler->begin("read");
+        }
+        MemoryInputStream stream(data.data(), data.size());
+        image.reset(ImageFactory::create(format, stream));
+        image->read();
+        if (profiler != nullptr) {
+            profiler->setPixels((uint64_t) image->getWidth() * image->getHeight());
+            profiler->end();
+        }
+
+        if (format == ImageFactory::PGM && FrameStream::hasNextFrame(stream)) {
+            return false;
+        }
+    }
+
+    for (std::size_t stepNum = first; stepNum < stages; stepNum++) {
+        pipeline.run(*image, inputPath, 0, stepNum, stepNum + 1, profiler);
+
+        std::string canonical = canonicalize(pipeline, stepNum + 1);
+        Digest key = hash(reinterpret_cast<const uint8_t *>(canonical.data()), canonical.size(), inputDigest);
+        store(getEntryPath(key.first, ".img"), describe(data.size(), inputDigest, canonical), {image->encode()});
+    }
+    pipeline.run(*image, inputPath, 0, std::max(first, stages), pipeline.getSteps().size(), profiler);
+
+    return true;
+}
+
+bool ResultCache::isCacheable(const Pipeline & pipeline) {
+    // the statistics of the components are not stored, so they would be missing after the hit
+    return !pipeline.getOutputPaths().empty() && !pipeline.writesToStandardOutput() &&
+           pipeline.getStatisticsPaths().empty();
+}
+
+/**
+ * The last block is padded with zeros, the size mixed to the result tells the padding from the zero bytes.
+ * The halves of the digest are different combinations of all the lanes.
+ */
+ResultCache::Digest ResultCache::hash(const uint8_t * data, std::size_t size, const Digest & seed) {
+    uint64_t lanes[4] = {seed.first + PRIME_1 + PRIME_2, seed.first + PRIME_2, seed.second, seed.second - PRIME_1};
+    std::size_t blocks = size / sizeof(lanes);
+    for (std::size_t block = 0; block < blocks; block++) {
+        for (int lane = 0; lane < 4; lane++) {
+            lanes[lane] = mixLane(lanes[lane], data + block * sizeof(lanes) + lane * sizeof(uint64_t));
+        }
+    }
+
+    uint8_t last[sizeof(lanes)] = {};
+    if (size > blocks * sizeof(lanes)) {
+        std::memcpy(last, data + blocks * sizeof(lanes), size - blocks * sizeof(lanes));
+    }
+    for (int lane = 0; lane < 4; lane++) {
+        lanes[lane] = mixLane(lanes[lane], last + lane * sizeof(uint64_t));
+    }
+
+    uint64_t first = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) +
+                     rotateLeft(lanes[3], 18);
+    uint64_t second = rotateLeft(lanes[0], 18) * PRIME_3 ^ rotateLeft(lanes[1], 12) * PRIME_2 ^
+                      rotateLeft(lanes[2], 7) * PRIME_1 ^ lanes[3];
+    return Digest{avalanche(first + size), avalanche(second + size * PRIME_3)};
+}
+
+std::string ResultCache::describe(std::size_t inputSize, const Digest & inputDigest, const std::string & canonical) {
+    return std::to_string(inputSize) + " " + inputDigest.toString() + " " + canonical;
+}
+
+std::string ResultCache::canonicalize(const Pipeline & pipeline, std::size_t last) {
+    const std::vector<Pipeline::Step> & steps = pipeline.getSteps();
+    std::ostringstream canonical;
+    canonical << std::setprecision(9);
+
+    for (std::size_t stepNum = 0; stepNum < std::min(last, steps.size()); stepNum++) {
+        const Pipeline::Step & step = steps[stepNum];
+        if (stepNum > 0) {
+            canonical << " ";
+        }
+
+        if (step.argument == Pipeline::BRANCH) {
+            canonical << "{ " << canonicalize(*step.branch, step.branch->getSteps().size()) << " }";
+            continue;
+        }
+
+        canonical << step.name.substr(0, step.name.find(' '));
+        if (step.argument == Pipeline::ROTATE) {
+            canonical << " " << step.degree;
+        } else if (step.argument == Pipeline::REGION && step.wholeImage) {
+            canonical << " all";
+        }
+        for (int value : step.values) {
+            canonical << " " << value;
+        }
+    }
+
+    return canonical.str();
+}
+
+std::size_t ResultCache::countStages(const Pipeline & pipeline) {
+    const std::vector<Pipeline::Step> & steps = pipeline.getSteps();
+    std::size_t count = 0;
+    while (count < steps.size() && steps[count].argument != Pipeline::OUTPUT &&
+           steps[count].argument != Pipeline::BRANCH && steps[count].argument != Pipeline::REGION &&
+           steps[count].argument != Pipeline::BINARY) {
+        count++;
+    }
+
+    return count;
+}
+
+std::string ResultCache::getEntryPath(uint64_t key, const char * extension) const {
+    std::ostringstream path;
+    path << this->directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << extension;
+    return path.str();
+}
+
+/**
+ * Entry: "IMGC <count>\n<description>\n" followed by every blob as "<size>\n<bytes>".
+ */
+bool ResultCache::load(const std::string & path, const std::string & description,
+                       std::vector<std::vector<uint8_t>> & blobs) {
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    std::size_t count = 0;
+    if (!(file >> magic >> count) || magic != "IMGC" || file.get() != '\n') {
+        return false;
+    }
+
+    std::string storedDescription;
+    if (!std::getline(file, storedDescription) || storedDescription != description) {
+        return false;
+    }
+
+    blobs.assign(count, std::vector<uint8_t>());
+    for (std::vector<uint8_t> & blob : blobs) {
+        std::size_t size = 0;
+        if (!(file >> size) || file.get() != '\n') {
+            return false;
+        }
+        blob.resize(size);
+        if (!file.read(reinterpret_cast<char *>(blob.data()), (std::streamsize) size)) {
+            return false;
+        }
+    }
+
+    // the modification time is the time of the last use
+    utime(path.c_str(), nullptr);
+    return true;
+}
+
+/**
+ * The temporary file is unique for every store of the process (the threads can store the same entry at once).
+ * The replaced entry is still counted to the size, so the size is never smaller than the real one.
+ */
+void ResultCache::store(const std::string & path, const std::string & description,
+                        const std::vector<std::vector<uint8_t>> & blobs) {
+    static std::atomic<unsigned> nextTemporary(0);
+    std::string temporaryPath = path + ".tmp" + std::to_string(getpid()) + "." + std::to_string(nextTemporary++);
+    std::ofstream file(temporaryPath, std::ios::out | std::ios::binary);
+    file << "IMGC " << blobs.size() << "\n" << description << "\n";
+    for (const std::vector<uint8_t> & blob : blobs) {
+        file << blob.size() << "\n";
+        file.write(reinterpret_cast<const char *>(blob.data()), (std::streamsize) blob.size());
+    }
+    auto entrySize = (std::size_t) std::max<std::streamoff>(file.tellp(), 0);
+    file.close();
+
+    if (!file || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        return;
+    }
+
+    if (this->size == UNKNOWN_SIZE || (this->size += entrySize) > this->sizeLimit) {
+        evict();
+    }
+}
+
+void ResultCache::evict() {
+    struct Entry {
+        std::string path;
+        std::size_t size;
+        struct timespec used;
+    };
+
+    DIR * cacheDirectory = opendir(this->directory.c_str());
+    if (cacheDirectory == nullptr) {
+        return;
+    }
+
+    std::vector<Entry> entries;
+    std::size_t total = 0;
+    while (dirent * dirEntry = readdir(cacheDirectory)) {
+        std::string name = dirEntry->d_name;
+        if (name.size() != 20 || (name.compare(16, 4, ".out") != 0 && name.compare(16, 4, ".img") != 0)) {
+            continue;
+        }
+
+        struct stat info{};
+        std::string entryPath = this->directory + "/" + name;
+        if (stat(entryPath.c_str(), &info) == 0) {
+            entries.push_back(Entry{entryPath, (std::size_t) info.st_size, info.st_mtim});
+            total += (std::size_t) info.st_size;
+        }
+    }
+    closedir(cacheDirectory);
+
+    std::sort(entries.begin(), entries.end(), [](const Entry & a, const Entry & b) {
+        return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec : a.used.tv_nsec < b.used.tv_nsec;
+    });
+    for (std::size_t i = 0; i < entries.size() && total > this->sizeLimit; i++) {
+        if (std::remove(entries[i].path.c_str()) == 0) {
+            total -= entries[i].size;
+        }
+    }
+    this->size = total;
+}
@@ -0,0 +1,126 @@
+#include "Server.h"
+#include "BufferPool.h"
+#include "ImageFactory.h"
+#include "Pipeline.h"
+
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <memory>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+    stopRequested = 1;
+}
+
+Server::Server(std::string socketPath, unsigned threads)
+        : socketPath(std::move(socketPath)), listening(-1), pool(threads) {
+    this->listening = JobProtocol::listenOn(this->socketPath, 128);
+}
+
+Server::~Server() {
+    close(this->listening);
+    unlink(this->socketPath.c_str());
+}
+
+/**
+ * The socket is polled with the timeout, so the stop request is noticed even if no client connects.
+ */
+void Server::run() {
+    struct sigaction action{};
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    while (!stopRequested) {
+        pollfd waiting{this->listening, POLLIN, 0};
+        if (poll(&waiting, 1, 200) <= 0) {
+            continue;
+        }
+
+        int connection = accept4(this->listening, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection >= 0) {
+            this->pool.submit([connection] { handle(connection); });
+        }
+    }
+
+    this->pool.wait();
+}
+
+void Server::handle(int connection) {
+    BufferPool::enable(BUFFER_POOL_BYTES);
+
+    try {
+        JobProtocol::setTimeout(connection, CONNECTION_TIMEOUT_SECONDS);
+        JobProtocol::Response response = execute(JobProtocol::readRequest(connection));
+        JobProtocol::writeResponse(connection, response);
+    } catch (std::exception &exception) {
+        // the client disconnected or timed out, it's not the imgm client or the inline data is too big,
+        // there is nobody to report to
+    }
+
+    close(connection);
+}
+
+JobProtocol::Response Server::execute(const JobProtocol::Request & request) {
+    JobProtocol::Response response{0, 0, 0, "", ""};
+    const std::vector<std::string> & arguments = request.arguments;
+
+    if (arguments.size() < 2 || arguments[0] != "-i" || !(arguments[1] == "-" || Pipeline::isParameter(arguments[1]))) {
+        response.code = -10;
+        response.step = arguments.empty() ? "" : arguments[0];
+        response.description = "The job needs to start with -i <file> or -i - with the inline data.";
+        return response;
+    }
+
+    const std::string & input = arguments[1];
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        Pipeline pipeline(std::vector<std::string>(arguments.begin() + 2, arguments.end()));
+        if (pipeline.writesToStandardOutput()) {
+            response.code = -10;
+            response.step = "-o -";
+            response.description = "The server can't write to the standard output, the output needs to be a file.";
+            return response;
+        }
+
+        ImageFactory::Format format = input == "-"
+                ? ImageFactory::sniffFormat(request.data.data(), request.data.size())
+                : ImageFactory::detectFormat(input);
+        if (format == ImageFactory::UNKNOWN) {
+            response.code = -1;
+            response.description = ImageFactory::UnsupportedFormatException().what();
+            return response;
+        }
+
+        std::unique_ptr<Image> image;
+        if (input == "-") {
+            image.reset(ImageFactory::decode(reinterpret_cast<const uint8_t *>(request.data.data()),
+                                             request.data.size()));
+        } else {
+            std::fstream file(input, std::ios::in | std::ios::binary);
+            image.reset(ImageFactory::create(format, file));
+            image->read();
+        }
+        auto read = std::chrono::steady_clock::now();
+        response.readSeconds = std::chrono::duration<double>(read - start).count();
+
+        pipeline.run(*image, input);
+        response.processSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - read).count();
+    } catch (Pipeline::StepException &exception) {
+        response.code = -10;
+        response.step = exception.step;
+        response.description = exception.description;
+    } catch (std::exception &exception) {
+        response.code = -11;
+        response.description = exception.what();
+    }
+
+    return response;
+}
@@ -0,0 +1,318 @@
+#include "Simd.h"
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// scalar implementations, they are also used for the ends of the arrays that don't fill the whole vector
+
+static void invertScalar(const uint8_t * source, uint8_t * destination, std::size_t count, uint8_t maxValue) {
+    for (std::size_t i = 0; i < count; i++) {
+        destination[i] = (uint8_t) (maxValue - source[i]);
+    }
+}
+
+static void thresholdScalar(const uint8_t * source, uint8_t * destination, std::size_t count, uint8_t limit,
+                            uint8_t low, uint8_t high) {
+    for (std::size_t i = 0; i < count; i++) {
+        destination[i] = source[i] <= limit ? low : high;
+    }
+}
+
+static void selectScalar(const uint8_t * source, const uint8_t * mask, uint8_t * destination, std::size_t count,
+                         uint8_t value) {
+    for (std::size_t i = 0; i < count; i++) {
+        destination[i] = mask[i] != 0 ? value : source[i];
+    }
+}
+
+static void convolveRowScalar(const uint8_t * above, const uint8_t * row, const uint8_t * below,
+                              uint8_t * destination, std::size_t count, std::size_t step, const int * weights,
+                              int divisor) {
+    const uint8_t * rows[3] = {above, row, below};
+    for (std::size_t i = 0; i < count; i++) {
+        int sum = 0;
+        for (int y = 0; y < 3; y++) {
+            sum += weights[y * 3] * rows[y][i - step] + weights[y * 3 + 1] * rows[y][i] +
+                   weights[y * 3 + 2] * rows[y][i + step];
+        }
+        destination[i] = (uint8_t) std::min(std::max(sum / divisor, 0), 255);
+    }
+}
+
+static void extremeRowScalar(const uint8_t * source, uint8_t * destination, std::size_t count, int window,
+                             bool maximum) {
+    for (std::size_t i = 0; i < count; i++) {
+        uint8_t extreme = source[i];
+        for (int k = 1; k < window; k++) {
+            extreme = maximum ? std::max(extreme, source[i + k]) : std::min(extreme, source[i + k]);
+        }
+        destination[i] = extreme;
+    }
+}
+
+static void extremeRowsScalar(const uint8_t * const * rows, int rowCount, uint8_t * destination,
+                              std::size_t count, bool maximum) {
+    for (std::size_t i = 0; i < count; i++) {
+        uint8_t extreme = rows[0][i];
+        for (int k = 1; k < rowCount; k++) {
+            extreme = maximum ? std::max(extreme, rows[k][i]) : std::min(extreme, rows[k][i]);
+        }
+        destination[i] = extreme;
+    }
+}
+
+static uint64_t sumScalar(const uint8_t * source, std::size_t count) {
+    uint64_t sum = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        sum += source[i];
+    }
+
+    return sum;
+}
+
+static void bgrToGrayScalar(const uint8_t * bgr, uint8_t * gray, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+        gray[i] = (uint8_t) (bgr[3 * i + 2] / 3 + bgr[3 * i + 1] / 3 + bgr[3 * i] / 3);
+    }
+}
+
+static void grayToBgrScalar(const uint8_t * gray, uint8_t * bgr, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+        bgr[3 * i] = bgr[3 * i + 1] = bgr[3 * i + 2] = gray[i];
+    }
+}
+
+static void matchBgrScalar(const uint8_t * bgr, uint8_t * mask, std::size_t count, uint8_t value) {
+    for (std::size_t i = 0; i < count; i++) {
+        bool match = bgr[3 * i] == value && bgr[3 * i + 1] == value && bgr[3 * i + 2] == value;
+        mask[i] = match ? 255 : 0;
+    }
+}
+
+static void lookupScalar(const uint8_t * source, uint8_t * destination, std::size_t count, const uint8_t * table) {
+    for (std::size_t i = 0; i < count; i++) {
+        destination[i] = table[source[i]];
+    }
+}
+
+const Simd::Kernels Simd::scalarKernels = {
+        invertScalar,
+        thresholdScalar,
+        selectScalar,
+        convolveRowScalar,
+        extremeRowScalar,
+        extremeRowsScalar,
+        sumScalar,
+        bgrToGrayScalar,
+        grayToBgrScalar,
+        matchBgrScalar,
+        lookupScalar
+};
+
+/**
+ * The kernels that will be used, they are chosen at the first use.
+ */
+static std::atomic<const Simd::Kernels *> & activeKernels() {
+    static std::atomic<const Simd::Kernels *> kernels(&Simd::getKernels(Simd::detectLevel()));
+    return kernels;
+}
+
+Simd::Level Simd::detectLevel() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SSE41;
+    }
+#endif
+
+    return SCALAR;
+}
+
+Simd::Level Simd::getLevel() {
+    const Kernels * kernels = &get();
+#if defined(__x86_64__) || defined(__i386__)
+    if (kernels == &avx512Kernels) return AVX512;
+    if (kernels == &avx2Kernels) return AVX2;
+    if (kernels == &sse41Kernels) return SSE41;
+#endif
+
+    return SCALAR;
+}
+
+bool Simd::setLevel(Level level) {
+    if (level > detectLevel()) {
+        return false;
+    }
+
+    activeKernels().store(&getKernels(level));
+    return true;
+}
+
+Simd::Level Simd::parseLevel(const std::string & name) {
+    if (name == "scalar") return SCALAR;
+    if (name == "sse4.1") return SSE41;
+    if (name == "avx2") return AVX2;
+    if (name == "avx512") return AVX512;
+
+    throw UnknownLevelException();
+}
+
+const char * Simd::getLevelName(Level level) {
+    switch (level) {
+        case SSE41:
+            return "sse4.1";
+        case AVX2:
+            return "avx2";
+        case AVX512:
+            return "avx512";
+        case SCALAR:
+        default:
+            return "scalar";
+    }
+}
+
+const Simd::Kernels & Simd::getKernels(Level level) {
+    switch (level) {
+#if defined(__x86_64__) || defined(__i386__)
+        case SSE41:
+            return sse41Kernels;
+        case AVX2:
+            return avx2Kernels;
+        case AVX512:
+            return avx512Kernels;
+#endif
+        case SCALAR:
+        default:
+            return scalarKernels;
+    }
+}
+
+const Simd::Kernels & Simd::get() {
+    return *activeKernels().load(std::memory_order_relaxed);
+}
+
+void Simd::invert(const uint8_t * source, uint8_t * destination, std::size_t count, uint8_t maxValue) {
+    get().invert(source, destination, count, maxValue);
+}
+
+void Simd::threshold(const uint8_t * source, uint8_t * destination, std::size_t count, int limit,
+                     uint8_t low, uint8_t high) {
+    if (limit < 0) {
+        std::memset(destination, high, count);
+    } else if (limit >= 255) {
+        std::memset(destination, low, count);
+    } else {
+        get().threshold(source, destination, count, (uint8_t) limit, low, high);
+    }
+}
+
+void Simd::select(const uint8_t * source, const uint8_t * mask, uint8_t * destination, std::size_t count,
+                  uint8_t value) {
+    get().select(source, mask, destination, count, value);
+}
+
+/**
+ * Every row is split to the first pixel, the inner bytes (convolved by the kernel) and the last pixel.
+ */
+void Simd::convolve3x3(const uint8_t * source, uint8_t * destination, int width, int height, int channels,
+                       const int * weights, int divisor) {
+    auto step = (std::size_t) channels;
+    std::size_t rowBytes = (std::size_t) width * step;
+
+    int absoluteSum = 0;
+    for (int i = 0; i < 9; i++) {
+        absoluteSum += std::abs(weights[i]);
+    }
+    const Kernels & kernels = absoluteSum <= 65535 ? get() : scalarKernels;
+
+    for (int row = 0; row < height; row++) {
+        const uint8_t * sourceRow = source + (std::size_t) row * rowBytes;
+        uint8_t * destinationRow = destination + (std::size_t) row * rowBytes;
+        if (row == 0 || row == height - 1 || width < 3) {
+            std::memcpy(destinationRow, sourceRow, rowBytes);
+            continue;
+        }
+
+        std::memcpy(destinationRow, sourceRow, step);
+        kernels.convolveRow(sourceRow - rowBytes + step, sourceRow + step, sourceRow + rowBytes + step,
+                            destinationRow + step, rowBytes - 2 * step, step, weights, divisor);
+        std::memcpy(destinationRow + rowBytes - step, sourceRow + rowBytes - step, step);
+    }
+}
+
+void Simd::minFilter(const uint8_t * source, uint8_t * destination, int width, int height, int radius) {
+    extremeFilter(source, destination, width, height, radius, false, 0, height);
+}
+
+void Simd::maxFilter(const uint8_t * source, uint8_t * destination, int width, int height, int radius) {
+    extremeFilter(source, destination, width, height, radius, true, 0, height);
+}
+
+void Simd::maxFilter(const uint8_t * source, uint8_t * destination, int width, int height, int radius, int firstRow,
+                     int lastRow) {
+    extremeFilter(source, destination, width, height, radius, true, firstRow, lastRow);
+}
+
+/**
+ * The window cut at the border gives the same extreme as the full window over the row with the repeated edges.
+ */
+void Simd::extremeFilter(const uint8_t * source, uint8_t * destination, int width, int height, int radius,
+                         bool maximum, int firstRow, int lastRow) {
+    const Kernels & kernels = get();
+    auto rowBytes = (std::size_t) width;
+    int firstSourceRow = std::max(firstRow - radius, 0);
+    int lastSourceRow = std::min(lastRow + radius, height);
+    BufferPool::TemporaryBuffer rows(rowBytes * (lastSourceRow - firstSourceRow));
+    BufferPool::TemporaryBuffer padded(rowBytes + 2 * (std::size_t) radius);
+
+    for (int row = firstSourceRow; row < lastSourceRow; row++) {
+        const uint8_t * sourceRow = source + (std::size_t) row * rowBytes;
+        std::memset(padded.get(), sourceRow[0], (std::size_t) radius);
+        std::memcpy(padded.get() + radius, sourceRow, rowBytes);
+        std::memset(padded.get() + radius + rowBytes, sourceRow[rowBytes - 1], (std::size_t) radius);
+
+        kernels.extremeRow(padded.get(), rows.get() + (std::size_t) (row - firstSourceRow) * rowBytes, rowBytes,
+                           2 * radius + 1, maximum);
+    }
+
+    std::vector<const uint8_t *> window;
+    for (int row = firstRow; row < lastRow; row++) {
+        window.clear();
+        for (int y = std::max(row - radius, 0); y <= std::min(row + radius, height - 1); y++) {
+            window.push_back(rows.get() + (std::size_t) (y - firstSourceRow) * rowBytes);
+        }
+
+        kernels.extremeRows(window.data(), (int) window.size(),
+                            destination + (std::size_t) (row - firstRow) * rowBytes, rowBytes, maximum);
+    }
+}
+
+uint64_t Simd::sum(const uint8_t * source, std::size_t count) {
+    return get().sum(source, count);
+}
+
+void Simd::bgrToGray(const uint8_t * bgr, uint8_t * gray, std::size_t count) {
+    get().bgrToGray(bgr, gray, count);
+}
+
+void Simd::grayToBgr(const uint8_t * gray, uint8_t * bgr, std::size_t count) {
+    get().grayToBgr(gray, bgr, count);
+}
+
+void Simd::matchBgr(const uint8_t * bgr, uint8_t * mask, std::size_t count, uint8_t value) {
+    get().matchBgr(bgr, mask, count, value);
+}
+
+void Simd::lookup(const uint8_t * source, uint8_t * destination, std::size_t count, const uint8_t * table) {
+    get().lookup(source, destination, count, table);
+}
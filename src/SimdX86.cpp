@@ -0,0 +1,719 @@
+#include "Simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// every kernel enables only its own instruction set, so it can't leak to the code running on the older processors
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+
+/**
+ * Shuffles gathering the blue, green and red bytes of 16 BGR pixels (3 vectors of 16 bytes) - for every channel
+ * one mask per vector, -1 leaves the byte empty.
+ */
+alignas(16) static const int8_t DEINTERLEAVE[3][3][16] = {
+        {{0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13}},
+        {{1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14}},
+        {{2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15}}
+};
+
+/**
+ * Shuffles spreading 16 gray bytes to the 3 vectors of BGR pixels.
+ */
+alignas(16) static const int8_t INTERLEAVE[3][16] = {
+        {0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5},
+        {5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10},
+        {10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15}
+};
+
+/**
+ * Floor of x / 3 for the 16 bit lanes up to 255: x * 43691 >> 17.
+ */
+static const short DIVIDE_BY_3 = (short) 43691;
+
+static const Simd::Kernels & scalar() {
+    return Simd::getKernels(Simd::SCALAR);
+}
+
+/**
+ * Pointers to the neighbours of the 3x3 kernel with the non zero weights.
+ */
+struct Taps {
+    const uint8_t * pointers[9];
+    int weights[9];
+    int count = 0;
+
+    Taps(const uint8_t * above, const uint8_t * row, const uint8_t * below, std::size_t step, const int * weights) {
+        const uint8_t * rows[3] = {above, row, below};
+        for (int y = 0; y < 3; y++) {
+            for (int x = 0; x < 3; x++) {
+                if (weights[y * 3 + x] != 0) {
+                    this->pointers[this->count] = rows[y] + ((std::ptrdiff_t) x - 1) * (std::ptrdiff_t) step;
+                    this->weights[this->count++] = weights[y * 3 + x];
+                }
+            }
+        }
+    }
+};
+
+// SSE4.1 - 16 bytes at once
+
+TARGET_SSE41 static void invertSse41(const uint8_t * source, uint8_t * destination, std::size_t count,
+                                     uint8_t maxValue) {
+    __m128i max = _mm_set1_epi8((char) maxValue);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *) (source + i));
+        _mm_storeu_si128((__m128i *) (destination + i), _mm_sub_epi8(max, pixels));
+    }
+    scalar().invert(source + i, destination + i, count - i, maxValue);
+}
+
+TARGET_SSE41 static void thresholdSse41(const uint8_t * source, uint8_t * destination, std::size_t count,
+                                        uint8_t limit, uint8_t low, uint8_t high) {
+    __m128i limits = _mm_set1_epi8((char) limit);
+    __m128i lows = _mm_set1_epi8((char) low);
+    __m128i highs = _mm_set1_epi8((char) high);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *) (source + i));
+        __m128i belowLimit = _mm_cmpeq_epi8(_mm_min_epu8(pixels, limits), pixels);
+        _mm_storeu_si128((__m128i *) (destination + i), _mm_blendv_epi8(highs, lows, belowLimit));
+    }
+    scalar().threshold(source + i, destination + i, count - i, limit, low, high);
+}
+
+TARGET_SSE41 static void selectSse41(const uint8_t * source, const uint8_t * mask, uint8_t * destination,
+                                     std::size_t count, uint8_t value) {
+    __m128i values = _mm_set1_epi8((char) value);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *) (source + i));
+        __m128i empty = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (mask + i)), _mm_setzero_si128());
+        _mm_storeu_si128((__m128i *) (destination + i), _mm_blendv_epi8(values, pixels, empty));
+    }
+    scalar().select(source + i, mask + i, destination + i, count - i, value);
+}
+
+/**
+ * The sums are exact in 32 bits and the quotient of the floats is exact for the sums below 2^24,
+ * so the truncated result is the same as the integer division.
+ */
+TARGET_SSE41 static void convolveRowSse41(const uint8_t * above, const uint8_t * row, const uint8_t * below,
+                                          uint8_t * destination, std::size_t count, std::size_t step,
+                                          const int * weights, int divisor) {
+    Taps taps(above, row, below, step, weights);
+    __m128 divisors = _mm_set1_ps((float) divisor);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i sums[4] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+        for (int tap = 0; tap < taps.count; tap++) {
+            __m128i pixels = _mm_loadu_si128((const __m128i *) (taps.pointers[tap] + i));
+            __m128i weight = _mm_set1_epi32(taps.weights[tap]);
+            sums[0] = _mm_add_epi32(sums[0], _mm_mullo_epi32(_mm_cvtepu8_epi32(pixels), weight));
+            sums[1] = _mm_add_epi32(sums[1], _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(pixels, 4)), weight));
+            sums[2] = _mm_add_epi32(sums[2], _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(pixels, 8)), weight));
+            sums[3] = _mm_add_epi32(sums[3], _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(pixels, 12)), weight));
+        }
+
+        __m128i results[4];
+        for (int part = 0; part < 4; part++) {
+            results[part] = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(sums[part]), divisors));
+        }
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(results[0], results[1]),
+                                         _mm_packs_epi32(results[2], results[3]));
+        _mm_storeu_si128((__m128i *) (destination + i), bytes);
+    }
+    scalar().convolveRow(above + i, row + i, below + i, destination + i, count - i, step, weights, divisor);
+}
+
+TARGET_SSE41 static void extremeRowSse41(const uint8_t * source, uint8_t * destination, std::size_t count,
+                                         int window, bool maximum) {
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i extreme = _mm_loadu_si128((const __m128i *) (source + i));
+        for (int k = 1; k < window; k++) {
+            __m128i pixels = _mm_loadu_si128((const __m128i *) (source + i + k));
+            extreme = maximum ? _mm_max_epu8(extreme, pixels) : _mm_min_epu8(extreme, pixels);
+        }
+        _mm_storeu_si128((__m128i *) (destination + i), extreme);
+    }
+    scalar().extremeRow(source + i, destination + i, count - i, window, maximum);
+}
+
+TARGET_SSE41 static void extremeRowsSse41(const uint8_t * const * rows, int rowCount, uint8_t * destination,
+                                          std::size_t count, bool maximum) {
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i extreme = _mm_loadu_si128((const __m128i *) (rows[0] + i));
+        for (int k = 1; k < rowCount; k++) {
+            __m128i pixels = _mm_loadu_si128((const __m128i *) (rows[k] + i));
+            extreme = maximum ? _mm_max_epu8(extreme, pixels) : _mm_min_epu8(extreme, pixels);
+        }
+        _mm_storeu_si128((__m128i *) (destination + i), extreme);
+    }
+
+    const uint8_t * tails[rowCount];
+    for (int k = 0; k < rowCount; k++) {
+        tails[k] = rows[k] + i;
+    }
+    scalar().extremeRows(tails, rowCount, destination + i, count - i, maximum);
+}
+
+TARGET_SSE41 static uint64_t sumSse41(const uint8_t * source, std::size_t count) {
+    __m128i sums = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *) (source + i));
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(pixels, _mm_setzero_si128()));
+    }
+
+    uint64_t parts[2];
+    _mm_storeu_si128((__m128i *) parts, sums);
+    return parts[0] + parts[1] + scalar().sum(source + i, count - i);
+}
+
+TARGET_SSE41 static void deinterleaveSse41(const uint8_t * bgr, __m128i channels[3]) {
+    __m128i vectors[3];
+    for (int part = 0; part < 3; part++) {
+        vectors[part] = _mm_loadu_si128((const __m128i *) (bgr + 16 * part));
+    }
+    for (int channel = 0; channel < 3; channel++) {
+        __m128i gathered = _mm_setzero_si128();
+        for (int part = 0; part < 3; part++) {
+            __m128i mask = _mm_load_si128((const __m128i *) DEINTERLEAVE[channel][part]);
+            gathered = _mm_or_si128(gathered, _mm_shuffle_epi8(vectors[part], mask));
+        }
+        channels[channel] = gathered;
+    }
+}
+
+TARGET_SSE41 static void bgrToGraySse41(const uint8_t * bgr, uint8_t * gray, std::size_t count) {
+    __m128i divide = _mm_set1_epi16(DIVIDE_BY_3);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i channels[3];
+        deinterleaveSse41(bgr + 3 * i, channels);
+
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        for (__m128i channel : channels) {
+            __m128i channelLow = _mm_cvtepu8_epi16(channel);
+            __m128i channelHigh = _mm_unpackhi_epi8(channel, _mm_setzero_si128());
+            low = _mm_add_epi16(low, _mm_srli_epi16(_mm_mulhi_epu16(channelLow, divide), 1));
+            high = _mm_add_epi16(high, _mm_srli_epi16(_mm_mulhi_epu16(channelHigh, divide), 1));
+        }
+        _mm_storeu_si128((__m128i *) (gray + i), _mm_packus_epi16(low, high));
+    }
+    scalar().bgrToGray(bgr + 3 * i, gray + i, count - i);
+}
+
+TARGET_SSE41 static void grayToBgrSse41(const uint8_t * gray, uint8_t * bgr, std::size_t count) {
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *) (gray + i));
+        for (int part = 0; part < 3; part++) {
+            __m128i mask = _mm_load_si128((const __m128i *) INTERLEAVE[part]);
+            _mm_storeu_si128((__m128i *) (bgr + 3 * i + 16 * part), _mm_shuffle_epi8(pixels, mask));
+        }
+    }
+    scalar().grayToBgr(gray + i, bgr + 3 * i, count - i);
+}
+
+TARGET_SSE41 static void matchBgrSse41(const uint8_t * bgr, uint8_t * mask, std::size_t count, uint8_t value) {
+    __m128i values = _mm_set1_epi8((char) value);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i channels[3];
+        deinterleaveSse41(bgr + 3 * i, channels);
+        __m128i match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(channels[0], values),
+                                                    _mm_cmpeq_epi8(channels[1], values)),
+                                      _mm_cmpeq_epi8(channels[2], values));
+        _mm_storeu_si128((__m128i *) (mask + i), match);
+    }
+    scalar().matchBgr(bgr + 3 * i, mask + i, count - i, value);
+}
+
+/**
+ * 16 shuffles of 16 bytes (see the AVX2 kernel) are slower than the scalar loads from the table.
+ */
+static void lookupSse41(const uint8_t * source, uint8_t * destination, std::size_t count, const uint8_t * table) {
+    scalar().lookup(source, destination, count, table);
+}
+
+const Simd::Kernels Simd::sse41Kernels = {
+        invertSse41,
+        thresholdSse41,
+        selectSse41,
+        convolveRowSse41,
+        extremeRowSse41,
+        extremeRowsSse41,
+        sumSse41,
+        bgrToGraySse41,
+        grayToBgrSse41,
+        matchBgrSse41,
+        lookupSse41
+};
+
+// AVX2 - 32 bytes at once, the BGR pixels are split between the 128 bit lanes (the shuffles work inside them)
+
+TARGET_AVX2 static __m256i loadLanesAvx2(const uint8_t * low, const uint8_t * high) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) low)),
+                                   _mm_loadu_si128((const __m128i *) high), 1);
+}
+
+TARGET_AVX2 static __m256i loadMaskAvx2(const int8_t * mask) {
+    return _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *) mask));
+}
+
+TARGET_AVX2 static void invertAvx2(const uint8_t * source, uint8_t * destination, std::size_t count,
+                                   uint8_t maxValue) {
+    __m256i max = _mm256_set1_epi8((char) maxValue);
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i pixels = _mm256_loadu_si256((const __m256i *) (source + i));
+        _mm256_storeu_si256((__m256i *) (destination + i), _mm256_sub_epi8(max, pixels));
+    }
+    scalar().invert(source + i, destination + i, count - i, maxValue);
+}
+
+TARGET_AVX2 static void thresholdAvx2(const uint8_t * source, uint8_t * destination, std::size_t count,
+                                      uint8_t limit, uint8_t low, uint8_t high) {
+    __m256i limits = _mm256_set1_epi8((char) limit);
+    __m256i lows = _mm256_set1_epi8((char) low);
+    __m256i highs = _mm256_set1_epi8((char) high);
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i pixels = _mm256_loadu_si256((const __m256i *) (source + i));
+        __m256i belowLimit = _mm256_cmpeq_epi8(_mm256_min_epu8(pixels, limits), pixels);
+        _mm256_storeu_si256((__m256i *) (destination + i), _mm256_blendv_epi8(highs, lows, belowLimit));
+    }
+    scalar().threshold(source + i, destination + i, count - i, limit, low, high);
+}
+
+TARGET_AVX2 static void selectAvx2(const uint8_t * source, const uint8_t * mask, uint8_t * destination,
+                                   std::size_t count, uint8_t value) {
+    __m256i values = _mm256_set1_epi8((char) value);
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i pixels = _mm256_loadu_si256((const __m256i *) (source + i));
+        __m256i empty = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (mask + i)),
+                                          _mm256_setzero_si256());
+        _mm256_storeu_si256((__m256i *) (destination + i), _mm256_blendv_epi8(values, pixels, empty));
+    }
+    scalar().select(source + i, mask + i, destination + i, count - i, value);
+}
+
+TARGET_AVX2 static void convolveRowAvx2(const uint8_t * above, const uint8_t * row, const uint8_t * below,
+                                        uint8_t * destination, std::size_t count, std::size_t step,
+                                        const int * weights, int divisor) {
+    Taps taps(above, row, below, step, weights);
+    __m256 divisors = _mm256_set1_ps((float) divisor);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i low = _mm256_setzero_si256();
+        __m256i high = _mm256_setzero_si256();
+        for (int tap = 0; tap < taps.count; tap++) {
+            __m128i pixels = _mm_loadu_si128((const __m128i *) (taps.pointers[tap] + i));
+            __m256i weight = _mm256_set1_epi32(taps.weights[tap]);
+            low = _mm256_add_epi32(low, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(pixels), weight));
+            high = _mm256_add_epi32(high, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(pixels, 8)),
+                                                             weight));
+        }
+
+        low = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(low), divisors));
+        high = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(high), divisors));
+        __m128i lowWords = _mm_packs_epi32(_mm256_castsi256_si128(low), _mm256_extracti128_si256(low, 1));
+        __m128i highWords = _mm_packs_epi32(_mm256_castsi256_si128(high), _mm256_extracti128_si256(high, 1));
+        _mm_storeu_si128((__m128i *) (destination + i), _mm_packus_epi16(lowWords, highWords));
+    }
+    scalar().convolveRow(above + i, row + i, below + i, destination + i, count - i, step, weights, divisor);
+}
+
+TARGET_AVX2 static void extremeRowAvx2(const uint8_t * source, uint8_t * destination, std::size_t count,
+                                       int window, bool maximum) {
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i extreme = _mm256_loadu_si256((const __m256i *) (source + i));
+        for (int k = 1; k < window; k++) {
+            __m256i pixels = _mm256_loadu_si256((const __m256i *) (source + i + k));
+            extreme = maximum ? _mm256_max_epu8(extreme, pixels) : _mm256_min_epu8(extreme, pixels);
+        }
+        _mm256_storeu_si256((__m256i *) (destination + i), extreme);
+    }
+    scalar().extremeRow(source + i, destination + i, count - i, window, maximum);
+}
+
+TARGET_AVX2 static void extremeRowsAvx2(const uint8_t * const * rows, int rowCount, uint8_t * destination,
+                                        std::size_t count, bool maximum) {
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i extreme = _mm256_loadu_si256((const __m256i *) (rows[0] + i));
+        for (int k = 1; k < rowCount; k++) {
+            __m256i pixels = _mm256_loadu_si256((const __m256i *) (rows[k] + i));
+            extreme = maximum ? _mm256_max_epu8(extreme, pixels) : _mm256_min_epu8(extreme, pixels);
+        }
+        _mm256_storeu_si256((__m256i *) (destination + i), extreme);
+    }
+
+    const uint8_t * tails[rowCount];
+    for (int k = 0; k < rowCount; k++) {
+        tails[k] = rows[k] + i;
+    }
+    scalar().extremeRows(tails, rowCount, destination + i, count - i, maximum);
+}
+
+TARGET_AVX2 static uint64_t sumAvx2(const uint8_t * source, std::size_t count) {
+    __m256i sums = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i pixels = _mm256_loadu_si256((const __m256i *) (source + i));
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(pixels, _mm256_setzero_si256()));
+    }
+
+    uint64_t parts[4];
+    _mm256_storeu_si256((__m256i *) parts, sums);
+    return parts[0] + parts[1] + parts[2] + parts[3] + scalar().sum(source + i, count - i);
+}
+
+/**
+ * Pixels 0-15 go to the low lane and 16-31 to the high lane, so the channels keep the order of the pixels.
+ */
+TARGET_AVX2 static void deinterleaveAvx2(const uint8_t * bgr, __m256i channels[3]) {
+    __m256i vectors[3];
+    for (int part = 0; part < 3; part++) {
+        vectors[part] = loadLanesAvx2(bgr + 16 * part, bgr + 48 + 16 * part);
+    }
+    for (int channel = 0; channel < 3; channel++) {
+        __m256i gathered = _mm256_setzero_si256();
+        for (int part = 0; part < 3; part++) {
+            gathered = _mm256_or_si256(gathered, _mm256_shuffle_epi8(vectors[part],
+                                                                     loadMaskAvx2(DEINTERLEAVE[channel][part])));
+        }
+        channels[channel] = gathered;
+    }
+}
+
+TARGET_AVX2 static void bgrToGrayAvx2(const uint8_t * bgr, uint8_t * gray, std::size_t count) {
+    __m256i divide = _mm256_set1_epi16(DIVIDE_BY_3);
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i channels[3];
+        deinterleaveAvx2(bgr + 3 * i, channels);
+
+        // unpack and pack work inside the lanes, so the order of the pixels is restored
+        __m256i low = _mm256_setzero_si256();
+        __m256i high = _mm256_setzero_si256();
+        for (__m256i channel : channels) {
+            __m256i channelLow = _mm256_unpacklo_epi8(channel, _mm256_setzero_si256());
+            __m256i channelHigh = _mm256_unpackhi_epi8(channel, _mm256_setzero_si256());
+            low = _mm256_add_epi16(low, _mm256_srli_epi16(_mm256_mulhi_epu16(channelLow, divide), 1));
+            high = _mm256_add_epi16(high, _mm256_srli_epi16(_mm256_mulhi_epu16(channelHigh, divide), 1));
+        }
+        _mm256_storeu_si256((__m256i *) (gray + i), _mm256_packus_epi16(low, high));
+    }
+    scalar().bgrToGray(bgr + 3 * i, gray + i, count - i);
+}
+
+TARGET_AVX2 static void grayToBgrAvx2(const uint8_t * gray, uint8_t * bgr, std::size_t count) {
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i pixels = _mm256_loadu_si256((const __m256i *) (gray + i));
+        for (int part = 0; part < 3; part++) {
+            __m256i spread = _mm256_shuffle_epi8(pixels, loadMaskAvx2(INTERLEAVE[part]));
+            _mm_storeu_si128((__m128i *) (bgr + 3 * i + 16 * part), _mm256_castsi256_si128(spread));
+            _mm_storeu_si128((__m128i *) (bgr + 3 * i + 48 + 16 * part), _mm256_extracti128_si256(spread, 1));
+        }
+    }
+    scalar().grayToBgr(gray + i, bgr + 3 * i, count - i);
+}
+
+TARGET_AVX2 static void matchBgrAvx2(const uint8_t * bgr, uint8_t * mask, std::size_t count, uint8_t value) {
+    __m256i values = _mm256_set1_epi8((char) value);
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i channels[3];
+        deinterleaveAvx2(bgr + 3 * i, channels);
+        __m256i match = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(channels[0], values),
+                                                          _mm256_cmpeq_epi8(channels[1], values)),
+                                         _mm256_cmpeq_epi8(channels[2], values));
+        _mm256_storeu_si256((__m256i *) (mask + i), match);
+    }
+    scalar().matchBgr(bgr + 3 * i, mask + i, count - i, value);
+}
+
+/**
+ * The table is split to 16 shuffles of 16 values, the values of the other shuffles are zeroed by the index
+ * with the highest bit set (value - 16 * k + 0x70 saturates to 0x80 and more outside of the k-th shuffle).
+ */
+TARGET_AVX2 static void lookupAvx2(const uint8_t * source, uint8_t * destination, std::size_t count,
+                                   const uint8_t * table) {
+    __m256i tables[16];
+    for (int k = 0; k < 16; k++) {
+        tables[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (table + 16 * k)));
+    }
+    __m256i offset = _mm256_set1_epi8(0x70);
+    __m256i sixteen = _mm256_set1_epi8(16);
+
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i indexes = _mm256_loadu_si256((const __m256i *) (source + i));
+        __m256i result = _mm256_setzero_si256();
+        for (int k = 0; k < 16; k++) {
+            result = _mm256_or_si256(result, _mm256_shuffle_epi8(tables[k], _mm256_adds_epu8(indexes, offset)));
+            indexes = _mm256_sub_epi8(indexes, sixteen);
+        }
+        _mm256_storeu_si256((__m256i *) (destination + i), result);
+    }
+    scalar().lookup(source + i, destination + i, count - i, table);
+}
+
+const Simd::Kernels Simd::avx2Kernels = {
+        invertAvx2,
+        thresholdAvx2,
+        selectAvx2,
+        convolveRowAvx2,
+        extremeRowAvx2,
+        extremeRowsAvx2,
+        sumAvx2,
+        bgrToGrayAvx2,
+        grayToBgrAvx2,
+        matchBgrAvx2,
+        lookupAvx2
+};
+
+// AVX-512 (BW) - 64 bytes at once, the comparisons give the mask registers
+// (GCC 12 passes the undefined source to the unmasked forms of some conversions, broadcasts, extracts and casts, so
+// their zero-masked forms with all the lanes are used - they are the same instructions without -Wmaybe-uninitialized)
+static const __mmask16 ALL_LANES = 0xffff;
+
+TARGET_AVX512 static __m512i loadLanesAvx512(const uint8_t * bgr) {
+    __m512i lanes = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i *) bgr));
+    lanes = _mm512_inserti32x4(lanes, _mm_loadu_si128((const __m128i *) (bgr + 48)), 1);
+    lanes = _mm512_inserti32x4(lanes, _mm_loadu_si128((const __m128i *) (bgr + 96)), 2);
+    return _mm512_inserti32x4(lanes, _mm_loadu_si128((const __m128i *) (bgr + 144)), 3);
+}
+
+TARGET_AVX512 static __m512i loadMaskAvx512(const int8_t * mask) {
+    return _mm512_maskz_broadcast_i32x4(ALL_LANES, _mm_load_si128((const __m128i *) mask));
+}
+
+TARGET_AVX512 static void invertAvx512(const uint8_t * source, uint8_t * destination, std::size_t count,
+                                       uint8_t maxValue) {
+    __m512i max = _mm512_set1_epi8((char) maxValue);
+    std::size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i pixels = _mm512_loadu_si512(source + i);
+        _mm512_storeu_si512(destination + i, _mm512_sub_epi8(max, pixels));
+    }
+    scalar().invert(source + i, destination + i, count - i, maxValue);
+}
+
+TARGET_AVX512 static void thresholdAvx512(const uint8_t * source, uint8_t * destination, std::size_t count,
+                                          uint8_t limit, uint8_t low, uint8_t high) {
+    __m512i limits = _mm512_set1_epi8((char) limit);
+    __m512i lows = _mm512_set1_epi8((char) low);
+    __m512i highs = _mm512_set1_epi8((char) high);
+    std::size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __mmask64 belowLimit = _mm512_cmple_epu8_mask(_mm512_loadu_si512(source + i), limits);
+        _mm512_storeu_si512(destination + i, _mm512_mask_blend_epi8(belowLimit, highs, lows));
+    }
+    scalar().threshold(source + i, destination + i, count - i, limit, low, high);
+}
+
+TARGET_AVX512 static void selectAvx512(const uint8_t * source, const uint8_t * mask, uint8_t * destination,
+                                       std::size_t count, uint8_t value) {
+    __m512i values = _mm512_set1_epi8((char) value);
+    std::size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i masks = _mm512_loadu_si512(mask + i);
+        __mmask64 selected = _mm512_test_epi8_mask(masks, masks);
+        _mm512_storeu_si512(destination + i, _mm512_mask_blend_epi8(selected, _mm512_loadu_si512(source + i),
+                                                                    values));
+    }
+    scalar().select(source + i, mask + i, destination + i, count - i, value);
+}
+
+TARGET_AVX512 static void convolveRowAvx512(const uint8_t * above, const uint8_t * row, const uint8_t * below,
+                                            uint8_t * destination, std::size_t count, std::size_t step,
+                                            const int * weights, int divisor) {
+    Taps taps(above, row, below, step, weights);
+    __m512 divisors = _mm512_set1_ps((float) divisor);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i sums = _mm512_setzero_si512();
+        for (int tap = 0; tap < taps.count; tap++) {
+            __m128i pixels = _mm_loadu_si128((const __m128i *) (taps.pointers[tap] + i));
+            sums = _mm512_add_epi32(sums, _mm512_mullo_epi32(_mm512_maskz_cvtepu8_epi32(ALL_LANES, pixels),
+                                                             _mm512_set1_epi32(taps.weights[tap])));
+        }
+
+        __m512i results = _mm512_maskz_cvttps_epi32(ALL_LANES, _mm512_div_ps(_mm512_maskz_cvtepi32_ps(ALL_LANES, sums),
+                                                                             divisors));
+        results = _mm512_maskz_min_epi32(ALL_LANES, _mm512_maskz_max_epi32(ALL_LANES, results, _mm512_setzero_si512()),
+                                         _mm512_set1_epi32(255));
+        _mm_storeu_si128((__m128i *) (destination + i), _mm512_maskz_cvtepi32_epi8(ALL_LANES, results));
+    }
+    scalar().convolveRow(above + i, row + i, below + i, destination + i, count - i, step, weights, divisor);
+}
+
+TARGET_AVX512 static void extremeRowAvx512(const uint8_t * source, uint8_t * destination, std::size_t count,
+                                           int window, bool maximum) {
+    std::size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i extreme = _mm512_loadu_si512(source + i);
+        for (int k = 1; k < window; k++) {
+            __m512i pixels = _mm512_loadu_si512(source + i + k);
+            extreme = maximum ? _mm512_max_epu8(extreme, pixels) : _mm512_min_epu8(extreme, pixels);
+        }
+        _mm512_storeu_si512(destination + i, extreme);
+    }
+    scalar().extremeRow(source + i, destination + i, count - i, window, maximum);
+}
+
+TARGET_AVX512 static void extremeRowsAvx512(const uint8_t * const * rows, int rowCount, uint8_t * destination,
+                                            std::size_t count, bool maximum) {
+    std::size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i extreme = _mm512_loadu_si512(rows[0] + i);
+        for (int k = 1; k < rowCount; k++) {
+            __m512i pixels = _mm512_loadu_si512(rows[k] + i);
+            extreme = maximum ? _mm512_max_epu8(extreme, pixels) : _mm512_min_epu8(extreme, pixels);
+        }
+        _mm512_storeu_si512(destination + i, extreme);
+    }
+
+    const uint8_t * tails[rowCount];
+    for (int k = 0; k < rowCount; k++) {
+        tails[k] = rows[k] + i;
+    }
+    scalar().extremeRows(tails, rowCount, destination + i, count - i, maximum);
+}
+
+TARGET_AVX512 static uint64_t sumAvx512(const uint8_t * source, std::size_t count) {
+    __m512i sums = _mm512_setzero_si512();
+    std::size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        sums = _mm512_add_epi64(sums, _mm512_sad_epu8(_mm512_loadu_si512(source + i), _mm512_setzero_si512()));
+    }
+
+    uint64_t parts[8];
+    _mm512_storeu_si512(parts, sums);
+    return parts[0] + parts[1] + parts[2] + parts[3] + parts[4] + parts[5] + parts[6] + parts[7] +
+           scalar().sum(source + i, count - i);
+}
+
+/**
+ * Every lane gets 16 pixels - pixels 0-15, 16-31, 32-47 and 48-63.
+ */
+TARGET_AVX512 static void deinterleaveAvx512(const uint8_t * bgr, __m512i channels[3]) {
+    __m512i vectors[3];
+    for (int part = 0; part < 3; part++) {
+        vectors[part] = loadLanesAvx512(bgr + 16 * part);
+    }
+    for (int channel = 0; channel < 3; channel++) {
+        __m512i gathered = _mm512_setzero_si512();
+        for (int part = 0; part < 3; part++) {
+            gathered = _mm512_or_si512(gathered, _mm512_shuffle_epi8(vectors[part],
+                                                                     loadMaskAvx512(DEINTERLEAVE[channel][part])));
+        }
+        channels[channel] = gathered;
+    }
+}
+
+TARGET_AVX512 static void bgrToGrayAvx512(const uint8_t * bgr, uint8_t * gray, std::size_t count) {
+    __m512i divide = _mm512_set1_epi16(DIVIDE_BY_3);
+    std::size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i channels[3];
+        deinterleaveAvx512(bgr + 3 * i, channels);
+
+        __m512i low = _mm512_setzero_si512();
+        __m512i high = _mm512_setzero_si512();
+        for (__m512i channel : channels) {
+            __m512i channelLow = _mm512_unpacklo_epi8(channel, _mm512_setzero_si512());
+            __m512i channelHigh = _mm512_unpackhi_epi8(channel, _mm512_setzero_si512());
+            low = _mm512_add_epi16(low, _mm512_srli_epi16(_mm512_mulhi_epu16(channelLow, divide), 1));
+            high = _mm512_add_epi16(high, _mm512_srli_epi16(_mm512_mulhi_epu16(channelHigh, divide), 1));
+        }
+        _mm512_storeu_si512(gray + i, _mm512_packus_epi16(low, high));
+    }
+    scalar().bgrToGray(bgr + 3 * i, gray + i, count - i);
+}
+
+TARGET_AVX512 static void grayToBgrAvx512(const uint8_t * gray, uint8_t * bgr, std::size_t count) {
+    std::size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i pixels = _mm512_loadu_si512(gray + i);
+        for (int part = 0; part < 3; part++) {
+            __m512i spread = _mm512_shuffle_epi8(pixels, loadMaskAvx512(INTERLEAVE[part]));
+            uint8_t * block = bgr + 3 * i + 16 * part;
+            _mm_storeu_si128((__m128i *) block, _mm512_maskz_extracti32x4_epi32(0xf, spread, 0));
+            _mm_storeu_si128((__m128i *) (block + 48), _mm512_maskz_extracti32x4_epi32(0xf, spread, 1));
+            _mm_storeu_si128((__m128i *) (block + 96), _mm512_maskz_extracti32x4_epi32(0xf, spread, 2));
+            _mm_storeu_si128((__m128i *) (block + 144), _mm512_maskz_extracti32x4_epi32(0xf, spread, 3));
+        }
+    }
+    scalar().grayToBgr(gray + i, bgr + 3 * i, count - i);
+}
+
+TARGET_AVX512 static void matchBgrAvx512(const uint8_t * bgr, uint8_t * mask, std::size_t count, uint8_t value) {
+    __m512i values = _mm512_set1_epi8((char) value);
+    std::size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i channels[3];
+        deinterleaveAvx512(bgr + 3 * i, channels);
+        __mmask64 match = _mm512_cmpeq_epi8_mask(channels[0], values) &
+                          _mm512_cmpeq_epi8_mask(channels[1], values) &
+                          _mm512_cmpeq_epi8_mask(channels[2], values);
+        _mm512_storeu_si512(mask + i, _mm512_movm_epi8(match));
+    }
+    scalar().matchBgr(bgr + 3 * i, mask + i, count - i, value);
+}
+
+TARGET_AVX512 static void lookupAvx512(const uint8_t * source, uint8_t * destination, std::size_t count,
+                                       const uint8_t * table) {
+    __m512i tables[16];
+    for (int k = 0; k < 16; k++) {
+        tables[k] = _mm512_maskz_broadcast_i32x4(ALL_LANES, _mm_loadu_si128((const __m128i *) (table + 16 * k)));
+    }
+    __m512i offset = _mm512_set1_epi8(0x70);
+    __m512i sixteen = _mm512_set1_epi8(16);
+
+    std::size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i indexes = _mm512_loadu_si512(source + i);
+        __m512i result = _mm512_setzero_si512();
+        for (int k = 0; k < 16; k++) {
+            result = _mm512_or_si512(result, _mm512_shuffle_epi8(tables[k], _mm512_adds_epu8(indexes, offset)));
+            indexes = _mm512_sub_epi8(indexes, sixteen);
+        }
+        _mm512_storeu_si512(destination + i, result);
+    }
+    scalar().lookup(source + i, destination + i, count - i, table);
+}
+
+const Simd::Kernels Simd::avx512Kernels = {
+        invertAvx512,
+        thresholdAvx512,
+        selectAvx512,
+        convolveRowAvx512,
+        extremeRowAvx512,
+        extremeRowsAvx512,
+        sumAvx512,
+        bgrToGrayAvx512,
+        grayToBgrAvx512,
+        matchBgrAvx512,
+        lookupAvx512
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <exception>
+
+/**
+ * Smallest work of one part - the smaller parts don't pay for passing them to the pool.
+ */
+static const std::size_t WORK_PER_PART = 1 << 20;
+
+static thread_local int workerIndex = -1;
+static thread_local const ThreadPool * workerPool = nullptr;
+
+ThreadPool::ThreadPool(unsigned threads) : nextQueue(0) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < threads; i++) {
+        queues.emplace_back(new Queue());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+
+    for (std::thread & worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        queued++;
+        pending++;
+    }
+
+    unsigned index = workerPool == this ? (unsigned) workerIndex : nextQueue++ % (unsigned) queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allFinished.wait(lock, [this] { return pending == 0; });
+}
+
+unsigned ThreadPool::getSize() const {
+    return (unsigned) workers.size();
+}
+
+int ThreadPool::getWorkerIndex() {
+    return workerIndex;
+}
+
+std::size_t ThreadPool::countParts(std::size_t items, std::size_t work) {
+    if (workerIndex >= 0) {
+        return 1;
+    }
+
+    return std::max<std::size_t>(std::min<std::size_t>({std::max(1u, std::thread::hardware_concurrency()),
+                                                        work / WORK_PER_PART, items}), 1);
+}
+
+/**
+ * The workers of the shared pool process their parts themselves (countParts returns 1 for them), so they never
+ * wait for the pool they belong to.
+ */
+void ThreadPool::runParts(std::size_t parts, const std::function<void(std::size_t)> & operation) {
+    if (parts < 2) {
+        if (parts == 1) {
+            operation(0);
+        }
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(parts);
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::size_t remaining = parts - 1;
+    ThreadPool & shared = getShared();
+    for (std::size_t part = 1; part < parts; part++) {
+        shared.submit([&operation, &errors, &mutex, &finished, &remaining, part] {
+            try {
+                operation(part);
+            } catch (...) {
+                errors[part] = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0) {
+                finished.notify_all();
+            }
+        });
+    }
+
+    try {
+        operation(0);
+    } catch (...) {
+        errors[0] = std::current_exception();
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&remaining] { return remaining == 0; });
+    }
+
+    for (const std::exception_ptr & error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t first, std::size_t last, std::size_t work,
+                             const std::function<void(std::size_t, std::size_t)> & operation) {
+    if (last <= first) {
+        return;
+    }
+
+    std::size_t items = last - first;
+    std::size_t parts = countParts(items, work);
+    runParts(parts, [first, items, parts, &operation](std::size_t part) {
+        operation(first + items * part / parts, first + items * (part + 1) / parts);
+    });
+}
+
+ThreadPool & ThreadPool::getShared() {
+    static ThreadPool shared(std::max(1u, std::thread::hardware_concurrency()));
+    return shared;
+}
+
+void ThreadPool::work(unsigned index) {
+    workerIndex = (int) index;
+    workerPool = this;
+
+    std::function<void()> task;
+    while (true) {
+        if (findTask(index, task)) {
+            try {
+                task();
+            } catch (...) {
+                // tasks report their own errors
+            }
+            task = nullptr;
+
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (--pending == 0) {
+                allFinished.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        taskAvailable.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::findTask(unsigned index, std::function<void()> & task) {
+    std::size_t count = queues.size();
+    for (std::size_t i = 0; i < count; i++) {
+        Queue & queue = *queues[(index + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+
+        // own queue - the newest task, other queues - the oldest one
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+
+        std::lock_guard<std::mutex> stateLock(stateMutex);
+        queued--;
+        return true;
+    }
+
+    return false;
+}